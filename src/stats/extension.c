@@ -11,5 +11,8 @@ SQLITE_EXTENSION_INIT3
 int stats_init(sqlite3* db) {
     stats_scalar_init(db);
     stats_series_init(db);
+    stats_histogram_init(db);
+    stats_hll_init(db);
+    stats_range_init(db);
     return SQLITE_OK;
 }
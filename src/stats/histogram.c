@@ -0,0 +1,666 @@
+// Copyright (c) 2023 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Histogram aggregates and a table-valued function to unpack them.
+//
+// A histogram is returned as a JSON object with nbins+1 bin edges
+// and nbins counts: {"edges":[0.0,50.0,100.0],"counts":[3,7]}.
+// Every bin includes its lower edge, the last one also includes the upper.
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sqlite3ext.h"
+SQLITE_EXTENSION_INIT3
+
+#define HISTOGRAM_MAX_BINS 100000
+
+#pragma region Result
+
+// result_histogram returns the histogram as a JSON function result.
+static void result_histogram(sqlite3_context* ctx,
+                             const double* edges,
+                             const sqlite3_int64* counts,
+                             int nbins) {
+    sqlite3_str* str = sqlite3_str_new(0);
+    sqlite3_str_appendall(str, "{\"edges\":[");
+    for (int i = 0; i <= nbins; i++) {
+        sqlite3_str_appendf(str, i ? ",%!.15g" : "%!.15g", edges[i]);
+    }
+    sqlite3_str_appendall(str, "],\"counts\":[");
+    for (int i = 0; i < nbins; i++) {
+        sqlite3_str_appendf(str, i ? ",%lld" : "%lld", counts[i]);
+    }
+    sqlite3_str_appendall(str, "]}");
+
+    int rc = sqlite3_str_errcode(str);
+    char* json = sqlite3_str_finish(str);
+    if (rc != SQLITE_OK) {
+        sqlite3_free(json);
+        sqlite3_result_error_code(ctx, rc);
+        return;
+    }
+    sqlite3_result_text(ctx, json, -1, sqlite3_free);
+}
+
+#pragma endregion
+
+#pragma region Fixed-width histogram
+
+typedef struct {
+    double lo;
+    double hi;
+    double scale;           // nbins / (hi - lo)
+    int nbins;              // 0 until the first row is seen
+    sqlite3_int64* counts;  // nbins counters
+} FixedHistogram;
+
+// Counts the value in its bin. Ignores nulls and values outside [lo, hi].
+// histogram(x, lo, hi, nbins)
+static void histogram_step(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    assert(argc == 4);
+    FixedHistogram* hist = sqlite3_aggregate_context(ctx, sizeof(*hist));
+    if (!hist) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+
+    double lo = sqlite3_value_double(argv[1]);
+    double hi = sqlite3_value_double(argv[2]);
+    sqlite3_int64 nbins = sqlite3_value_int64(argv[3]);
+
+    if (hist->nbins == 0) {
+        if (sqlite3_value_numeric_type(argv[1]) == SQLITE_NULL ||
+            sqlite3_value_numeric_type(argv[2]) == SQLITE_NULL || !isfinite(lo) ||
+            !isfinite(hi) || hi <= lo) {
+            sqlite3_result_error(ctx, "histogram: lo and hi should be numbers with lo < hi", -1);
+            return;
+        }
+        if (nbins < 1 || nbins > HISTOGRAM_MAX_BINS) {
+            sqlite3_result_error(ctx, "histogram: nbins should be between 1 and 100000", -1);
+            return;
+        }
+        hist->counts = sqlite3_malloc64(sizeof(*hist->counts) * nbins);
+        if (!hist->counts) {
+            sqlite3_result_error_nomem(ctx);
+            return;
+        }
+        memset(hist->counts, 0, sizeof(*hist->counts) * nbins);
+        hist->lo = lo;
+        hist->hi = hi;
+        hist->nbins = (int)nbins;
+        hist->scale = nbins / (hi - lo);
+    } else if (lo != hist->lo || hi != hist->hi || nbins != hist->nbins) {
+        sqlite3_result_error(ctx, "histogram: lo, hi and nbins should be the same for all rows", -1);
+        return;
+    }
+
+    if (sqlite3_value_numeric_type(argv[0]) == SQLITE_NULL) {
+        return;
+    }
+    double x = sqlite3_value_double(argv[0]);
+    if (!(x >= hist->lo && x <= hist->hi)) {
+        return;
+    }
+    int bin = (int)((x - hist->lo) * hist->scale);
+    if (bin >= hist->nbins) {
+        bin = hist->nbins - 1;
+    }
+    hist->counts[bin]++;
+}
+
+// Returns the histogram as JSON.
+static void histogram_final(sqlite3_context* ctx) {
+    FixedHistogram* hist = sqlite3_aggregate_context(ctx, 0);
+    if (!hist || !hist->counts) {
+        return;
+    }
+    double* edges = sqlite3_malloc64(sizeof(*edges) * (hist->nbins + 1));
+    if (!edges) {
+        sqlite3_free(hist->counts);
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    double width = (hist->hi - hist->lo) / hist->nbins;
+    for (int i = 0; i < hist->nbins; i++) {
+        edges[i] = hist->lo + i * width;
+    }
+    edges[hist->nbins] = hist->hi;
+    result_histogram(ctx, edges, hist->counts, hist->nbins);
+    sqlite3_free(edges);
+    sqlite3_free(hist->counts);
+    hist->counts = NULL;
+}
+
+#pragma endregion
+
+#pragma region Equi-depth histogram
+
+// Bin edges of an equi-depth histogram are quantiles of the data,
+// so all values have to be kept until the end, as with percentiles.
+typedef struct {
+    int nbins;
+    sqlite3_int64 n_alloc;
+    sqlite3_int64 n_used;
+    double* values;
+} DepthHistogram;
+
+// Collects the value. Ignores nulls.
+// histogram_equidepth(x, nbins)
+static void equidepth_step(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    assert(argc == 2);
+    DepthHistogram* hist = sqlite3_aggregate_context(ctx, sizeof(*hist));
+    if (!hist) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+
+    sqlite3_int64 nbins = sqlite3_value_int64(argv[1]);
+    if (hist->nbins == 0) {
+        if (nbins < 1 || nbins > HISTOGRAM_MAX_BINS) {
+            sqlite3_result_error(ctx, "histogram_equidepth: nbins should be between 1 and 100000",
+                                 -1);
+            return;
+        }
+        hist->nbins = (int)nbins;
+    } else if (nbins != hist->nbins) {
+        sqlite3_result_error(ctx, "histogram_equidepth: nbins should be the same for all rows", -1);
+        return;
+    }
+
+    if (sqlite3_value_numeric_type(argv[0]) == SQLITE_NULL) {
+        return;
+    }
+    double x = sqlite3_value_double(argv[0]);
+    if (isnan(x)) {
+        return;
+    }
+    if (hist->n_used >= hist->n_alloc) {
+        sqlite3_int64 n = hist->n_alloc * 2 + 250;
+        double* values = sqlite3_realloc64(hist->values, sizeof(double) * n);
+        if (!values) {
+            sqlite3_free(hist->values);
+            memset(hist, 0, sizeof(*hist));
+            sqlite3_result_error_nomem(ctx);
+            return;
+        }
+        hist->n_alloc = n;
+        hist->values = values;
+    }
+    hist->values[hist->n_used++] = x;
+}
+
+static int SQLITE_CDECL double_cmp(const void* pa, const void* pb) {
+    double a = *(const double*)pa;
+    double b = *(const double*)pb;
+    return (a > b) - (a < b);
+}
+
+// Returns the histogram as JSON. Edges are interpolated
+// quantiles of the data, the same way as in stats_perc().
+static void equidepth_final(sqlite3_context* ctx) {
+    DepthHistogram* hist = sqlite3_aggregate_context(ctx, 0);
+    if (!hist || !hist->values) {
+        return;
+    }
+    int nbins = hist->nbins;
+    sqlite3_int64 n = hist->n_used;
+    double* v = hist->values;
+    double* edges = sqlite3_malloc64(sizeof(*edges) * (nbins + 1));
+    sqlite3_int64* counts = sqlite3_malloc64(sizeof(*counts) * nbins);
+    if (!edges || !counts) {
+        sqlite3_free(edges);
+        sqlite3_free(counts);
+        sqlite3_free(hist->values);
+        hist->values = NULL;
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+
+    qsort(v, n, sizeof(double), double_cmp);
+    for (int i = 0; i <= nbins; i++) {
+        double ix = (double)i * (n - 1) / nbins;
+        sqlite3_int64 i1 = (sqlite3_int64)ix;
+        sqlite3_int64 i2 = i1 < n - 1 ? i1 + 1 : i1;
+        edges[i] = v[i1] + (v[i2] - v[i1]) * (ix - i1);
+    }
+    edges[nbins] = v[n - 1];
+
+    // values are sorted, so each bin takes a contiguous run of them
+    sqlite3_int64 j = 0;
+    for (int i = 0; i < nbins; i++) {
+        sqlite3_int64 start = j;
+        if (i == nbins - 1) {
+            j = n;
+        } else {
+            while (j < n && v[j] < edges[i + 1]) {
+                j++;
+            }
+        }
+        counts[i] = j - start;
+    }
+
+    result_histogram(ctx, edges, counts, nbins);
+    sqlite3_free(edges);
+    sqlite3_free(counts);
+    sqlite3_free(hist->values);
+    hist->values = NULL;
+}
+
+#pragma endregion
+
+#pragma region histogram_bins
+
+// skip_ws skips JSON whitespace.
+static const char* skip_ws(const char* z) {
+    while (*z == ' ' || *z == '\t' || *z == '\n' || *z == '\r') {
+        z++;
+    }
+    return z;
+}
+
+// skip_string skips the JSON string starting at the opening quote.
+// Returns the position after the closing quote, or NULL on error.
+static const char* skip_string(const char* z) {
+    if (*z++ != '"') {
+        return NULL;
+    }
+    while (*z != '"') {
+        if (*z == 0 || (unsigned char)*z < 0x20) {
+            return NULL;
+        }
+        if (*z == '\\' && *++z == 0) {
+            return NULL;
+        }
+        z++;
+    }
+    return z + 1;
+}
+
+// skip_value skips any JSON value. Strings are skipped as a whole,
+// so brackets inside them do not count. Returns the position after
+// the value, or NULL on error.
+static const char* skip_value(const char* z) {
+    int depth = 0;
+    do {
+        z = skip_ws(z);
+        if (*z == '"') {
+            z = skip_string(z);
+            if (!z) {
+                return NULL;
+            }
+        } else if (*z == '[' || *z == '{') {
+            depth++;
+            z++;
+        } else if ((*z == ']' || *z == '}') && depth > 0) {
+            depth--;
+            z++;
+        } else if (*z == ',' || *z == ':') {
+            if (depth == 0) {
+                return NULL;
+            }
+            z++;
+        } else {
+            const char* start = z;
+            while (*z && strchr(" \t\n\r,:[]{}\"", *z) == NULL) {
+                z++;
+            }
+            if (z == start) {
+                return NULL;
+            }
+        }
+    } while (depth > 0);
+    return z;
+}
+
+// parse_number parses the JSON number at z into *out. Unlike strtod(),
+// it does not depend on the locale: the decimal separator is always '.'.
+// Like sqlite3AtoF(), it keeps up to 19 significant digits and applies
+// the decimal exponent to them, which is exact for up to 15 digits
+// and exponents up to 22. Returns the position after the number,
+// or NULL if there is no valid number.
+static const char* parse_number(const char* z, double* out) {
+    static const double pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                   1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                   1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    int neg = 0;
+    if (*z == '-') {
+        neg = 1;
+        z++;
+    }
+    if (*z < '0' || *z > '9') {
+        return NULL;
+    }
+
+    // significant digits go to the mantissa, the rest shift the exponent
+    sqlite3_uint64 mant = 0;
+    int exp = 0;
+    int ndigits = 0;
+    if (*z == '0') {
+        z++;
+    } else {
+        for (; *z >= '0' && *z <= '9'; z++) {
+            if (ndigits < 19) {
+                mant = mant * 10 + (*z - '0');
+                ndigits++;
+            } else {
+                exp++;
+            }
+        }
+    }
+    if (*z == '.') {
+        z++;
+        if (*z < '0' || *z > '9') {
+            return NULL;
+        }
+        for (; *z >= '0' && *z <= '9'; z++) {
+            if (mant == 0 && *z == '0') {
+                exp--;
+            } else if (ndigits < 19) {
+                mant = mant * 10 + (*z - '0');
+                ndigits++;
+                exp--;
+            }
+        }
+    }
+    if (*z == 'e' || *z == 'E') {
+        z++;
+        int eneg = 0;
+        if (*z == '-' || *z == '+') {
+            eneg = *z == '-';
+            z++;
+        }
+        if (*z < '0' || *z > '9') {
+            return NULL;
+        }
+        int e = 0;
+        for (; *z >= '0' && *z <= '9'; z++) {
+            if (e < 10000) {
+                e = e * 10 + (*z - '0');
+            }
+        }
+        exp += eneg ? -e : e;
+    }
+
+    double value;
+    if (mant == 0) {
+        value = 0.0;
+    } else if (mant <= ((sqlite3_uint64)1 << 53) && exp >= -22 && exp <= 22) {
+        // both factors are exact, so the result is correctly rounded
+        value = exp < 0 ? (double)mant / pow10[-exp] : (double)mant * pow10[exp];
+    } else if (exp > 400) {
+        value = INFINITY;
+    } else if (exp < -400) {
+        value = 0.0;
+    } else {
+        long double r = (long double)mant;
+        if (exp < -300) {
+            r /= 1e300L;
+            exp += 300;
+        }
+        r = exp < 0 ? r / powl(10.0L, -exp) : r * powl(10.0L, exp);
+        value = (double)r;
+    }
+    *out = neg ? -value : value;
+    return z;
+}
+
+// parse_array parses the JSON array of numbers stored under the key
+// of the histogram object. Only the top-level keys are matched, so the key
+// text inside string values or nested objects does not count.
+// Returns the number of elements, or -1 on error.
+// The caller is responsible for freeing *out.
+static int parse_array(const char* json, const char* key, double** out) {
+    *out = NULL;
+    size_t key_len = strlen(key);
+    const char* z = skip_ws(json);
+    if (*z++ != '{') {
+        return -1;
+    }
+    z = skip_ws(z);
+    if (*z == '}') {
+        return -1;
+    }
+    for (;;) {
+        const char* name = z;
+        z = skip_string(z);
+        if (!z) {
+            return -1;
+        }
+        int found = (size_t)(z - name) == key_len + 2 && memcmp(name + 1, key, key_len) == 0;
+        z = skip_ws(z);
+        if (*z++ != ':') {
+            return -1;
+        }
+        z = skip_ws(z);
+        if (found) {
+            break;
+        }
+        z = skip_value(z);
+        if (!z) {
+            return -1;
+        }
+        z = skip_ws(z);
+        if (*z != ',') {
+            return -1;
+        }
+        z = skip_ws(z + 1);
+    }
+    if (*z++ != '[') {
+        return -1;
+    }
+
+    int n = 0, n_alloc = 0;
+    double* values = NULL;
+    for (;;) {
+        z = skip_ws(z);
+        if (*z == ']' && n == 0) {
+            break;
+        }
+        double value;
+        const char* end = parse_number(z, &value);
+        if (!end || n >= HISTOGRAM_MAX_BINS + 1) {
+            sqlite3_free(values);
+            return -1;
+        }
+        if (n >= n_alloc) {
+            n_alloc = n_alloc * 2 + 16;
+            double* grown = sqlite3_realloc64(values, sizeof(double) * n_alloc);
+            if (!grown) {
+                sqlite3_free(values);
+                return -1;
+            }
+            values = grown;
+        }
+        values[n++] = value;
+        z = skip_ws(end);
+        if (*z == ']') {
+            break;
+        }
+        if (*z++ != ',') {
+            sqlite3_free(values);
+            return -1;
+        }
+    }
+    *out = values;
+    return n;
+}
+
+/* Column numbers */
+#define BINS_COLUMN_BIN 0
+#define BINS_COLUMN_LO 1
+#define BINS_COLUMN_HI 2
+#define BINS_COLUMN_COUNT 3
+#define BINS_COLUMN_HIST 4
+
+typedef struct bins_cursor bins_cursor;
+struct bins_cursor {
+    sqlite3_vtab_cursor base; /* Base class - must be first */
+    int iBin;                 /* Current bin (0-based) */
+    int nBins;                /* Number of bins */
+    double* aEdges;           /* nBins+1 bin edges */
+    double* aCounts;          /* nBins counts */
+};
+
+static int binsConnect(sqlite3* db,
+                       void* pUnused,
+                       int argcUnused,
+                       const char* const* argvUnused,
+                       sqlite3_vtab** ppVtab,
+                       char** pzErrUnused) {
+    sqlite3_vtab* pNew;
+    int rc;
+    (void)pUnused;
+    (void)argcUnused;
+    (void)argvUnused;
+    (void)pzErrUnused;
+    rc = sqlite3_declare_vtab(db, "CREATE TABLE x(bin,lo,hi,count,hist hidden)");
+    if (rc == SQLITE_OK) {
+        pNew = *ppVtab = sqlite3_malloc(sizeof(*pNew));
+        if (pNew == 0)
+            return SQLITE_NOMEM;
+        memset(pNew, 0, sizeof(*pNew));
+        sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+    }
+    return rc;
+}
+
+static int binsDisconnect(sqlite3_vtab* pVtab) {
+    sqlite3_free(pVtab);
+    return SQLITE_OK;
+}
+
+static int binsOpen(sqlite3_vtab* pUnused, sqlite3_vtab_cursor** ppCursor) {
+    bins_cursor* pCur;
+    (void)pUnused;
+    pCur = sqlite3_malloc(sizeof(*pCur));
+    if (pCur == 0)
+        return SQLITE_NOMEM;
+    memset(pCur, 0, sizeof(*pCur));
+    *ppCursor = &pCur->base;
+    return SQLITE_OK;
+}
+
+static void binsReset(bins_cursor* pCur) {
+    sqlite3_free(pCur->aEdges);
+    sqlite3_free(pCur->aCounts);
+    pCur->aEdges = 0;
+    pCur->aCounts = 0;
+    pCur->nBins = 0;
+    pCur->iBin = 0;
+}
+
+static int binsClose(sqlite3_vtab_cursor* cur) {
+    binsReset((bins_cursor*)cur);
+    sqlite3_free(cur);
+    return SQLITE_OK;
+}
+
+static int binsNext(sqlite3_vtab_cursor* cur) {
+    ((bins_cursor*)cur)->iBin++;
+    return SQLITE_OK;
+}
+
+static int binsEof(sqlite3_vtab_cursor* cur) {
+    bins_cursor* pCur = (bins_cursor*)cur;
+    return pCur->iBin >= pCur->nBins;
+}
+
+static int binsColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int i) {
+    bins_cursor* pCur = (bins_cursor*)cur;
+    switch (i) {
+        case BINS_COLUMN_BIN:
+            sqlite3_result_int(ctx, pCur->iBin + 1);
+            break;
+        case BINS_COLUMN_LO:
+            sqlite3_result_double(ctx, pCur->aEdges[pCur->iBin]);
+            break;
+        case BINS_COLUMN_HI:
+            sqlite3_result_double(ctx, pCur->aEdges[pCur->iBin + 1]);
+            break;
+        case BINS_COLUMN_COUNT:
+            sqlite3_result_int64(ctx, (sqlite3_int64)pCur->aCounts[pCur->iBin]);
+            break;
+        default:
+            sqlite3_result_null(ctx);
+            break;
+    }
+    return SQLITE_OK;
+}
+
+static int binsRowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
+    *pRowid = ((bins_cursor*)cur)->iBin + 1;
+    return SQLITE_OK;
+}
+
+static int binsFilter(sqlite3_vtab_cursor* pVtabCursor,
+                      int idxNum,
+                      const char* idxStrUnused,
+                      int argc,
+                      sqlite3_value** argv) {
+    bins_cursor* pCur = (bins_cursor*)pVtabCursor;
+    (void)idxStrUnused;
+    binsReset(pCur);
+    if (idxNum == 0 || argc != 1 || sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        return SQLITE_OK;
+    }
+
+    const char* zHist = (const char*)sqlite3_value_text(argv[0]);
+    int nEdges = parse_array(zHist, "edges", &pCur->aEdges);
+    int nCounts = parse_array(zHist, "counts", &pCur->aCounts);
+    if (nEdges < 2 || nCounts != nEdges - 1) {
+        binsReset(pCur);
+        sqlite3_free(pVtabCursor->pVtab->zErrMsg);
+        pVtabCursor->pVtab->zErrMsg = sqlite3_mprintf("histogram_bins: invalid histogram");
+        return SQLITE_ERROR;
+    }
+    pCur->nBins = nCounts;
+    return SQLITE_OK;
+}
+
+static int binsBestIndex(sqlite3_vtab* pVTab, sqlite3_index_info* pIdxInfo) {
+    const struct sqlite3_index_constraint* pConstraint = pIdxInfo->aConstraint;
+    for (int i = 0; i < pIdxInfo->nConstraint; i++, pConstraint++) {
+        if (pConstraint->iColumn != BINS_COLUMN_HIST) {
+            continue;
+        }
+        if (!pConstraint->usable || pConstraint->op != SQLITE_INDEX_CONSTRAINT_EQ) {
+            return SQLITE_CONSTRAINT;
+        }
+        pIdxInfo->aConstraintUsage[i].argvIndex = 1;
+        pIdxInfo->aConstraintUsage[i].omit = 1;
+        pIdxInfo->idxNum = 1;
+        pIdxInfo->estimatedCost = 1;
+        pIdxInfo->estimatedRows = 100;
+        return SQLITE_OK;
+    }
+    sqlite3_free(pVTab->zErrMsg);
+    pVTab->zErrMsg = sqlite3_mprintf("histogram_bins: missing histogram argument");
+    return SQLITE_ERROR;
+}
+
+static sqlite3_module bins_module = {
+    .xConnect = binsConnect,
+    .xBestIndex = binsBestIndex,
+    .xDisconnect = binsDisconnect,
+    .xOpen = binsOpen,
+    .xClose = binsClose,
+    .xFilter = binsFilter,
+    .xNext = binsNext,
+    .xEof = binsEof,
+    .xColumn = binsColumn,
+    .xRowid = binsRowid,
+};
+
+#pragma endregion
+
+int stats_histogram_init(sqlite3* db) {
+    static const int flags = SQLITE_UTF8 | SQLITE_INNOCUOUS;
+    sqlite3_create_function(db, "histogram", 4, flags, 0, 0, histogram_step, histogram_final);
+    sqlite3_create_function(db, "histogram_equidepth", 2, flags, 0, 0, equidepth_step,
+                            equidepth_final);
+    sqlite3_create_module(db, "histogram_bins", &bins_module, 0);
+    return SQLITE_OK;
+}
@@ -0,0 +1,306 @@
+// Copyright (c) 2023 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Approximate distinct count with HyperLogLog sketches.
+//
+// Uses 2^14 one-byte registers fed by a 64-bit hash, and the improved
+// raw estimator by Otmar Ertl, which needs neither bias correction
+// tables nor a switch to linear counting for small cardinalities.
+// https://arxiv.org/abs/1702.01284
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sqlite3ext.h"
+SQLITE_EXTENSION_INIT3
+
+#define HLL_PRECISION 14
+#define HLL_REGISTERS (1 << HLL_PRECISION)
+#define HLL_MAX_RANK (64 - HLL_PRECISION + 1)
+
+// Serialized sketch: magic byte, format version, precision, registers.
+#define HLL_MAGIC 'H'
+#define HLL_VERSION 1
+#define HLL_HEADER_SIZE 3
+#define HLL_BLOB_SIZE (HLL_HEADER_SIZE + HLL_REGISTERS)
+
+typedef struct {
+    uint8_t reg[HLL_REGISTERS];
+} Sketch;
+
+#pragma region Hashing
+
+// MurmurHash64A by Austin Appleby, Public Domain.
+static uint64_t murmur64(const void* key, int len, uint64_t seed) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    const int r = 47;
+    const uint8_t* data = (const uint8_t*)key;
+    const uint8_t* end = data + (len - len % 8);
+    uint64_t h = seed ^ (len * m);
+
+    while (data != end) {
+        uint64_t k;
+        memcpy(&k, data, sizeof(k));
+        data += 8;
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+    }
+
+    switch (len & 7) {
+        case 7:
+            h ^= (uint64_t)data[6] << 48;
+            /* fall through */
+        case 6:
+            h ^= (uint64_t)data[5] << 40;
+            /* fall through */
+        case 5:
+            h ^= (uint64_t)data[4] << 32;
+            /* fall through */
+        case 4:
+            h ^= (uint64_t)data[3] << 24;
+            /* fall through */
+        case 3:
+            h ^= (uint64_t)data[2] << 16;
+            /* fall through */
+        case 2:
+            h ^= (uint64_t)data[1] << 8;
+            /* fall through */
+        case 1:
+            h ^= (uint64_t)data[0];
+            h *= m;
+    }
+
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+// hash_value returns a 64-bit hash of the value. Values that compare
+// equal in SQL (e.g. 1 and 1.0) hash to the same result.
+static uint64_t hash_value(sqlite3_value* value) {
+    switch (sqlite3_value_type(value)) {
+        case SQLITE_INTEGER: {
+            int64_t i = sqlite3_value_int64(value);
+            return murmur64(&i, sizeof(i), SQLITE_INTEGER);
+        }
+        case SQLITE_FLOAT: {
+            double r = sqlite3_value_double(value);
+            if (r >= -9223372036854775808.0 && r < 9223372036854775808.0 && r == (int64_t)r) {
+                int64_t i = (int64_t)r;
+                return murmur64(&i, sizeof(i), SQLITE_INTEGER);
+            }
+            return murmur64(&r, sizeof(r), SQLITE_FLOAT);
+        }
+        case SQLITE_TEXT: {
+            const unsigned char* text = sqlite3_value_text(value);
+            return murmur64(text, sqlite3_value_bytes(value), SQLITE_TEXT);
+        }
+        default: {
+            const void* blob = sqlite3_value_blob(value);
+            return murmur64(blob, sqlite3_value_bytes(value), SQLITE_BLOB);
+        }
+    }
+}
+
+#pragma endregion
+
+#pragma region Sketch
+
+// sketch_add registers a hashed value in the sketch.
+static void sketch_add(Sketch* sketch, uint64_t hash) {
+    uint32_t idx = (uint32_t)(hash >> (64 - HLL_PRECISION));
+    uint64_t rest = hash << HLL_PRECISION;
+    uint8_t rank = 1;
+    while (rank < HLL_MAX_RANK && (rest & 0x8000000000000000ULL) == 0) {
+        rest <<= 1;
+        rank++;
+    }
+    if (rank > sketch->reg[idx]) {
+        sketch->reg[idx] = rank;
+    }
+}
+
+// sketch_merge adds all values registered in src to dst.
+static void sketch_merge(Sketch* dst, const uint8_t* src) {
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        dst->reg[i] = src[i] > dst->reg[i] ? src[i] : dst->reg[i];
+    }
+}
+
+static double hll_sigma(double x) {
+    if (x == 1.0) {
+        return INFINITY;
+    }
+    double y = 1.0;
+    double z = x;
+    double prev;
+    do {
+        x *= x;
+        prev = z;
+        z += x * y;
+        y += y;
+    } while (z != prev);
+    return z;
+}
+
+static double hll_tau(double x) {
+    if (x == 0.0 || x == 1.0) {
+        return 0.0;
+    }
+    double y = 1.0;
+    double z = 1.0 - x;
+    double prev;
+    do {
+        x = sqrt(x);
+        prev = z;
+        y *= 0.5;
+        z -= (1.0 - x) * (1.0 - x) * y;
+    } while (z != prev);
+    return z / 3.0;
+}
+
+// sketch_estimate returns the estimated number of distinct values.
+static int64_t sketch_estimate(const uint8_t* reg) {
+    int counts[HLL_MAX_RANK + 1] = {0};
+    for (int i = 0; i < HLL_REGISTERS; i++) {
+        counts[reg[i]]++;
+    }
+    if (counts[0] == HLL_REGISTERS) {
+        return 0;
+    }
+    const double m = HLL_REGISTERS;
+    double z = m * hll_tau(1.0 - counts[HLL_MAX_RANK] / m);
+    for (int k = HLL_MAX_RANK - 1; k >= 1; k--) {
+        z = 0.5 * (z + counts[k]);
+    }
+    z += m * hll_sigma(counts[0] / m);
+    return (int64_t)llround(m * m / (2.0 * log(2.0)) / z);
+}
+
+// sketch_from_blob validates a serialized sketch
+// and returns a pointer to its registers, or NULL if it is invalid.
+static const uint8_t* sketch_from_blob(sqlite3_value* value) {
+    if (sqlite3_value_type(value) != SQLITE_BLOB) {
+        return NULL;
+    }
+    const uint8_t* blob = sqlite3_value_blob(value);
+    if (sqlite3_value_bytes(value) != HLL_BLOB_SIZE || blob[0] != HLL_MAGIC ||
+        blob[1] != HLL_VERSION || blob[2] != HLL_PRECISION) {
+        return NULL;
+    }
+    for (int i = HLL_HEADER_SIZE; i < HLL_BLOB_SIZE; i++) {
+        if (blob[i] > HLL_MAX_RANK) {
+            return NULL;
+        }
+    }
+    return blob + HLL_HEADER_SIZE;
+}
+
+// result_sketch returns the serialized sketch as a function result.
+static void result_sketch(sqlite3_context* ctx, const Sketch* sketch) {
+    uint8_t* blob = sqlite3_malloc(HLL_BLOB_SIZE);
+    if (!blob) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    blob[0] = HLL_MAGIC;
+    blob[1] = HLL_VERSION;
+    blob[2] = HLL_PRECISION;
+    memcpy(blob + HLL_HEADER_SIZE, sketch->reg, HLL_REGISTERS);
+    sqlite3_result_blob(ctx, blob, HLL_BLOB_SIZE, sqlite3_free);
+}
+
+#pragma endregion
+
+#pragma region SQL functions
+
+// Adds a value to the aggregate sketch. Ignores nulls.
+static void hll_add_step(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    assert(argc == 1);
+    Sketch* sketch = sqlite3_aggregate_context(ctx, sizeof(*sketch));
+    if (!sketch) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        return;
+    }
+    sketch_add(sketch, hash_value(argv[0]));
+}
+
+// Merges a serialized sketch into the aggregate sketch. Ignores nulls.
+static void hll_merge_step(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    assert(argc == 1);
+    Sketch* sketch = sqlite3_aggregate_context(ctx, sizeof(*sketch));
+    if (!sketch) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        return;
+    }
+    const uint8_t* reg = sketch_from_blob(argv[0]);
+    if (!reg) {
+        sqlite3_result_error(ctx, "hll_merge: invalid sketch", -1);
+        return;
+    }
+    sketch_merge(sketch, reg);
+}
+
+// Returns the estimated number of distinct values.
+// count_distinct_approx(x)
+static void hll_count_final(sqlite3_context* ctx) {
+    Sketch* sketch = sqlite3_aggregate_context(ctx, 0);
+    if (!sketch) {
+        sqlite3_result_int64(ctx, 0);
+        return;
+    }
+    sqlite3_result_int64(ctx, sketch_estimate(sketch->reg));
+}
+
+// Returns the serialized sketch.
+// hll_sketch(x)
+// hll_merge(sketch)
+static void hll_sketch_final(sqlite3_context* ctx) {
+    Sketch* sketch = sqlite3_aggregate_context(ctx, sizeof(*sketch));
+    if (!sketch) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    result_sketch(ctx, sketch);
+}
+
+// Returns the estimated number of distinct values in a serialized sketch.
+// hll_count(sketch)
+static void hll_count(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    assert(argc == 1);
+    if (sqlite3_value_type(argv[0]) == SQLITE_NULL) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+    const uint8_t* reg = sketch_from_blob(argv[0]);
+    if (!reg) {
+        sqlite3_result_error(ctx, "hll_count: invalid sketch", -1);
+        return;
+    }
+    sqlite3_result_int64(ctx, sketch_estimate(reg));
+}
+
+#pragma endregion
+
+int stats_hll_init(sqlite3* db) {
+    static const int flags = SQLITE_UTF8 | SQLITE_INNOCUOUS;
+    static const int det_flags = SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC;
+    sqlite3_create_function(db, "count_distinct_approx", 1, flags, 0, 0, hll_add_step,
+                            hll_count_final);
+    sqlite3_create_function(db, "hll_sketch", 1, flags, 0, 0, hll_add_step, hll_sketch_final);
+    sqlite3_create_function(db, "hll_merge", 1, flags, 0, 0, hll_merge_step, hll_sketch_final);
+    sqlite3_create_function(db, "hll_count", 1, det_flags, 0, hll_count, 0, 0);
+    return SQLITE_OK;
+}
@@ -0,0 +1,570 @@
+// Copyright (c) 2023 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// stats_range function: a generate_series variant for real numbers
+// and timestamps.
+//
+// The n-th value is computed as start + n*step rather than by repeated
+// addition, so rounding errors do not accumulate, and the cursor can
+// jump straight to the slice of the range selected by value constraints,
+// LIMIT and OFFSET.
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sqlite3ext.h"
+SQLITE_EXTENSION_INIT3
+
+/* Column numbers */
+#define RANGE_COLUMN_VALUE 0
+#define RANGE_COLUMN_START 1
+#define RANGE_COLUMN_STOP 2
+#define RANGE_COLUMN_STEP 3
+
+/* Query plan bits (idxNum) */
+#define RANGE_START 1     /* start = $value */
+#define RANGE_STOP 2      /* stop = $value */
+#define RANGE_STEP 4      /* step = $value */
+#define RANGE_LOWER 8     /* value > $value or value >= $value */
+#define RANGE_UPPER 16    /* value < $value or value <= $value */
+#define RANGE_EQUAL 32    /* value = $value */
+#define RANGE_LIMIT 64    /* LIMIT $value */
+#define RANGE_OFFSET 128  /* OFFSET $value */
+#define RANGE_REVERSE 256 /* output in reverse order */
+#define RANGE_ROWID 512   /* output ordered by rowid rather than by value */
+
+/* Largest supported number of steps */
+#define RANGE_MAX_INDEX ((sqlite3_int64)1 << 53)
+
+/* Default step for timestamp ranges, in seconds */
+#define RANGE_DAY 86400.0
+
+typedef struct range_cursor range_cursor;
+struct range_cursor {
+    sqlite3_vtab_cursor base; /* Base class - must be first */
+    int isTime;               /* True if start and stop are timestamps */
+    int hasFraction;          /* True to print timestamps with milliseconds */
+    int isReverse;            /* True to output from the last index to the first */
+    sqlite3_value* pStart;    /* Original "start" argument */
+    sqlite3_value* pStop;     /* Original "stop" argument */
+    double rStart;            /* Start value (unix seconds for timestamps) */
+    double rStep;             /* Increment */
+    sqlite3_int64 iFirst;     /* First index to output */
+    sqlite3_int64 iLast;      /* Last index to output */
+    sqlite3_int64 iIndex;     /* Current index */
+};
+
+#pragma region Timestamps
+
+// days_from_civil returns the number of days since 1970-01-01
+// for a proleptic Gregorian date.
+// http://howardhinnant.github.io/date_algorithms.html
+static sqlite3_int64 days_from_civil(sqlite3_int64 y, int m, int d) {
+    y -= m <= 2;
+    sqlite3_int64 era = (y >= 0 ? y : y - 399) / 400;
+    sqlite3_int64 yoe = y - era * 400;
+    sqlite3_int64 doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    sqlite3_int64 doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// civil_from_days is the inverse of days_from_civil.
+static void civil_from_days(sqlite3_int64 z, sqlite3_int64* y, int* m, int* d) {
+    z += 719468;
+    sqlite3_int64 era = (z >= 0 ? z : z - 146096) / 146097;
+    sqlite3_int64 doe = z - era * 146097;
+    sqlite3_int64 yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    sqlite3_int64 doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    sqlite3_int64 mp = (5 * doy + 2) / 153;
+    *d = (int)(doy - (153 * mp + 2) / 5 + 1);
+    *m = (int)(mp < 10 ? mp + 3 : mp - 9);
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+// parse_time parses 'YYYY-MM-DD[( |T)HH:MM[:SS[.fff]]][Z]' into unix seconds.
+// Returns 0 on success, -1 if the string is not a valid timestamp.
+static int parse_time(const char* s, double* seconds, int* hasFraction) {
+    int y, m, d, hh = 0, mm = 0, n = 0;
+    double ss = 0;
+    if (!s || sscanf(s, "%4d-%2d-%2d%n", &y, &m, &d, &n) != 3 || n != 10) {
+        return -1;
+    }
+    s += n;
+    if (*s == ' ' || *s == 'T') {
+        if (sscanf(s + 1, "%2d:%2d%n", &hh, &mm, &n) != 2 || n != 5) {
+            return -1;
+        }
+        s += 1 + n;
+        if (*s == ':') {
+            char* end;
+            ss = strtod(s + 1, &end);
+            if (end == s + 1) {
+                return -1;
+            }
+            if (ss != floor(ss) && hasFraction) {
+                *hasFraction = 1;
+            }
+            s = end;
+        }
+    }
+    if (*s == 'Z') {
+        s++;
+    }
+    if (*s != '\0' || m < 1 || m > 12 || d < 1 || d > 31 || hh > 23 || mm > 59 || ss >= 60) {
+        return -1;
+    }
+    *seconds = (double)days_from_civil(y, m, d) * RANGE_DAY + hh * 3600 + mm * 60 + ss;
+    return 0;
+}
+
+// format_time formats unix seconds as 'YYYY-MM-DD HH:MM:SS[.SSS]'.
+static char* format_time(double seconds, int hasFraction) {
+    double whole = floor(seconds);
+    int millis = (int)llround((seconds - whole) * 1000.0);
+    if (millis == 1000) {
+        whole += 1;
+        millis = 0;
+    }
+    sqlite3_int64 secs = (sqlite3_int64)whole;
+    sqlite3_int64 days = secs / 86400 - (secs % 86400 < 0);
+    sqlite3_int64 rem = secs - days * 86400;
+    sqlite3_int64 y;
+    int m, d;
+    civil_from_days(days, &y, &m, &d);
+    if (hasFraction) {
+        return sqlite3_mprintf("%04lld-%02d-%02d %02d:%02d:%02d.%03d", y, m, d, (int)(rem / 3600),
+                               (int)(rem % 3600 / 60), (int)(rem % 60), millis);
+    }
+    return sqlite3_mprintf("%04lld-%02d-%02d %02d:%02d:%02d", y, m, d, (int)(rem / 3600),
+                           (int)(rem % 3600 / 60), (int)(rem % 60));
+}
+
+#pragma endregion
+
+#pragma region Virtual table
+
+/*
+** Declares the virtual table schema and allocates the vtab object.
+*/
+static int rangeConnect(sqlite3* db,
+                        void* pUnused,
+                        int argcUnused,
+                        const char* const* argvUnused,
+                        sqlite3_vtab** ppVtab,
+                        char** pzErrUnused) {
+    sqlite3_vtab* pNew;
+    int rc;
+    (void)pUnused;
+    (void)argcUnused;
+    (void)argvUnused;
+    (void)pzErrUnused;
+    rc = sqlite3_declare_vtab(db, "CREATE TABLE x(value,start hidden,stop hidden,step hidden)");
+    if (rc == SQLITE_OK) {
+        pNew = *ppVtab = sqlite3_malloc(sizeof(*pNew));
+        if (pNew == 0)
+            return SQLITE_NOMEM;
+        memset(pNew, 0, sizeof(*pNew));
+        sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+    }
+    return rc;
+}
+
+static int rangeDisconnect(sqlite3_vtab* pVtab) {
+    sqlite3_free(pVtab);
+    return SQLITE_OK;
+}
+
+static int rangeOpen(sqlite3_vtab* pUnused, sqlite3_vtab_cursor** ppCursor) {
+    range_cursor* pCur;
+    (void)pUnused;
+    pCur = sqlite3_malloc(sizeof(*pCur));
+    if (pCur == 0)
+        return SQLITE_NOMEM;
+    memset(pCur, 0, sizeof(*pCur));
+    *ppCursor = &pCur->base;
+    return SQLITE_OK;
+}
+
+static void rangeReset(range_cursor* pCur) {
+    sqlite3_value_free(pCur->pStart);
+    sqlite3_value_free(pCur->pStop);
+    pCur->pStart = 0;
+    pCur->pStop = 0;
+}
+
+static int rangeClose(sqlite3_vtab_cursor* cur) {
+    rangeReset((range_cursor*)cur);
+    sqlite3_free(cur);
+    return SQLITE_OK;
+}
+
+static int rangeNext(sqlite3_vtab_cursor* cur) {
+    range_cursor* pCur = (range_cursor*)cur;
+    if (pCur->isReverse) {
+        pCur->iIndex--;
+    } else {
+        pCur->iIndex++;
+    }
+    return SQLITE_OK;
+}
+
+static int rangeEof(sqlite3_vtab_cursor* cur) {
+    range_cursor* pCur = (range_cursor*)cur;
+    return pCur->iIndex < pCur->iFirst || pCur->iIndex > pCur->iLast;
+}
+
+static int rangeColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int i) {
+    range_cursor* pCur = (range_cursor*)cur;
+    switch (i) {
+        case RANGE_COLUMN_START:
+            sqlite3_result_value(ctx, pCur->pStart);
+            break;
+        case RANGE_COLUMN_STOP:
+            sqlite3_result_value(ctx, pCur->pStop);
+            break;
+        case RANGE_COLUMN_STEP:
+            sqlite3_result_double(ctx, pCur->rStep);
+            break;
+        default: {
+            double value = pCur->rStart + (double)pCur->iIndex * pCur->rStep;
+            if (pCur->isTime) {
+                char* zTime = format_time(value, pCur->hasFraction);
+                if (zTime == 0)
+                    return SQLITE_NOMEM;
+                sqlite3_result_text(ctx, zTime, -1, sqlite3_free);
+            } else {
+                sqlite3_result_double(ctx, value);
+            }
+            break;
+        }
+    }
+    return SQLITE_OK;
+}
+
+/*
+** The rowid is the 1-based position of the value in the full range,
+** regardless of which slice of the range the cursor outputs.
+*/
+static int rangeRowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
+    range_cursor* pCur = (range_cursor*)cur;
+    *pRowid = pCur->iIndex + 1;
+    return SQLITE_OK;
+}
+
+/*
+** Converts a value constraint into the same scale as the range values.
+** Returns 0 on success, -1 if the constraint cannot narrow the range
+** (in which case SQLite still filters the rows itself).
+*/
+static int rangeBound(range_cursor* pCur, sqlite3_value* pVal, double* pBound) {
+    if (pCur->isTime) {
+        if (sqlite3_value_type(pVal) != SQLITE_TEXT)
+            return -1;
+        return parse_time((const char*)sqlite3_value_text(pVal), pBound, 0);
+    }
+    int eType = sqlite3_value_type(pVal);
+    if (eType != SQLITE_INTEGER && eType != SQLITE_FLOAT)
+        return -1;
+    *pBound = sqlite3_value_double(pVal);
+    return 0;
+}
+
+/*
+** Narrows [iFirst, iLast] to indexes whose values may lie in [rLo, rHi].
+** The result is widened by one step on each side, because value
+** constraints are not omitted: SQLite re-checks every row anyway, so
+** rounding and timestamp text comparison quirks can never drop a row.
+*/
+static void rangeNarrow(range_cursor* pCur, double rLo, double rHi) {
+    double a = (rLo - pCur->rStart) / pCur->rStep;
+    double b = (rHi - pCur->rStart) / pCur->rStep;
+    double lo = (a < b ? a : b) - 1;
+    double hi = (a < b ? b : a) + 1;
+    if (lo > (double)pCur->iFirst) {
+        pCur->iFirst = lo > (double)pCur->iLast ? pCur->iLast + 1 : (sqlite3_int64)ceil(lo);
+    }
+    if (hi < (double)pCur->iLast) {
+        pCur->iLast = hi < (double)pCur->iFirst ? pCur->iFirst - 1 : (sqlite3_int64)floor(hi);
+    }
+}
+
+/*
+** Positions the cursor at the first row of output.
+**
+** The query plan selected by rangeBestIndex is passed in idxNum,
+** see the RANGE_* bits. Arguments come in the order of the bits.
+*/
+static int rangeFilter(sqlite3_vtab_cursor* pVtabCursor,
+                       int idxNum,
+                       const char* idxStrUnused,
+                       int argc,
+                       sqlite3_value** argv) {
+    range_cursor* pCur = (range_cursor*)pVtabCursor;
+    sqlite3_vtab* pVtab = pVtabCursor->pVtab;
+    sqlite3_value* pStart = 0;
+    sqlite3_value* pStop = 0;
+    sqlite3_value* pStep = 0;
+    sqlite3_value* pLower = 0;
+    sqlite3_value* pUpper = 0;
+    sqlite3_int64 nLimit = -1;
+    sqlite3_int64 nOffset = 0;
+    int i = 0;
+    (void)idxStrUnused;
+    (void)argc;
+
+    rangeReset(pCur);
+    if (idxNum & RANGE_START)
+        pStart = argv[i++];
+    if (idxNum & RANGE_STOP)
+        pStop = argv[i++];
+    if (idxNum & RANGE_STEP)
+        pStep = argv[i++];
+    if (idxNum & RANGE_EQUAL) {
+        pLower = pUpper = argv[i++];
+    } else {
+        if (idxNum & RANGE_LOWER)
+            pLower = argv[i++];
+        if (idxNum & RANGE_UPPER)
+            pUpper = argv[i++];
+    }
+    if (idxNum & RANGE_LIMIT)
+        nLimit = sqlite3_value_int64(argv[i++]);
+    if (idxNum & RANGE_OFFSET)
+        nOffset = sqlite3_value_int64(argv[i++]);
+
+    /* Start with an empty range */
+    pCur->iFirst = 0;
+    pCur->iLast = -1;
+    pCur->iIndex = 0;
+    pCur->isReverse = 0;
+
+    pCur->pStart = sqlite3_value_dup(pStart);
+    pCur->pStop = sqlite3_value_dup(pStop);
+    if ((pStart && !pCur->pStart) || (pStop && !pCur->pStop))
+        return SQLITE_NOMEM;
+
+    /* If any of the arguments is NULL, return no rows */
+    if (!pStart || !pStop || sqlite3_value_type(pStart) == SQLITE_NULL ||
+        sqlite3_value_type(pStop) == SQLITE_NULL ||
+        (pStep && sqlite3_value_type(pStep) == SQLITE_NULL)) {
+        return SQLITE_OK;
+    }
+
+    double rStop;
+    pCur->isTime = sqlite3_value_type(pStart) == SQLITE_TEXT;
+    pCur->hasFraction = 0;
+    if (pCur->isTime) {
+        if (parse_time((const char*)sqlite3_value_text(pStart), &pCur->rStart,
+                       &pCur->hasFraction) != 0 ||
+            parse_time((const char*)sqlite3_value_text(pStop), &rStop, &pCur->hasFraction) != 0) {
+            sqlite3_free(pVtab->zErrMsg);
+            pVtab->zErrMsg = sqlite3_mprintf(
+                "stats_range: start and stop must be numbers or 'YYYY-MM-DD HH:MM:SS' timestamps");
+            return SQLITE_ERROR;
+        }
+    } else {
+        pCur->rStart = sqlite3_value_double(pStart);
+        rStop = sqlite3_value_double(pStop);
+    }
+
+    pCur->rStep = pStep ? sqlite3_value_double(pStep) : (pCur->isTime ? RANGE_DAY : 1.0);
+    if (pCur->rStep == 0 || !isfinite(pCur->rStep) || !isfinite(pCur->rStart) ||
+        !isfinite(rStop)) {
+        sqlite3_free(pVtab->zErrMsg);
+        pVtab->zErrMsg = sqlite3_mprintf("stats_range: step must be a non-zero finite number");
+        return SQLITE_ERROR;
+    }
+    if (pCur->isTime && pCur->rStep != floor(pCur->rStep)) {
+        pCur->hasFraction = 1;
+    }
+
+    /* The small epsilon keeps the stop value when (stop-start)/step
+    ** is an integer but rounds down to a fraction below it */
+    double rCount = (rStop - pCur->rStart) / pCur->rStep;
+    if (rCount < 0) {
+        return SQLITE_OK;
+    }
+    rCount = floor(rCount + 1e-9);
+    pCur->iLast = rCount > (double)RANGE_MAX_INDEX ? RANGE_MAX_INDEX : (sqlite3_int64)rCount;
+
+    double rLo, rHi;
+    if (pLower && rangeBound(pCur, pLower, &rLo) == 0) {
+        rangeNarrow(pCur, rLo, INFINITY);
+    }
+    if (pUpper && rangeBound(pCur, pUpper, &rHi) == 0) {
+        rangeNarrow(pCur, -INFINITY, rHi);
+    }
+
+    /* The output order is ascending by value unless the plan says
+    ** otherwise, so a negative step flips the index direction.
+    ** Rowids follow the index, whatever the sign of the step */
+    int isDescending = pCur->rStep < 0 && (idxNum & RANGE_ROWID) == 0;
+    pCur->isReverse = ((idxNum & RANGE_REVERSE) != 0) != isDescending;
+
+    if (nOffset > 0) {
+        if (pCur->isReverse) {
+            pCur->iLast = nOffset > pCur->iLast - pCur->iFirst ? pCur->iFirst - 1
+                                                               : pCur->iLast - nOffset;
+        } else {
+            pCur->iFirst = nOffset > pCur->iLast - pCur->iFirst ? pCur->iLast + 1
+                                                                : pCur->iFirst + nOffset;
+        }
+    }
+    if (nLimit >= 0 && nLimit <= pCur->iLast - pCur->iFirst) {
+        if (pCur->isReverse) {
+            pCur->iFirst = pCur->iLast - nLimit + 1;
+        } else {
+            pCur->iLast = pCur->iFirst + nLimit - 1;
+        }
+    }
+    pCur->iIndex = pCur->isReverse ? pCur->iLast : pCur->iFirst;
+    return SQLITE_OK;
+}
+
+/*
+** Chooses the query plan. start and stop are required arguments.
+** Value range and equality constraints narrow the generated slice
+** but are left for SQLite to double-check. An ORDER BY of the value
+** or of the rowid alone is consumed. LIMIT and OFFSET are consumed
+** only when no other constraint could filter rows out, and there is
+** no ORDER BY left for SQLite to sort the rows by.
+*/
+static int rangeBestIndex(sqlite3_vtab* pVTab, sqlite3_index_info* pIdxInfo) {
+    int idxNum = 0;
+    int unusableMask = 0;
+    int hasFilter = 0; /* True if some constraint is checked by SQLite */
+    int aIdx[3] = {-1, -1, -1};
+    int iLower = -1, iUpper = -1, iEqual = -1, iLimit = -1, iOffset = -1;
+    int nArg = 0;
+    int i;
+    const struct sqlite3_index_constraint* pConstraint = pIdxInfo->aConstraint;
+
+    for (i = 0; i < pIdxInfo->nConstraint; i++, pConstraint++) {
+        unsigned char op = pConstraint->op;
+#ifdef SQLITE_INDEX_CONSTRAINT_LIMIT
+        if (op == SQLITE_INDEX_CONSTRAINT_LIMIT || op == SQLITE_INDEX_CONSTRAINT_OFFSET) {
+            if (pConstraint->usable) {
+                if (op == SQLITE_INDEX_CONSTRAINT_LIMIT)
+                    iLimit = i;
+                else
+                    iOffset = i;
+            }
+            continue;
+        }
+#endif
+        if (pConstraint->iColumn >= RANGE_COLUMN_START) {
+            int iCol = pConstraint->iColumn - RANGE_COLUMN_START;
+            if (pConstraint->usable == 0) {
+                unusableMask |= 1 << iCol;
+            } else if (op == SQLITE_INDEX_CONSTRAINT_EQ) {
+                idxNum |= 1 << iCol;
+                aIdx[iCol] = i;
+            } else {
+                hasFilter = 1;
+            }
+            continue;
+        }
+        hasFilter = 1;
+        if (!pConstraint->usable || pConstraint->iColumn != RANGE_COLUMN_VALUE)
+            continue;
+        switch (op) {
+            case SQLITE_INDEX_CONSTRAINT_EQ:
+                iEqual = i;
+                break;
+            case SQLITE_INDEX_CONSTRAINT_GT:
+            case SQLITE_INDEX_CONSTRAINT_GE:
+                iLower = i;
+                break;
+            case SQLITE_INDEX_CONSTRAINT_LT:
+            case SQLITE_INDEX_CONSTRAINT_LE:
+                iUpper = i;
+                break;
+        }
+    }
+
+    if ((unusableMask & ~idxNum) != 0) {
+        /* start, stop and step are inputs, so a plan
+        ** with unusable constraints on them is unusable */
+        return SQLITE_CONSTRAINT;
+    }
+    if ((idxNum & (RANGE_START | RANGE_STOP)) != (RANGE_START | RANGE_STOP)) {
+        sqlite3_free(pVTab->zErrMsg);
+        pVTab->zErrMsg =
+            sqlite3_mprintf("first two arguments to \"stats_range()\" missing or unusable");
+        return SQLITE_ERROR;
+    }
+
+    for (i = 0; i < 3; i++) {
+        if (aIdx[i] >= 0) {
+            pIdxInfo->aConstraintUsage[aIdx[i]].argvIndex = ++nArg;
+            pIdxInfo->aConstraintUsage[aIdx[i]].omit = 1;
+        }
+    }
+    if (iEqual >= 0) {
+        idxNum |= RANGE_EQUAL;
+        pIdxInfo->aConstraintUsage[iEqual].argvIndex = ++nArg;
+    } else {
+        if (iLower >= 0) {
+            idxNum |= RANGE_LOWER;
+            pIdxInfo->aConstraintUsage[iLower].argvIndex = ++nArg;
+        }
+        if (iUpper >= 0) {
+            idxNum |= RANGE_UPPER;
+            pIdxInfo->aConstraintUsage[iUpper].argvIndex = ++nArg;
+        }
+    }
+    if (pIdxInfo->nOrderBy == 1 && (pIdxInfo->aOrderBy[0].iColumn == RANGE_COLUMN_VALUE ||
+                                     pIdxInfo->aOrderBy[0].iColumn < 0)) {
+        if (pIdxInfo->aOrderBy[0].desc) {
+            idxNum |= RANGE_REVERSE;
+        }
+        if (pIdxInfo->aOrderBy[0].iColumn < 0) {
+            idxNum |= RANGE_ROWID;
+        }
+        pIdxInfo->orderByConsumed = 1;
+    }
+    if (!hasFilter && (pIdxInfo->nOrderBy == 0 || pIdxInfo->orderByConsumed)) {
+        if (iLimit >= 0) {
+            idxNum |= RANGE_LIMIT;
+            pIdxInfo->aConstraintUsage[iLimit].argvIndex = ++nArg;
+        }
+        if (iOffset >= 0) {
+            idxNum |= RANGE_OFFSET;
+            pIdxInfo->aConstraintUsage[iOffset].argvIndex = ++nArg;
+            pIdxInfo->aConstraintUsage[iOffset].omit = 1;
+        }
+    }
+
+    if (idxNum & (RANGE_EQUAL | RANGE_LOWER | RANGE_UPPER | RANGE_LIMIT)) {
+        pIdxInfo->estimatedCost = 1;
+        pIdxInfo->estimatedRows = (idxNum & RANGE_EQUAL) ? 1 : 100;
+    } else {
+        pIdxInfo->estimatedCost = 2;
+        pIdxInfo->estimatedRows = 1000;
+    }
+    pIdxInfo->idxNum = idxNum;
+    return SQLITE_OK;
+}
+
+static sqlite3_module range_module = {
+    .xConnect = rangeConnect,
+    .xBestIndex = rangeBestIndex,
+    .xDisconnect = rangeDisconnect,
+    .xOpen = rangeOpen,
+    .xClose = rangeClose,
+    .xFilter = rangeFilter,
+    .xNext = rangeNext,
+    .xEof = rangeEof,
+    .xColumn = rangeColumn,
+    .xRowid = rangeRowid,
+};
+
+#pragma endregion
+
+int stats_range_init(sqlite3* db) {
+    sqlite3_create_module(db, "stats_range", &range_module, 0);
+    return SQLITE_OK;
+}
@@ -111,6 +111,405 @@ static void variancepopFinalize(sqlite3_context* context) {
 
 #pragma endregion
 
+#pragma region Covariance and regression
+
+/*
+** An instance of the following structure holds the context of a
+** covariance, correlation or linear regression computation over (y, x)
+** pairs. The running means and co-moments are updated the same way as
+** in StddevCtx, and the update can be reverted for sliding windows.
+**
+** Reverting leaves rounding residue in the co-moments, so a window
+** where x or y is constant may still show a tiny positive variance.
+** Pairs leave a window in the order they entered it, so such windows
+** are detected exactly by counting the latest pairs with equal values.
+*/
+typedef struct CovarCtx CovarCtx;
+struct CovarCtx {
+    double rMeanX;
+    double rMeanY;
+    double rM2X;   /* sum of squared deviations of x */
+    double rM2Y;   /* sum of squared deviations of y */
+    double rCXY;   /* sum of products of x and y deviations */
+    double rLastX; /* x of the latest pair */
+    double rLastY; /* y of the latest pair */
+    int64_t nRunX; /* number of latest pairs with x equal to rLastX */
+    int64_t nRunY; /* number of latest pairs with y equal to rLastY */
+    int64_t cnt;   /* number of pairs */
+};
+
+/*
+** Returns true if x varies over the pairs
+*/
+static int covarVariesX(const CovarCtx* p) {
+    return p->nRunX < p->cnt && p->rM2X > 0;
+}
+
+/*
+** Returns true if y varies over the pairs
+*/
+static int covarVariesY(const CovarCtx* p) {
+    return p->nRunY < p->cnt && p->rM2Y > 0;
+}
+
+/*
+** called for each (y, x) pair entering the aggregate or window frame
+*/
+static void covarStep(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    CovarCtx* p;
+    double x, y, dx, dy;
+
+    assert(argc == 2);
+    p = sqlite3_aggregate_context(context, sizeof(*p));
+    if (p == 0) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    /* only consider pairs where both values are non-null */
+    if (SQLITE_NULL == sqlite3_value_numeric_type(argv[0]) ||
+        SQLITE_NULL == sqlite3_value_numeric_type(argv[1])) {
+        return;
+    }
+    y = sqlite3_value_double(argv[0]);
+    x = sqlite3_value_double(argv[1]);
+    p->nRunX = (p->cnt > 0 && x == p->rLastX) ? p->nRunX + 1 : 1;
+    p->nRunY = (p->cnt > 0 && y == p->rLastY) ? p->nRunY + 1 : 1;
+    p->rLastX = x;
+    p->rLastY = y;
+    p->cnt++;
+    dx = x - p->rMeanX;
+    dy = y - p->rMeanY;
+    p->rMeanX += dx / p->cnt;
+    p->rMeanY += dy / p->cnt;
+    p->rM2X += dx * (x - p->rMeanX);
+    p->rM2Y += dy * (y - p->rMeanY);
+    p->rCXY += dx * (y - p->rMeanY);
+}
+
+/*
+** called for each (y, x) pair leaving the window frame
+*/
+static void covarInverse(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    CovarCtx* p;
+    double x, y, dx, dy;
+
+    assert(argc == 2);
+    p = sqlite3_aggregate_context(context, sizeof(*p));
+    if (p == 0) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    if (SQLITE_NULL == sqlite3_value_numeric_type(argv[0]) ||
+        SQLITE_NULL == sqlite3_value_numeric_type(argv[1])) {
+        return;
+    }
+    if (p->cnt <= 1) {
+        memset(p, 0, sizeof(*p));
+        return;
+    }
+    y = sqlite3_value_double(argv[0]);
+    x = sqlite3_value_double(argv[1]);
+    p->cnt--;
+    if (p->nRunX > p->cnt) {
+        p->nRunX = p->cnt;
+    }
+    if (p->nRunY > p->cnt) {
+        p->nRunY = p->cnt;
+    }
+    dx = x - p->rMeanX;
+    dy = y - p->rMeanY;
+    p->rMeanX -= dx / p->cnt;
+    p->rMeanY -= dy / p->cnt;
+    p->rM2X -= dx * (x - p->rMeanX);
+    p->rM2Y -= dy * (y - p->rMeanY);
+    p->rCXY -= dx * (y - p->rMeanY);
+}
+
+/*
+** Returns the population covariance
+*/
+static void covarpopValue(sqlite3_context* context) {
+    CovarCtx* p;
+    p = sqlite3_aggregate_context(context, 0);
+    if (p && p->cnt > 0) {
+        sqlite3_result_double(context, p->rCXY / p->cnt);
+    } else {
+        sqlite3_result_null(context);
+    }
+}
+
+/*
+** Returns the sample covariance
+*/
+static void covarsampValue(sqlite3_context* context) {
+    CovarCtx* p;
+    p = sqlite3_aggregate_context(context, 0);
+    if (p && p->cnt > 1) {
+        sqlite3_result_double(context, p->rCXY / (p->cnt - 1));
+    } else {
+        sqlite3_result_null(context);
+    }
+}
+
+/*
+** Returns the Pearson correlation coefficient
+*/
+static void corrValue(sqlite3_context* context) {
+    CovarCtx* p;
+    p = sqlite3_aggregate_context(context, 0);
+    if (p && p->cnt > 1 && covarVariesX(p) && covarVariesY(p)) {
+        sqlite3_result_double(context, p->rCXY / sqrt(p->rM2X * p->rM2Y));
+    } else {
+        sqlite3_result_null(context);
+    }
+}
+
+/*
+** Returns the slope of the least-squares fit line
+*/
+static void regrslopeValue(sqlite3_context* context) {
+    CovarCtx* p;
+    p = sqlite3_aggregate_context(context, 0);
+    if (p && p->cnt > 1 && covarVariesX(p)) {
+        sqlite3_result_double(context, p->rCXY / p->rM2X);
+    } else {
+        sqlite3_result_null(context);
+    }
+}
+
+/*
+** Returns the y-intercept of the least-squares fit line
+*/
+static void regrinterceptValue(sqlite3_context* context) {
+    CovarCtx* p;
+    p = sqlite3_aggregate_context(context, 0);
+    if (p && p->cnt > 1 && covarVariesX(p)) {
+        sqlite3_result_double(context, p->rMeanY - p->rMeanX * p->rCXY / p->rM2X);
+    } else {
+        sqlite3_result_null(context);
+    }
+}
+
+/*
+** Returns the coefficient of determination of the least-squares fit
+*/
+static void regrr2Value(sqlite3_context* context) {
+    CovarCtx* p;
+    p = sqlite3_aggregate_context(context, 0);
+    if (p == 0 || p->cnt < 2 || !covarVariesX(p)) {
+        sqlite3_result_null(context);
+    } else if (!covarVariesY(p)) {
+        sqlite3_result_double(context, 1.0);
+    } else {
+        sqlite3_result_double(context, p->rCXY * p->rCXY / (p->rM2X * p->rM2Y));
+    }
+}
+
+#pragma endregion
+
+#pragma region Summary
+
+/*
+** Number of values buffered before they are folded into the running
+** moments, and the number of independent accumulators used while folding.
+** Splitting the sums into lanes lets the compiler vectorize the block
+** loops without reordering floating-point additions on its own.
+*/
+#define SUMMARY_BLOCK 64
+#define SUMMARY_LANES 4
+
+/*
+** An instance of the following structure holds the context of a
+** stats_summary() aggregate computation. Central moments are kept
+** as sums of powered deviations (M2, M3, M4) and merged block by block
+** with the pairwise update formulas by Terriberry and Pébay, see
+** https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Higher-order_statistics
+*/
+typedef struct SummaryCtx SummaryCtx;
+struct SummaryCtx {
+    int64_t cnt; /* number of folded elements */
+    double rMean;
+    double rM2;
+    double rM3;
+    double rM4;
+    double rMin;
+    double rMax;
+    int nBuf;                   /* number of buffered elements */
+    double aBuf[SUMMARY_BLOCK]; /* elements not yet folded */
+};
+
+/*
+** Folds the buffered values into the running moments.
+*/
+static void summaryFlush(SummaryCtx* p) {
+    double aSum[SUMMARY_LANES] = {0};
+    double aS2[SUMMARY_LANES] = {0};
+    double aS3[SUMMARY_LANES] = {0};
+    double aS4[SUMMARY_LANES] = {0};
+    double aMin[SUMMARY_LANES];
+    double aMax[SUMMARY_LANES];
+    int n = p->nBuf;
+    int nBody = n - n % SUMMARY_LANES;
+    int i, j;
+
+    if (n == 0)
+        return;
+
+    /* block mean and extremes */
+    for (j = 0; j < SUMMARY_LANES; j++) {
+        aMin[j] = aMax[j] = p->aBuf[0];
+    }
+    for (i = 0; i < nBody; i += SUMMARY_LANES) {
+        for (j = 0; j < SUMMARY_LANES; j++) {
+            double x = p->aBuf[i + j];
+            aSum[j] += x;
+            aMin[j] = x < aMin[j] ? x : aMin[j];
+            aMax[j] = x > aMax[j] ? x : aMax[j];
+        }
+    }
+    for (i = nBody; i < n; i++) {
+        double x = p->aBuf[i];
+        aSum[0] += x;
+        aMin[0] = x < aMin[0] ? x : aMin[0];
+        aMax[0] = x > aMax[0] ? x : aMax[0];
+    }
+    double sum = 0, bMin = aMin[0], bMax = aMax[0];
+    for (j = 0; j < SUMMARY_LANES; j++) {
+        sum += aSum[j];
+        bMin = aMin[j] < bMin ? aMin[j] : bMin;
+        bMax = aMax[j] > bMax ? aMax[j] : bMax;
+    }
+    double bMean = sum / n;
+
+    /* block central moments, computed around the block mean */
+    for (i = 0; i < nBody; i += SUMMARY_LANES) {
+        for (j = 0; j < SUMMARY_LANES; j++) {
+            double d = p->aBuf[i + j] - bMean;
+            double d2 = d * d;
+            aS2[j] += d2;
+            aS3[j] += d2 * d;
+            aS4[j] += d2 * d2;
+        }
+    }
+    for (i = nBody; i < n; i++) {
+        double d = p->aBuf[i] - bMean;
+        double d2 = d * d;
+        aS2[0] += d2;
+        aS3[0] += d2 * d;
+        aS4[0] += d2 * d2;
+    }
+    double bM2 = 0, bM3 = 0, bM4 = 0;
+    for (j = 0; j < SUMMARY_LANES; j++) {
+        bM2 += aS2[j];
+        bM3 += aS3[j];
+        bM4 += aS4[j];
+    }
+
+    /* merge the block into the running moments */
+    if (p->cnt == 0) {
+        p->rMean = bMean;
+        p->rM2 = bM2;
+        p->rM3 = bM3;
+        p->rM4 = bM4;
+        p->rMin = bMin;
+        p->rMax = bMax;
+    } else {
+        double na = (double)p->cnt;
+        double nb = (double)n;
+        double nx = na + nb;
+        double delta = bMean - p->rMean;
+        double delta2 = delta * delta;
+        p->rM4 += bM4 + delta2 * delta2 * na * nb * (na * na - na * nb + nb * nb) / (nx * nx * nx) +
+                  6.0 * delta2 * (na * na * bM2 + nb * nb * p->rM2) / (nx * nx) +
+                  4.0 * delta * (na * bM3 - nb * p->rM3) / nx;
+        p->rM3 += bM3 + delta2 * delta * na * nb * (na - nb) / (nx * nx) +
+                  3.0 * delta * (na * bM2 - nb * p->rM2) / nx;
+        p->rM2 += bM2 + delta2 * na * nb / nx;
+        p->rMean += delta * nb / nx;
+        p->rMin = bMin < p->rMin ? bMin : p->rMin;
+        p->rMax = bMax > p->rMax ? bMax : p->rMax;
+    }
+    p->cnt += n;
+    p->nBuf = 0;
+}
+
+/*
+** called for each value received during a calculation of stats_summary
+*/
+static void summaryStep(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    SummaryCtx* p;
+    assert(argc == 1);
+    p = sqlite3_aggregate_context(context, sizeof(*p));
+    if (p == 0) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    /* only consider non-null values */
+    if (SQLITE_NULL == sqlite3_value_numeric_type(argv[0])) {
+        return;
+    }
+    p->aBuf[p->nBuf++] = sqlite3_value_double(argv[0]);
+    if (p->nBuf == SUMMARY_BLOCK) {
+        summaryFlush(p);
+    }
+}
+
+/*
+** Appends a "name":value pair to the JSON object being built,
+** or "name":null if the value is undefined.
+*/
+static void summaryAppend(sqlite3_str* pStr, const char* zName, int isDefined, double value) {
+    if (isDefined && !isnan(value) && !isinf(value)) {
+        sqlite3_str_appendf(pStr, ",\"%s\":%!.15g", zName, value);
+    } else {
+        sqlite3_str_appendf(pStr, ",\"%s\":null", zName);
+    }
+}
+
+/*
+** Returns count, mean, min, max, sample variance and standard deviation,
+** skewness and excess kurtosis as a JSON object.
+*/
+static void summaryFinalize(sqlite3_context* context) {
+    SummaryCtx* p;
+    p = sqlite3_aggregate_context(context, 0);
+    if (p == 0) {
+        return;
+    }
+    summaryFlush(p);
+    if (p->cnt == 0) {
+        return;
+    }
+
+    double n = (double)p->cnt;
+    double var = p->cnt > 1 ? p->rM2 / (n - 1) : 0.0;
+    int hasShape = p->rM2 > 0;
+    double skew = hasShape ? sqrt(n) * p->rM3 / pow(p->rM2, 1.5) : 0.0;
+    double kurt = hasShape ? n * p->rM4 / (p->rM2 * p->rM2) - 3.0 : 0.0;
+
+    sqlite3_str* pStr = sqlite3_str_new(0);
+    sqlite3_str_appendf(pStr, "{\"count\":%lld", (sqlite3_int64)p->cnt);
+    summaryAppend(pStr, "mean", 1, p->rMean);
+    summaryAppend(pStr, "min", 1, p->rMin);
+    summaryAppend(pStr, "max", 1, p->rMax);
+    summaryAppend(pStr, "var", 1, var);
+    summaryAppend(pStr, "stddev", 1, sqrt(var));
+    summaryAppend(pStr, "skewness", hasShape, skew);
+    summaryAppend(pStr, "kurtosis", hasShape, kurt);
+    sqlite3_str_appendchar(pStr, 1, '}');
+
+    int rc = sqlite3_str_errcode(pStr);
+    char* zJson = sqlite3_str_finish(pStr);
+    if (rc != SQLITE_OK) {
+        sqlite3_free(zJson);
+        sqlite3_result_error_code(context, rc);
+        return;
+    }
+    sqlite3_result_text(context, zJson, -1, sqlite3_free);
+}
+
+#pragma endregion
+
 #pragma region Percentile
 
 /* The following object is the session context for a single percentile()
@@ -304,6 +703,19 @@ int stats_scalar_init(sqlite3* db) {
     sqlite3_create_function(db, "stats_var", 1, flags, 0, 0, varianceStep, varianceFinalize);
     sqlite3_create_function(db, "stats_var_samp", 1, flags, 0, 0, varianceStep, varianceFinalize);
     sqlite3_create_function(db, "stats_var_pop", 1, flags, 0, 0, varianceStep, variancepopFinalize);
+    sqlite3_create_function(db, "stats_summary", 1, flags, 0, 0, summaryStep, summaryFinalize);
+    sqlite3_create_window_function(db, "stats_covar_pop", 2, flags, 0, covarStep, covarpopValue,
+                                   covarpopValue, covarInverse, 0);
+    sqlite3_create_window_function(db, "stats_covar_samp", 2, flags, 0, covarStep, covarsampValue,
+                                   covarsampValue, covarInverse, 0);
+    sqlite3_create_window_function(db, "stats_corr", 2, flags, 0, covarStep, corrValue, corrValue,
+                                   covarInverse, 0);
+    sqlite3_create_window_function(db, "stats_regr_slope", 2, flags, 0, covarStep, regrslopeValue,
+                                   regrslopeValue, covarInverse, 0);
+    sqlite3_create_window_function(db, "stats_regr_intercept", 2, flags, 0, covarStep,
+                                   regrinterceptValue, regrinterceptValue, covarInverse, 0);
+    sqlite3_create_window_function(db, "stats_regr_r2", 2, flags, 0, covarStep, regrr2Value,
+                                   regrr2Value, covarInverse, 0);
     sqlite3_create_function(db, "stats_median", 1, flags, 0, 0, percentStep50, percentFinal);
     sqlite3_create_function(db, "stats_perc", 2, flags, 0, 0, percentStepCustom, percentFinal);
     sqlite3_create_function(db, "stats_p25", 1, flags, 0, 0, percentStep25, percentFinal);
@@ -318,6 +730,18 @@ int stats_scalar_init(sqlite3* db) {
     sqlite3_create_function(db, "variance", 1, flags, 0, 0, varianceStep, varianceFinalize);
     sqlite3_create_function(db, "var_samp", 1, flags, 0, 0, varianceStep, varianceFinalize);
     sqlite3_create_function(db, "var_pop", 1, flags, 0, 0, varianceStep, variancepopFinalize);
+    sqlite3_create_window_function(db, "covar_pop", 2, flags, 0, covarStep, covarpopValue,
+                                   covarpopValue, covarInverse, 0);
+    sqlite3_create_window_function(db, "covar_samp", 2, flags, 0, covarStep, covarsampValue,
+                                   covarsampValue, covarInverse, 0);
+    sqlite3_create_window_function(db, "corr", 2, flags, 0, covarStep, corrValue, corrValue,
+                                   covarInverse, 0);
+    sqlite3_create_window_function(db, "regr_slope", 2, flags, 0, covarStep, regrslopeValue,
+                                   regrslopeValue, covarInverse, 0);
+    sqlite3_create_window_function(db, "regr_intercept", 2, flags, 0, covarStep,
+                                   regrinterceptValue, regrinterceptValue, covarInverse, 0);
+    sqlite3_create_window_function(db, "regr_r2", 2, flags, 0, covarStep, regrr2Value,
+                                   regrr2Value, covarInverse, 0);
     sqlite3_create_function(db, "median", 1, flags, 0, 0, percentStep50, percentFinal);
     sqlite3_create_function(db, "percentile", 2, flags, 0, 0, percentStepCustom, percentFinal);
     sqlite3_create_function(db, "percentile_25", 1, flags, 0, 0, percentStep25, percentFinal);
@@ -8,6 +8,9 @@
 
 #include "sqlite3ext.h"
 
+int stats_histogram_init(sqlite3* db);
+int stats_hll_init(sqlite3* db);
+int stats_range_init(sqlite3* db);
 int stats_scalar_init(sqlite3* db);
 int stats_series_init(sqlite3* db);
 
@@ -12,6 +12,17 @@
 #include <string.h>
 
 #include "text/bstring.h"
+#include "text/search.h"
+
+// Vector instruction set used to check for non-ASCII bytes.
+// SSE2 is always available on x86-64 and NEON on AArch64.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BSTRING_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define BSTRING_NEON 1
+#endif
 
 // bstring_new creates an empty string.
 ByteString bstring_new(void) {
@@ -125,53 +136,18 @@ static bool bstring_contains_after(ByteString str, ByteString other, size_t star
     return true;
 }
 
-// bstring_index_char returns the first index of the character in the string
-// after the `start` index, inclusive.
-static int bstring_index_char(ByteString str, char chr, size_t start) {
-    for (size_t idx = start; idx < str.length; idx++) {
-        if (str.bytes[idx] == chr) {
-            return idx;
-        }
-    }
-    return -1;
-}
-
-// bstring_last_index_char returns the last index of the character in the string
-// before the `end` index, inclusive.
-static int bstring_last_index_char(ByteString str, char chr, size_t end) {
-    if (end >= str.length) {
-        return -1;
-    }
-    for (int idx = end; idx >= 0; idx--) {
-        if (str.bytes[idx] == chr) {
-            return idx;
-        }
-    }
-    return -1;
-}
-
 // bstring_index_after returns the index of the substring in the original string
 // after the `start` index, inclusive.
 static int bstring_index_after(ByteString str, ByteString other, size_t start) {
     if (other.length == 0) {
         return start;
     }
-    if (str.length == 0 || other.length > str.length) {
+    if (start >= str.length) {
         return -1;
     }
-
-    size_t cur_idx = start;
-    while (cur_idx < str.length) {
-        int match_idx = bstring_index_char(str, other.bytes[0], cur_idx);
-        if (match_idx == -1) {
-            return match_idx;
-        }
-        if (bstring_contains_after(str, other, match_idx)) {
-            return match_idx;
-        }
-        cur_idx = match_idx + 1;
-    }
-    return -1;
+    const char* at =
+        search_first(str.bytes + start, str.length - start, other.bytes, other.length);
+    return at == NULL ? -1 : (int)(at - str.bytes);
 }
 
 // bstring_index returns the first index of the substring in the original string.
@@ -184,23 +160,8 @@ int bstring_last_index(ByteString str, ByteString other) {
     if (other.length == 0) {
         return str.length - 1;
     }
-    if (str.length == 0 || other.length > str.length) {
-        return -1;
-    }
-
-    int cur_idx = str.length - 1;
-    while (cur_idx >= 0) {
-        int match_idx = bstring_last_index_char(str, other.bytes[0], cur_idx);
-        if (match_idx == -1) {
-            return match_idx;
-        }
-        if (bstring_contains_after(str, other, match_idx)) {
-            return match_idx;
-        }
-        cur_idx = match_idx - 1;
-    }
-
-    return -1;
+    const char* at = search_last(str.bytes, str.length, other.bytes, other.length);
+    return at == NULL ? -1 : (int)(at - str.bytes);
 }
 
 // bstring_contains checks if the string contains the substring.
@@ -224,16 +185,15 @@ bool bstring_equals(ByteString str, ByteString other) {
 
 // bstring_has_prefix checks if the string starts with the `other` substring.
 bool bstring_has_prefix(ByteString str, ByteString other) {
-    return bstring_index(str, other) == 0;
+    return other.length <= str.length && memcmp(str.bytes, other.bytes, other.length) == 0;
 }
 
 // bstring_has_suffix checks if the string ends with the `other` substring.
 bool bstring_has_suffix(ByteString str, ByteString other) {
-    if (other.length == 0) {
-        return true;
+    if (other.length > str.length) {
+        return false;
     }
-    int idx = bstring_last_index(str, other);
-    return idx < 0 ? false : (size_t)idx == (str.length - other.length);
+    return memcmp(str.bytes + str.length - other.length, other.bytes, other.length) == 0;
 }
 
 // bstring_count counts how many times the `other` substring is contained in the original string.
@@ -256,6 +216,61 @@ size_t bstring_count(ByteString str, ByteString other) {
     return count;
 }
 
+// bstring_is_ascii checks if the string contains only ASCII characters,
+// so that its byte indexes are also character indexes.
+bool bstring_is_ascii(ByteString str) {
+    const unsigned char* bytes = (const unsigned char*)str.bytes;
+    size_t n = str.length;
+    size_t idx = 0;
+
+#if defined(BSTRING_SSE2)
+    // check 64 bytes per iteration, the high bit of any byte is set in the mask
+    for (; idx + 64 <= n; idx += 64) {
+        __m128i acc = _mm_or_si128(
+            _mm_or_si128(_mm_loadu_si128((const __m128i*)(bytes + idx)),
+                         _mm_loadu_si128((const __m128i*)(bytes + idx + 16))),
+            _mm_or_si128(_mm_loadu_si128((const __m128i*)(bytes + idx + 32)),
+                         _mm_loadu_si128((const __m128i*)(bytes + idx + 48))));
+        if (_mm_movemask_epi8(acc) != 0) {
+            return false;
+        }
+    }
+    for (; idx + 16 <= n; idx += 16) {
+        if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)(bytes + idx))) != 0) {
+            return false;
+        }
+    }
+#elif defined(BSTRING_NEON)
+    for (; idx + 64 <= n; idx += 64) {
+        uint8x16_t acc = vorrq_u8(vorrq_u8(vld1q_u8(bytes + idx), vld1q_u8(bytes + idx + 16)),
+                                  vorrq_u8(vld1q_u8(bytes + idx + 32), vld1q_u8(bytes + idx + 48)));
+        if (vmaxvq_u8(acc) >= 0x80) {
+            return false;
+        }
+    }
+    for (; idx + 16 <= n; idx += 16) {
+        if (vmaxvq_u8(vld1q_u8(bytes + idx)) >= 0x80) {
+            return false;
+        }
+    }
+#endif
+
+    // check the tail 8 bytes at a time
+    for (; idx + 8 <= n; idx += 8) {
+        uint64_t word;
+        memcpy(&word, bytes + idx, sizeof(word));
+        if (word & 0x8080808080808080ULL) {
+            return false;
+        }
+    }
+    for (; idx < n; idx++) {
+        if (bytes[idx] & 0x80) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // bstring_split_part splits the string by the separator and returns the nth part (0-based).
 ByteString bstring_split_part(ByteString str, ByteString sep, size_t part) {
     if (str.length == 0 || sep.length > str.length) {
@@ -421,6 +436,9 @@ ByteString bstring_replace_all(ByteString str, ByteString old, ByteString new) {
 // bstring_reverse returns the reversed string.
 ByteString bstring_reverse(ByteString str) {
     ByteString res = bstring_clone(str.bytes, str.length);
+    if (res.bytes == NULL) {
+        return res;
+    }
     char* bytes = (char*)res.bytes;
     for (size_t i = 0; i < str.length / 2; i++) {
         char r = bytes[i];
@@ -478,6 +496,105 @@ ByteString bstring_trim(ByteString str) {
     return bstring_slice(str, left, right + 1);
 }
 
+// bstring_chars_set fills the set with the characters of the string.
+static void bstring_chars_set(ByteString chars, bool set[256]) {
+    memset(set, 0, 256 * sizeof(bool));
+    for (size_t idx = 0; idx < chars.length; idx++) {
+        set[(unsigned char)chars.bytes[idx]] = true;
+    }
+}
+
+// bstring_trim_left_chars trims certain characters from the beginning of the string.
+// The `chars` should be ASCII: ASCII bytes never occur inside multi-byte
+// UTF-8 characters, so the string itself may contain any characters.
+ByteString bstring_trim_left_chars(ByteString str, ByteString chars) {
+    bool set[256];
+    bstring_chars_set(chars, set);
+    size_t idx = 0;
+    while (idx < str.length && set[(unsigned char)str.bytes[idx]]) {
+        idx++;
+    }
+    return bstring_slice(str, idx, str.length);
+}
+
+// bstring_trim_right_chars trims certain characters from the end of the string.
+ByteString bstring_trim_right_chars(ByteString str, ByteString chars) {
+    bool set[256];
+    bstring_chars_set(chars, set);
+    size_t idx = str.length;
+    while (idx > 0 && set[(unsigned char)str.bytes[idx - 1]]) {
+        idx--;
+    }
+    return bstring_slice(str, 0, idx);
+}
+
+// bstring_trim_chars trims certain characters from the beginning and end of the string.
+ByteString bstring_trim_chars(ByteString str, ByteString chars) {
+    bool set[256];
+    bstring_chars_set(chars, set);
+    size_t left = 0;
+    while (left < str.length && set[(unsigned char)str.bytes[left]]) {
+        left++;
+    }
+    size_t right = str.length;
+    while (right > left && set[(unsigned char)str.bytes[right - 1]]) {
+        right--;
+    }
+    return bstring_slice(str, left, right);
+}
+
+// bstring_fill repeats the fill string until `length` bytes are filled.
+static void bstring_fill(char* bytes, size_t length, ByteString fill) {
+    for (size_t i = 0; i < length; i++) {
+        bytes[i] = fill.bytes[i % fill.length];
+    }
+}
+
+// bstring_pad_left pads the string to the specified length by prepending `fill` characters.
+// If the string is already longer than the specified length, it is truncated on the right.
+ByteString bstring_pad_left(ByteString str, size_t length, ByteString fill) {
+    if (str.length >= length) {
+        return bstring_substring(str, 0, length);
+    }
+    if (fill.length == 0) {
+        return bstring_slice(str, 0, str.length);
+    }
+
+    char* bytes = malloc(length + 1);
+    if (bytes == NULL) {
+        ByteString res = {NULL, 0, false};
+        return res;
+    }
+    size_t pad_length = length - str.length;
+    bstring_fill(bytes, pad_length, fill);
+    memcpy(bytes + pad_length, str.bytes, str.length);
+    bytes[length] = '\0';
+    ByteString res = {bytes, length, true};
+    return res;
+}
+
+// bstring_pad_right pads the string to the specified length by appending `fill` characters.
+// If the string is already longer than the specified length, it is truncated on the right.
+ByteString bstring_pad_right(ByteString str, size_t length, ByteString fill) {
+    if (str.length >= length) {
+        return bstring_substring(str, 0, length);
+    }
+    if (fill.length == 0) {
+        return bstring_slice(str, 0, str.length);
+    }
+
+    char* bytes = malloc(length + 1);
+    if (bytes == NULL) {
+        ByteString res = {NULL, 0, false};
+        return res;
+    }
+    memcpy(bytes, str.bytes, str.length);
+    bstring_fill(bytes + str.length, length - str.length, fill);
+    bytes[length] = '\0';
+    ByteString res = {bytes, length, true};
+    return res;
+}
+
 // bstring_print prints the string to stdout.
 void bstring_print(ByteString str) {
     if (str.bytes == NULL) {
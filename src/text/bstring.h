@@ -38,6 +38,7 @@ bool bstring_equals(ByteString str, ByteString other);
 bool bstring_has_prefix(ByteString str, ByteString other);
 bool bstring_has_suffix(ByteString str, ByteString other);
 size_t bstring_count(ByteString str, ByteString other);
+bool bstring_is_ascii(ByteString str);
 
 ByteString bstring_split_part(ByteString str, ByteString sep, size_t part);
 ByteString bstring_join(ByteString* strings, size_t count, ByteString sep);
@@ -51,6 +52,11 @@ ByteString bstring_reverse(ByteString str);
 ByteString bstring_trim_left(ByteString str);
 ByteString bstring_trim_right(ByteString str);
 ByteString bstring_trim(ByteString str);
+ByteString bstring_trim_left_chars(ByteString str, ByteString chars);
+ByteString bstring_trim_right_chars(ByteString str, ByteString chars);
+ByteString bstring_trim_chars(ByteString str, ByteString chars);
+ByteString bstring_pad_left(ByteString str, size_t length, ByteString fill);
+ByteString bstring_pad_right(ByteString str, size_t length, ByteString fill);
 
 void bstring_print(ByteString str);
 
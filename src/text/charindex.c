@@ -0,0 +1,194 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Character offset index of a UTF-8 string.
+//
+// The index keeps the byte offset of every CHARINDEX_STRIDE-th character,
+// so finding a character position decodes at most CHARINDEX_STRIDE - 1
+// characters instead of the whole string before it. ASCII strings need
+// no offsets, because character indexes are byte indexes.
+//
+// A cache keeps the last few strings it was asked about, compared by
+// their contents, and indexes a string the second time it is asked
+// about it. So several functions called on the same value share a
+// single index, and a string seen only once is never indexed.
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/bstring.h"
+#include "text/charindex.h"
+#include "text/ustring.h"
+#include "text/utf8/utf8.h"
+
+struct CharIndex {
+    size_t size;      // number of bytes in the string
+    size_t length;    // number of characters in the string
+    bool is_ascii;    // the string contains only ASCII characters
+    size_t* offsets;  // byte offset of every CHARINDEX_STRIDE-th character
+};
+
+// charindex_new indexes the character offsets of the string,
+// or returns NULL if out of memory.
+CharIndex* charindex_new(const char* str, size_t n) {
+    CharIndex* index = calloc(1, sizeof(CharIndex));
+    if (index == NULL) {
+        return NULL;
+    }
+    index->size = n;
+    index->is_ascii = bstring_is_ascii(bstring_from_cstring(str, n));
+    if (index->is_ascii) {
+        index->length = n;
+        return index;
+    }
+
+    // every character takes at least one byte
+    index->offsets = malloc((n / CHARINDEX_STRIDE + 1) * sizeof(size_t));
+    if (index->offsets == NULL) {
+        charindex_free(index);
+        return NULL;
+    }
+
+    // same counting as utf8_len: the first byte always starts a character,
+    // the others unless they are continuation bytes, up to the first zero byte
+    size_t length = 0;
+    for (size_t i = 0; i < n && (i == 0 || str[i] != 0); i++) {
+        if (i == 0 || ((unsigned char)str[i] & 0xC0) != 0x80) {
+            if (length % CHARINDEX_STRIDE == 0) {
+                index->offsets[length / CHARINDEX_STRIDE] = i;
+            }
+            length++;
+        }
+    }
+    index->length = length;
+    return index;
+}
+
+// charindex_size returns the number of bytes in the indexed string.
+size_t charindex_size(const CharIndex* index) {
+    return index->size;
+}
+
+// charindex_length returns the number of characters in the indexed string.
+size_t charindex_length(const CharIndex* index) {
+    return index->length;
+}
+
+// charindex_is_ascii checks if the indexed string contains only ASCII characters.
+bool charindex_is_ascii(const CharIndex* index) {
+    return index->is_ascii;
+}
+
+// charindex_pos returns the byte position of the character at `idx`,
+// or the string size if `idx` is past the end of the string.
+size_t charindex_pos(const CharIndex* index, const char* str, size_t idx) {
+    if (idx >= index->length) {
+        return index->size;
+    }
+    if (index->is_ascii) {
+        return idx;
+    }
+    size_t from = index->offsets[idx / CHARINDEX_STRIDE];
+    return from + utf8_pos(str + from, index->size - from, idx % CHARINDEX_STRIDE);
+}
+
+// charindex_substring returns a substring of `length` characters,
+// starting from the `start` index.
+Utf8String charindex_substring(const CharIndex* index,
+                               Utf8String str,
+                               size_t start,
+                               size_t length) {
+    size_t from = charindex_pos(index, str.bytes, start);
+    size_t to = str.size;
+    if (length < str.size - from) {
+        to = charindex_pos(index, str.bytes, start + length);
+    }
+    Utf8String res = {.bytes = str.bytes + from, .size = to - from, .is_ascii = index->is_ascii};
+    return res;
+}
+
+// charindex_free frees the index.
+void charindex_free(CharIndex* index) {
+    if (index == NULL) {
+        return;
+    }
+    free(index->offsets);
+    free(index);
+}
+
+// CacheEntry is a string remembered by the cache and its index, if any.
+typedef struct {
+    char* bytes;       // copy of the string
+    size_t size;       // number of bytes in the string
+    CharIndex* index;  // NULL until the string is seen again
+} CacheEntry;
+
+struct CharIndexCache {
+    CacheEntry entries[CHARINDEX_CACHE_SIZE];
+    size_t next;  // entry to replace on a miss
+    int refs;     // number of references to the cache
+};
+
+// charindex_cache_new creates an empty cache with a single reference,
+// or returns NULL if out of memory.
+CharIndexCache* charindex_cache_new(void) {
+    CharIndexCache* cache = calloc(1, sizeof(CharIndexCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    cache->refs = 1;
+    return cache;
+}
+
+// charindex_cache_retain adds a reference to the cache.
+void charindex_cache_retain(CharIndexCache* cache) {
+    cache->refs++;
+}
+
+// charindex_cache_release drops a reference to the cache,
+// and frees it with the last one.
+void charindex_cache_release(CharIndexCache* cache) {
+    if (cache == NULL || --cache->refs > 0) {
+        return;
+    }
+    for (size_t i = 0; i < CHARINDEX_CACHE_SIZE; i++) {
+        free(cache->entries[i].bytes);
+        charindex_free(cache->entries[i].index);
+    }
+    free(cache);
+}
+
+// charindex_cache_get returns the index of the string if the cache
+// has seen the same string before, or NULL otherwise.
+// The index is valid until the next call.
+const CharIndex* charindex_cache_get(CharIndexCache* cache, const char* str, size_t n) {
+    if (cache == NULL || n < CHARINDEX_CACHE_MIN) {
+        return NULL;
+    }
+    for (size_t i = 0; i < CHARINDEX_CACHE_SIZE; i++) {
+        CacheEntry* entry = &cache->entries[i];
+        if (entry->bytes == NULL || entry->size != n || memcmp(entry->bytes, str, n) != 0) {
+            continue;
+        }
+        if (entry->index == NULL) {
+            entry->index = charindex_new(str, n);
+        }
+        return entry->index;
+    }
+
+    // remember the string, it is indexed if seen again
+    CacheEntry* entry = &cache->entries[cache->next];
+    char* bytes = malloc(n);
+    if (bytes == NULL) {
+        return NULL;
+    }
+    memcpy(bytes, str, n);
+    free(entry->bytes);
+    charindex_free(entry->index);
+    entry->bytes = bytes;
+    entry->size = n;
+    entry->index = NULL;
+    cache->next = (cache->next + 1) % CHARINDEX_CACHE_SIZE;
+    return NULL;
+}
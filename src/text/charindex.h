@@ -0,0 +1,61 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Character offset index of a UTF-8 string.
+
+#ifndef CHARINDEX_H
+#define CHARINDEX_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "text/ustring.h"
+
+// Number of characters between the indexed offsets.
+#define CHARINDEX_STRIDE 64
+
+typedef struct CharIndex CharIndex;
+
+// charindex_new indexes the character offsets of the string,
+// or returns NULL if out of memory.
+CharIndex* charindex_new(const char* str, size_t n);
+// charindex_size returns the number of bytes in the indexed string.
+size_t charindex_size(const CharIndex* index);
+// charindex_length returns the number of characters in the indexed string.
+size_t charindex_length(const CharIndex* index);
+// charindex_is_ascii checks if the indexed string contains only ASCII characters.
+bool charindex_is_ascii(const CharIndex* index);
+// charindex_pos returns the byte position of the character at `idx`,
+// or the string size if `idx` is past the end of the string.
+size_t charindex_pos(const CharIndex* index, const char* str, size_t idx);
+// charindex_substring returns a substring of `length` characters,
+// starting from the `start` index.
+Utf8String charindex_substring(const CharIndex* index,
+                               Utf8String str,
+                               size_t start,
+                               size_t length);
+// charindex_free frees the index.
+void charindex_free(CharIndex* index);
+
+// Number of strings a cache keeps the index of.
+#define CHARINDEX_CACHE_SIZE 4
+
+// Strings shorter than this are not worth indexing.
+#define CHARINDEX_CACHE_MIN (2 * CHARINDEX_STRIDE)
+
+typedef struct CharIndexCache CharIndexCache;
+
+// charindex_cache_new creates an empty cache with a single reference,
+// or returns NULL if out of memory.
+CharIndexCache* charindex_cache_new(void);
+// charindex_cache_retain adds a reference to the cache.
+void charindex_cache_retain(CharIndexCache* cache);
+// charindex_cache_release drops a reference to the cache,
+// and frees it with the last one.
+void charindex_cache_release(CharIndexCache* cache);
+// charindex_cache_get returns the index of the string if the cache
+// has seen the same string before, or NULL otherwise.
+// The index is valid until the next call.
+const CharIndex* charindex_cache_get(CharIndexCache* cache, const char* str, size_t n);
+
+#endif /* CHARINDEX_H */
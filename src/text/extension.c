@@ -13,9 +13,115 @@
 SQLITE_EXTENSION_INIT3
 
 #include "text/bstring.h"
+#include "text/charindex.h"
+#include "text/like.h"
+#include "text/normalize.h"
+#include "text/replacer.h"
 #include "text/rstring.h"
+#include "text/search.h"
+#include "text/translate.h"
+#include "text/ustring.h"
 #include "text/utf8/utf8.h"
 
+#pragma region ASCII fast path
+
+#if defined(TEXT_DEBUG)
+// Number of calls that took the ASCII and the Unicode path,
+// approximate when several threads run text functions.
+static sqlite3_int64 text_ascii_calls = 0;
+static sqlite3_int64 text_unicode_calls = 0;
+#endif
+
+// text_is_ascii checks if the string contains only ASCII characters,
+// so that the byte-indexed kernels apply. Only worth calling when
+// the function has to scan the whole string anyway.
+static bool text_is_ascii(const char* str, size_t size) {
+    bool is_ascii = bstring_is_ascii(bstring_from_cstring(str, size));
+#if defined(TEXT_DEBUG)
+    if (is_ascii) {
+        text_ascii_calls++;
+    } else {
+        text_unicode_calls++;
+    }
+#endif
+    return is_ascii;
+}
+
+// text_result_bstring returns the string as the function result.
+// Takes ownership of the string bytes if the string owns them.
+static void text_result_bstring(sqlite3_context* context, ByteString str) {
+    if (str.bytes == NULL) {
+        sqlite3_result_error_nomem(context);
+    } else if (str.owning) {
+        sqlite3_result_text(context, str.bytes, str.length, free);
+    } else {
+        sqlite3_result_text(context, str.bytes, str.length, SQLITE_TRANSIENT);
+    }
+}
+
+#if defined(TEXT_DEBUG)
+// Returns the number of calls that took the ASCII and the Unicode path.
+// text_debug_counters()
+static void text_debug_counters(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    assert(argc == 0);
+    char* res = sqlite3_mprintf("ascii=%lld unicode=%lld", text_ascii_calls, text_unicode_calls);
+    sqlite3_result_text(context, res, -1, sqlite3_free);
+}
+#endif
+
+#pragma endregion
+
+#pragma region Character index
+
+// text_char_index returns the character index of the string
+// from the per-connection cache passed as the function user data.
+// The cache is shared by all the functions that locate characters,
+// so they index a value once, whether it is a literal or a column.
+// Returns NULL if the string was not seen before or if out of memory.
+static const CharIndex* text_char_index(sqlite3_context* context, const char* str, size_t n) {
+    return charindex_cache_get(sqlite3_user_data(context), str, n);
+}
+
+// text_substring_at returns a substring of `length` characters,
+// starting from the `start` index, using the character index if there is one.
+static Utf8String text_substring_at(Utf8String str,
+                                    const CharIndex* index,
+                                    size_t start,
+                                    size_t length) {
+    if (index == NULL) {
+        return ustring_substring(str, start, length);
+    }
+    return charindex_substring(index, str, start, length);
+}
+
+// text_length_of returns the number of characters in the string,
+// using the character index if there is one.
+static size_t text_length_of(Utf8String* str, const CharIndex* index) {
+    if (index == NULL) {
+        str->is_ascii = text_is_ascii(str->bytes, str->size);
+        return ustring_length(*str);
+    }
+    str->is_ascii = charindex_is_ascii(index);
+    return charindex_length(index);
+}
+
+// text_slice_at returns a slice of the string like ustring_slice,
+// using the character index if there is one.
+static Utf8String text_slice_at(Utf8String str, const CharIndex* index, int start, int end) {
+    if (start < 0 || end < 0) {
+        int length = (int)text_length_of(&str, index);
+        start = start < 0 ? length + start : start;
+        end = end < 0 ? length + end : end;
+    }
+    start = start < 0 ? 0 : start;
+    if (start >= end) {
+        return ustring_new();
+    }
+    return text_substring_at(str, index, start, end - start);
+}
+
+#pragma endregion
+
 #pragma region Substrings
 
 // Extracts a substring starting at the `start` position (1-based).
@@ -40,12 +146,11 @@ static void text_substring2(sqlite3_context* context, int argc, sqlite3_value**
     // postgres-compatible: treat negative index as zero
     start = start > 0 ? start - 1 : 0;
 
-    RuneString s_src = rstring_from_cstring(src);
-    RuneString s_res = rstring_slice(s_src, start, s_src.length);
-    char* res = rstring_to_cstring(s_res);
-    sqlite3_result_text(context, res, -1, free);
-    rstring_free(s_src);
-    rstring_free(s_res);
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    Utf8String s_src = ustring_from_cstring(src, n_src);
+    const CharIndex* index = text_char_index(context, src, n_src);
+    Utf8String s_res = text_substring_at(s_src, index, start, s_src.size);
+    sqlite3_result_text(context, s_res.bytes, s_res.size, SQLITE_TRANSIENT);
 }
 
 // Extracts a substring of `length` characters starting at the `start` position (1-based).
@@ -90,18 +195,13 @@ static void text_substring3(sqlite3_context* context, int argc, sqlite3_value**
         return;
     }
 
-    RuneString s_src = rstring_from_cstring(src);
-
-    // postgres-compatible: the substring cannot be longer the the original string
-    if ((size_t)length > s_src.length) {
-        length = s_src.length;
-    }
-
-    RuneString s_res = rstring_substring(s_src, start, length);
-    char* res = rstring_to_cstring(s_res);
-    sqlite3_result_text(context, res, -1, free);
-    rstring_free(s_src);
-    rstring_free(s_res);
+    // postgres-compatible: the substring cannot be longer the the original string,
+    // ustring_substring stops at the end of the string
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    Utf8String s_src = ustring_from_cstring(src, n_src);
+    const CharIndex* index = text_char_index(context, src, n_src);
+    Utf8String s_res = text_substring_at(s_src, index, start, length);
+    sqlite3_result_text(context, s_res.bytes, s_res.size, SQLITE_TRANSIENT);
 }
 
 // Extracts a substring starting at the `start` position (1-based).
@@ -124,21 +224,13 @@ static void text_slice2(sqlite3_context* context, int argc, sqlite3_value** argv
     // convert to 0-based index
     start = start > 0 ? start - 1 : start;
 
-    RuneString s_src = rstring_from_cstring(src);
-
     // python-compatible: treat negative index larger than the length of the string as zero
     // and return the original string
-    if (start < -(int)s_src.length) {
-        sqlite3_result_text(context, src, -1, SQLITE_TRANSIENT);
-        rstring_free(s_src);
-        return;
-    }
-
-    RuneString s_res = rstring_slice(s_src, start, s_src.length);
-    char* res = rstring_to_cstring(s_res);
-    sqlite3_result_text(context, res, -1, free);
-    rstring_free(s_src);
-    rstring_free(s_res);
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    Utf8String s_src = ustring_from_cstring(src, n_src);
+    const CharIndex* index = text_char_index(context, src, n_src);
+    Utf8String s_res = text_slice_at(s_src, index, start, INT32_MAX);
+    sqlite3_result_text(context, s_res.bytes, s_res.size, SQLITE_TRANSIENT);
 }
 
 // Extracts a substring from `start` position inclusive to `end` position non-inclusive (1-based).
@@ -168,12 +260,11 @@ static void text_slice3(sqlite3_context* context, int argc, sqlite3_value** argv
     // convert to 0-based index
     end = end > 0 ? end - 1 : end;
 
-    RuneString s_src = rstring_from_cstring(src);
-    RuneString s_res = rstring_slice(s_src, start, end);
-    char* res = rstring_to_cstring(s_res);
-    sqlite3_result_text(context, res, -1, free);
-    rstring_free(s_src);
-    rstring_free(s_res);
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    Utf8String s_src = ustring_from_cstring(src, n_src);
+    const CharIndex* index = text_char_index(context, src, n_src);
+    Utf8String s_res = text_slice_at(s_src, index, start, end);
+    sqlite3_result_text(context, s_res.bytes, s_res.size, SQLITE_TRANSIENT);
 }
 
 // Extracts a substring of `length` characters from the beginning of the string.
@@ -195,16 +286,16 @@ static void text_left(sqlite3_context* context, int argc, sqlite3_value** argv)
     }
     int length = sqlite3_value_int(argv[1]);
 
-    RuneString s_src = rstring_from_cstring(src);
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    Utf8String s_src = ustring_from_cstring(src, n_src);
+    const CharIndex* index = NULL;
     if (length < 0) {
-        length = s_src.length + length;
+        index = text_char_index(context, src, n_src);
+        length = (int)text_length_of(&s_src, index) + length;
         length = length >= 0 ? length : 0;
     }
-    RuneString s_res = rstring_substring(s_src, 0, length);
-    char* res = rstring_to_cstring(s_res);
-    sqlite3_result_text(context, res, -1, free);
-    rstring_free(s_src);
-    rstring_free(s_res);
+    Utf8String s_res = text_substring_at(s_src, index, 0, length);
+    sqlite3_result_text(context, s_res.bytes, s_res.size, SQLITE_TRANSIENT);
 }
 
 // Extracts a substring of `length` characters from the end of the string.
@@ -226,17 +317,21 @@ static void text_right(sqlite3_context* context, int argc, sqlite3_value** argv)
     }
     int length = sqlite3_value_int(argv[1]);
 
-    RuneString s_src = rstring_from_cstring(src);
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    Utf8String s_src = ustring_from_cstring(src, n_src);
+    const CharIndex* index = text_char_index(context, src, n_src);
+    int src_length = (int)text_length_of(&s_src, index);
 
-    length = (length < 0) ? (int)s_src.length + length : length;
-    int start = (int)s_src.length - length;
+    length = (length < 0) ? src_length + length : length;
+    if (length <= 0) {
+        sqlite3_result_text(context, "", 0, SQLITE_STATIC);
+        return;
+    }
+    int start = src_length - length;
     start = start < 0 ? 0 : start;
 
-    RuneString s_res = rstring_substring(s_src, start, length);
-    char* res = rstring_to_cstring(s_res);
-    sqlite3_result_text(context, res, -1, free);
-    rstring_free(s_src);
-    rstring_free(s_res);
+    Utf8String s_res = text_substring_at(s_src, index, start, length);
+    sqlite3_result_text(context, s_res.bytes, s_res.size, SQLITE_TRANSIENT);
 }
 
 #pragma endregion
@@ -261,12 +356,10 @@ static void text_index(sqlite3_context* context, int argc, sqlite3_value** argv)
         return;
     }
 
-    RuneString s_src = rstring_from_cstring(src);
-    RuneString s_other = rstring_from_cstring(other);
-    int idx = rstring_index(s_src, s_other);
+    Utf8String s_src = ustring_from_cstring(src, sqlite3_value_bytes(argv[0]));
+    Utf8String s_other = ustring_from_cstring(other, sqlite3_value_bytes(argv[1]));
+    int idx = ustring_index(s_src, s_other);
     sqlite3_result_int64(context, idx + 1);
-    rstring_free(s_src);
-    rstring_free(s_other);
 }
 
 // Returns the last index of the substring in the original string.
@@ -286,12 +379,10 @@ static void text_last_index(sqlite3_context* context, int argc, sqlite3_value**
         return;
     }
 
-    RuneString s_src = rstring_from_cstring(src);
-    RuneString s_other = rstring_from_cstring(other);
-    int idx = rstring_last_index(s_src, s_other);
+    Utf8String s_src = ustring_from_cstring(src, sqlite3_value_bytes(argv[0]));
+    Utf8String s_other = ustring_from_cstring(other, sqlite3_value_bytes(argv[1]));
+    int idx = ustring_last_index(s_src, s_other);
     sqlite3_result_int64(context, idx + 1);
-    rstring_free(s_src);
-    rstring_free(s_other);
 }
 
 // Checks if the string contains the substring_
@@ -395,7 +486,13 @@ static void text_count(sqlite3_context* context, int argc, sqlite3_value** argv)
     bstring_free(s_other);
 }
 
+// text_like_free frees the compiled pattern kept as the function auxdata.
+static void text_like_free(void* pattern) {
+    like_free(pattern);
+}
+
 // Checks if the string matches the pattern using the SQL LIKE syntax.
+// The pattern is compiled once per statement when it is a constant.
 // text_like(pattern, str)
 // like(pattern, str)
 // str LIKE pattern
@@ -414,12 +511,26 @@ static void text_like(sqlite3_context* context, int argc, sqlite3_value** argv)
         return;
     }
 
-    RuneString s_pattern = rstring_from_cstring(pattern);
-    RuneString s_str = rstring_from_cstring(str);
-    bool match = rstring_like(s_pattern, s_str);
-    sqlite3_result_int(context, match);
-    rstring_free(s_pattern);
-    rstring_free(s_str);
+    LikePattern* compiled = sqlite3_get_auxdata(context, 0);
+    bool is_new = compiled == NULL;
+    if (is_new) {
+        compiled = like_compile(pattern, sqlite3_value_bytes(argv[0]));
+        if (compiled == NULL) {
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+    }
+
+    int match = like_match(compiled, str, sqlite3_value_bytes(argv[1]));
+    if (match < 0) {
+        sqlite3_result_error_nomem(context);
+    } else {
+        sqlite3_result_int(context, match);
+    }
+
+    if (is_new) {
+        sqlite3_set_auxdata(context, 0, compiled, text_like_free);
+    }
 }
 
 #pragma endregion
@@ -458,20 +569,10 @@ static void text_split(sqlite3_context* context, int argc, sqlite3_value** argv)
     // convert to 0-based index
     part = part > 0 ? part - 1 : part;
 
-    ByteString s_src = bstring_from_cstring(src, strlen(src));
-    ByteString s_sep = bstring_from_cstring(sep, strlen(sep));
-
-    // count from the last part backwards
-    if (part < 0) {
-        int n_parts = bstring_count(s_src, s_sep) + 1;
-        part = n_parts + part;
-    }
-
-    ByteString s_part = bstring_split_part(s_src, s_sep, part);
-    sqlite3_result_text(context, s_part.bytes, -1, SQLITE_TRANSIENT);
-    bstring_free(s_src);
-    bstring_free(s_sep);
-    bstring_free(s_part);
+    Utf8String s_src = ustring_from_cstring(src, sqlite3_value_bytes(argv[0]));
+    Utf8String s_sep = ustring_from_cstring(sep, sqlite3_value_bytes(argv[1]));
+    Utf8String s_part = ustring_split_part(s_src, s_sep, part);
+    sqlite3_result_text(context, s_part.bytes, s_part.size, SQLITE_TRANSIENT);
 }
 
 // Joins strings using the separator and returns the resulting string. Ignores nulls.
@@ -519,6 +620,153 @@ static void text_join(sqlite3_context* context, int argc, sqlite3_value** argv)
     free(s_parts);
 }
 
+// JoinAgg is the state of the text_join_agg aggregate.
+// Values are appended to a single buffer, which grows geometrically.
+// Window frames remove values from the front by advancing the start offset,
+// and the space is reclaimed when the buffer needs to grow.
+typedef struct {
+    char* bytes;       // joined values
+    size_t start;      // offset of the first value
+    size_t size;       // offset after the last value
+    size_t capacity;   // allocated bytes
+    int* lengths;      // bytes taken by each value and the separator after it
+    size_t first;      // index of the first value in lengths
+    size_t count;      // index after the last value in lengths
+    size_t n_lengths;  // allocated lengths
+} JoinAgg;
+
+// join_agg_reserve ensures there is room for n more bytes and one more value.
+static bool join_agg_reserve(JoinAgg* agg, size_t n) {
+    if (agg->start > 0 && agg->size + n > agg->capacity) {
+        memmove(agg->bytes, agg->bytes + agg->start, agg->size - agg->start);
+        agg->size -= agg->start;
+        agg->start = 0;
+    }
+    // the buffer is allocated even for empty values,
+    // so that joining empty strings returns an empty string and not null
+    if (agg->bytes == NULL || agg->size + n > agg->capacity) {
+        size_t capacity = agg->capacity < 64 ? 64 : agg->capacity * 2;
+        while (capacity < agg->size + n) {
+            capacity *= 2;
+        }
+        char* bytes = sqlite3_realloc64(agg->bytes, capacity);
+        if (bytes == NULL) {
+            return false;
+        }
+        agg->bytes = bytes;
+        agg->capacity = capacity;
+    }
+
+    if (agg->first > 0 && agg->count == agg->n_lengths) {
+        memmove(agg->lengths, agg->lengths + agg->first,
+                (agg->count - agg->first) * sizeof(*agg->lengths));
+        agg->count -= agg->first;
+        agg->first = 0;
+    }
+    if (agg->count == agg->n_lengths) {
+        size_t n_lengths = agg->n_lengths < 16 ? 16 : agg->n_lengths * 2;
+        int* lengths = sqlite3_realloc64(agg->lengths, n_lengths * sizeof(*lengths));
+        if (lengths == NULL) {
+            return false;
+        }
+        agg->lengths = lengths;
+        agg->n_lengths = n_lengths;
+    }
+    return true;
+}
+
+// Appends the value to the joined string, preceded by the separator. Ignores nulls.
+// text_join_agg(sep, value)
+static void text_join_agg_step(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    assert(argc == 2);
+    if (sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+        return;
+    }
+    JoinAgg* agg = sqlite3_aggregate_context(context, sizeof(*agg));
+    if (agg == NULL) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+
+    const char* value = (const char*)sqlite3_value_text(argv[1]);
+    size_t value_len = sqlite3_value_bytes(argv[1]);
+    const char* sep = NULL;
+    size_t sep_len = 0;
+    if (agg->count > agg->first) {
+        sep = (const char*)sqlite3_value_text(argv[0]);
+        sep_len = sep == NULL ? 0 : sqlite3_value_bytes(argv[0]);
+    }
+
+    sqlite3* db = sqlite3_context_db_handle(context);
+    size_t limit = sqlite3_limit(db, SQLITE_LIMIT_LENGTH, -1);
+    if (agg->size - agg->start + sep_len + value_len > limit) {
+        sqlite3_result_error_toobig(context);
+        return;
+    }
+    if (!join_agg_reserve(agg, sep_len + value_len)) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+
+    if (sep_len > 0) {
+        memcpy(agg->bytes + agg->size, sep, sep_len);
+        agg->size += sep_len;
+        agg->lengths[agg->count - 1] += (int)sep_len;
+    }
+    memcpy(agg->bytes + agg->size, value, value_len);
+    agg->size += value_len;
+    agg->lengths[agg->count++] = (int)value_len;
+}
+
+// Removes the first value and the separator after it from the joined string.
+static void text_join_agg_inverse(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    assert(argc == 2);
+    if (sqlite3_value_type(argv[1]) == SQLITE_NULL) {
+        return;
+    }
+    JoinAgg* agg = sqlite3_aggregate_context(context, sizeof(*agg));
+    if (agg == NULL || agg->count == agg->first) {
+        return;
+    }
+    agg->start += agg->lengths[agg->first++];
+    if (agg->first == agg->count) {
+        agg->start = agg->size = 0;
+        agg->first = agg->count = 0;
+    }
+}
+
+// Returns the joined string of the current window frame.
+static void text_join_agg_value(sqlite3_context* context) {
+    JoinAgg* agg = sqlite3_aggregate_context(context, 0);
+    if (agg == NULL || agg->count == agg->first) {
+        sqlite3_result_null(context);
+        return;
+    }
+    sqlite3_result_text64(context, agg->bytes + agg->start, agg->size - agg->start,
+                          SQLITE_TRANSIENT, SQLITE_UTF8);
+}
+
+// Returns the joined string, handing the buffer over to SQLite.
+static void text_join_agg_final(sqlite3_context* context) {
+    JoinAgg* agg = sqlite3_aggregate_context(context, 0);
+    if (agg == NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    if (agg->count == agg->first) {
+        sqlite3_result_null(context);
+    } else {
+        if (agg->start > 0) {
+            memmove(agg->bytes, agg->bytes + agg->start, agg->size - agg->start);
+        }
+        sqlite3_result_text64(context, agg->bytes, agg->size - agg->start, sqlite3_free,
+                              SQLITE_UTF8);
+        agg->bytes = NULL;
+    }
+    sqlite3_free(agg->bytes);
+    sqlite3_free(agg->lengths);
+}
+
 // Concatenates strings and returns the resulting string. Ignores nulls.
 // text_concat(str, ...)
 // [pg-compatible] concat(val1[, val2 [, ...]])
@@ -585,8 +833,233 @@ static void text_repeat(sqlite3_context* context, int argc, sqlite3_value** argv
 
 #pragma endregion
 
+#pragma region Split rows
+
+// text_split_rows(str, sep) is a table-valued function
+// that returns each part of the string split by the separator as a row.
+// Parts are found in a single pass over the string.
+
+/* Column numbers */
+#define SPLIT_COLUMN_IDX 0
+#define SPLIT_COLUMN_VALUE 1
+#define SPLIT_COLUMN_STR 2
+#define SPLIT_COLUMN_SEP 3
+
+typedef struct split_cursor split_cursor;
+struct split_cursor {
+    sqlite3_vtab_cursor base; /* Base class - must be first */
+    char* zStr;               /* Copy of the string followed by the separator */
+    size_t nStr;              /* Size of the string in bytes */
+    const char* zSep;         /* Separator, points into zStr */
+    size_t nSep;              /* Size of the separator in bytes */
+    size_t iStart;            /* Start of the current part */
+    size_t iEnd;              /* End of the current part */
+    sqlite3_int64 iPart;      /* Current part (1-based), 0 when done */
+};
+
+static int splitConnect(sqlite3* db,
+                        void* pUnused,
+                        int argcUnused,
+                        const char* const* argvUnused,
+                        sqlite3_vtab** ppVtab,
+                        char** pzErrUnused) {
+    sqlite3_vtab* pNew;
+    int rc;
+    (void)pUnused;
+    (void)argcUnused;
+    (void)argvUnused;
+    (void)pzErrUnused;
+    rc = sqlite3_declare_vtab(db, "CREATE TABLE x(idx,value,str hidden,sep hidden)");
+    if (rc == SQLITE_OK) {
+        pNew = *ppVtab = sqlite3_malloc(sizeof(*pNew));
+        if (pNew == 0)
+            return SQLITE_NOMEM;
+        memset(pNew, 0, sizeof(*pNew));
+        sqlite3_vtab_config(db, SQLITE_VTAB_INNOCUOUS);
+    }
+    return rc;
+}
+
+static int splitDisconnect(sqlite3_vtab* pVtab) {
+    sqlite3_free(pVtab);
+    return SQLITE_OK;
+}
+
+static int splitOpen(sqlite3_vtab* pUnused, sqlite3_vtab_cursor** ppCursor) {
+    split_cursor* pCur;
+    (void)pUnused;
+    pCur = sqlite3_malloc(sizeof(*pCur));
+    if (pCur == 0)
+        return SQLITE_NOMEM;
+    memset(pCur, 0, sizeof(*pCur));
+    *ppCursor = &pCur->base;
+    return SQLITE_OK;
+}
+
+static void splitReset(split_cursor* pCur) {
+    sqlite3_free(pCur->zStr);
+    pCur->zStr = 0;
+    pCur->nStr = 0;
+    pCur->zSep = 0;
+    pCur->nSep = 0;
+    pCur->iStart = 0;
+    pCur->iEnd = 0;
+    pCur->iPart = 0;
+}
+
+static int splitClose(sqlite3_vtab_cursor* cur) {
+    splitReset((split_cursor*)cur);
+    sqlite3_free(cur);
+    return SQLITE_OK;
+}
+
+// splitFind finds the end of the part starting at iStart.
+static void splitFind(split_cursor* pCur) {
+    const char* at = NULL;
+    if (pCur->nSep > 0) {
+        at = search_first(pCur->zStr + pCur->iStart, pCur->nStr - pCur->iStart, pCur->zSep,
+                          pCur->nSep);
+    }
+    pCur->iEnd = at == NULL ? pCur->nStr : (size_t)(at - pCur->zStr);
+}
+
+static int splitNext(sqlite3_vtab_cursor* cur) {
+    split_cursor* pCur = (split_cursor*)cur;
+    if (pCur->iEnd == pCur->nStr) {
+        // the last part
+        pCur->iPart = 0;
+        return SQLITE_OK;
+    }
+    pCur->iStart = pCur->iEnd + pCur->nSep;
+    pCur->iPart++;
+    splitFind(pCur);
+    return SQLITE_OK;
+}
+
+static int splitEof(sqlite3_vtab_cursor* cur) {
+    return ((split_cursor*)cur)->iPart == 0;
+}
+
+static int splitColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int i) {
+    split_cursor* pCur = (split_cursor*)cur;
+    switch (i) {
+        case SPLIT_COLUMN_IDX:
+            sqlite3_result_int64(ctx, pCur->iPart);
+            break;
+        case SPLIT_COLUMN_VALUE:
+            sqlite3_result_text(ctx, pCur->zStr + pCur->iStart, pCur->iEnd - pCur->iStart,
+                                SQLITE_TRANSIENT);
+            break;
+        case SPLIT_COLUMN_STR:
+            sqlite3_result_text(ctx, pCur->zStr, pCur->nStr, SQLITE_TRANSIENT);
+            break;
+        case SPLIT_COLUMN_SEP:
+            sqlite3_result_text(ctx, pCur->zSep, pCur->nSep, SQLITE_TRANSIENT);
+            break;
+        default:
+            sqlite3_result_null(ctx);
+            break;
+    }
+    return SQLITE_OK;
+}
+
+static int splitRowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
+    *pRowid = ((split_cursor*)cur)->iPart;
+    return SQLITE_OK;
+}
+
+static int splitFilter(sqlite3_vtab_cursor* pVtabCursor,
+                       int idxNumUnused,
+                       const char* idxStrUnused,
+                       int argc,
+                       sqlite3_value** argv) {
+    split_cursor* pCur = (split_cursor*)pVtabCursor;
+    (void)idxNumUnused;
+    (void)idxStrUnused;
+    splitReset(pCur);
+    if (argc != 2) {
+        return SQLITE_OK;
+    }
+    const char* zStr = (const char*)sqlite3_value_text(argv[0]);
+    size_t nStr = sqlite3_value_bytes(argv[0]);
+    const char* zSep = (const char*)sqlite3_value_text(argv[1]);
+    size_t nSep = sqlite3_value_bytes(argv[1]);
+    if (zStr == NULL || zSep == NULL || nStr == 0) {
+        // nulls and empty strings have no parts
+        return SQLITE_OK;
+    }
+
+    // the arguments are only valid during the call, so keep a copy
+    pCur->zStr = sqlite3_malloc64(nStr + nSep + 1);
+    if (pCur->zStr == NULL) {
+        return SQLITE_NOMEM;
+    }
+    memcpy(pCur->zStr, zStr, nStr);
+    memcpy(pCur->zStr + nStr, zSep, nSep);
+    pCur->zStr[nStr + nSep] = 0;
+    pCur->nStr = nStr;
+    pCur->zSep = pCur->zStr + nStr;
+    pCur->nSep = nSep;
+    pCur->iPart = 1;
+    splitFind(pCur);
+    return SQLITE_OK;
+}
+
+static int splitBestIndex(sqlite3_vtab* pVTab, sqlite3_index_info* pIdxInfo) {
+    int aIdx[2] = {-1, -1}; /* Constraints on str and sep */
+    const struct sqlite3_index_constraint* pConstraint = pIdxInfo->aConstraint;
+    for (int i = 0; i < pIdxInfo->nConstraint; i++, pConstraint++) {
+        if (pConstraint->iColumn < SPLIT_COLUMN_STR) {
+            continue;
+        }
+        if (!pConstraint->usable || pConstraint->op != SQLITE_INDEX_CONSTRAINT_EQ) {
+            return SQLITE_CONSTRAINT;
+        }
+        aIdx[pConstraint->iColumn - SPLIT_COLUMN_STR] = i;
+    }
+    if (aIdx[0] < 0 || aIdx[1] < 0) {
+        sqlite3_free(pVTab->zErrMsg);
+        pVTab->zErrMsg = sqlite3_mprintf("text_split_rows: expected str and sep arguments");
+        return SQLITE_ERROR;
+    }
+    for (int i = 0; i < 2; i++) {
+        pIdxInfo->aConstraintUsage[aIdx[i]].argvIndex = i + 1;
+        pIdxInfo->aConstraintUsage[aIdx[i]].omit = 1;
+    }
+    pIdxInfo->idxNum = 1;
+    pIdxInfo->estimatedCost = 1;
+    pIdxInfo->estimatedRows = 100;
+    return SQLITE_OK;
+}
+
+static sqlite3_module split_module = {
+    .xConnect = splitConnect,
+    .xBestIndex = splitBestIndex,
+    .xDisconnect = splitDisconnect,
+    .xOpen = splitOpen,
+    .xClose = splitClose,
+    .xFilter = splitFilter,
+    .xNext = splitNext,
+    .xEof = splitEof,
+    .xColumn = splitColumn,
+    .xRowid = splitRowid,
+};
+
+#pragma endregion
+
 #pragma region Trim and pad
 
+// TrimFunc trims the string using the byte kernel for ASCII characters
+// or the UTF-8 kernel otherwise.
+typedef struct {
+    ByteString (*ascii)(ByteString, ByteString);
+    Utf8String (*utf8)(Utf8String, Utf8String);
+} TrimFunc;
+
+static const TrimFunc trim_left = {bstring_trim_left_chars, ustring_trim_left};
+static const TrimFunc trim_right = {bstring_trim_right_chars, ustring_trim_right};
+static const TrimFunc trim_both = {bstring_trim_chars, ustring_trim};
+
 // Trims certain characters (spaces by default) from the beginning/end of the string.
 // text_ltrim(str [,chars])
 // text_rtrim(str [,chars])
@@ -612,18 +1085,34 @@ static void text_trim(sqlite3_context* context, int argc, sqlite3_value** argv)
         return;
     }
 
-    RuneString (*trim_func)(RuneString, RuneString) = (void*)sqlite3_user_data(context);
+    const TrimFunc* trim_func = sqlite3_user_data(context);
+    size_t n_chars = argc == 2 ? sqlite3_value_bytes(argv[1]) : 1;
 
-    RuneString s_src = rstring_from_cstring(src);
-    RuneString s_chars = rstring_from_cstring(chars);
-    RuneString s_res = trim_func(s_src, s_chars);
-    const char* res = rstring_to_cstring(s_res);
-    sqlite3_result_text(context, res, -1, free);
-    rstring_free(s_src);
-    rstring_free(s_chars);
-    rstring_free(s_res);
+    // ASCII characters never occur inside multi-byte UTF-8 characters,
+    // so ASCII `chars` can be trimmed byte by byte from any string
+    if (text_is_ascii(chars, n_chars)) {
+        ByteString b_src = bstring_from_cstring(src, sqlite3_value_bytes(argv[0]));
+        ByteString b_chars = bstring_from_cstring(chars, n_chars);
+        text_result_bstring(context, trim_func->ascii(b_src, b_chars));
+        return;
+    }
+
+    Utf8String s_src = ustring_from_cstring(src, sqlite3_value_bytes(argv[0]));
+    Utf8String s_chars = ustring_from_cstring(chars, n_chars);
+    Utf8String s_res = trim_func->utf8(s_src, s_chars);
+    sqlite3_result_text(context, s_res.bytes, s_res.size, SQLITE_TRANSIENT);
 }
 
+// PadFunc pads the string using the byte kernel for ASCII strings
+// or the rune kernel otherwise.
+typedef struct {
+    ByteString (*ascii)(ByteString, size_t, ByteString);
+    RuneString (*runes)(RuneString, size_t, RuneString);
+} PadFunc;
+
+static const PadFunc pad_left = {bstring_pad_left, rstring_pad_left};
+static const PadFunc pad_right = {bstring_pad_right, rstring_pad_right};
+
 // Pads the string to the specified length by prepending/appending certain characters
 // (spaces by default).
 // text_lpad(str, length [,fill])
@@ -631,7 +1120,10 @@ static void text_trim(sqlite3_context* context, int argc, sqlite3_value** argv)
 // [pg-compatible] lpad(string, length [, fill])
 // [pg-compatible] rpad(string, length [, fill])
 // (!) postgres does not support unicode strings in lpad/rpad, while this function does.
-static void text_pad(sqlite3_context* context, int argc, sqlite3_value** argv) {
+static void text_pad(sqlite3_context* context,
+                     int argc,
+                     sqlite3_value** argv,
+                     const PadFunc* pad_func) {
     if (argc != 2 && argc != 3) {
         sqlite3_result_error(context, "expected 2 or 3 parameters", -1);
         return;
@@ -657,11 +1149,29 @@ static void text_pad(sqlite3_context* context, int argc, sqlite3_value** argv) {
         return;
     }
 
-    RuneString (*pad_func)(RuneString, size_t, RuneString) = (void*)sqlite3_user_data(context);
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    size_t n_fill = argc == 3 ? sqlite3_value_bytes(argv[2]) : 1;
+
+    const CharIndex* index = text_char_index(context, src, n_src);
+    bool src_ascii = index != NULL ? charindex_is_ascii(index) : text_is_ascii(src, n_src);
+    if (src_ascii && text_is_ascii(fill, n_fill)) {
+        ByteString b_src = bstring_from_cstring(src, n_src);
+        ByteString b_fill = bstring_from_cstring(fill, n_fill);
+        text_result_bstring(context, pad_func->ascii(b_src, length, b_fill));
+        return;
+    }
+
+    // a string that is already long enough is only truncated
+    if (index != NULL && charindex_length(index) >= (size_t)length) {
+        Utf8String s_src = ustring_from_cstring(src, n_src);
+        Utf8String s_res = charindex_substring(index, s_src, 0, length);
+        sqlite3_result_text(context, s_res.bytes, s_res.size, SQLITE_TRANSIENT);
+        return;
+    }
 
     RuneString s_src = rstring_from_cstring(src);
     RuneString s_fill = rstring_from_cstring(fill);
-    RuneString s_res = pad_func(s_src, length, s_fill);
+    RuneString s_res = pad_func->runes(s_src, length, s_fill);
     const char* res = rstring_to_cstring(s_res);
     sqlite3_result_text(context, res, -1, free);
     rstring_free(s_src);
@@ -669,6 +1179,16 @@ static void text_pad(sqlite3_context* context, int argc, sqlite3_value** argv) {
     rstring_free(s_res);
 }
 
+// text_lpad(str, length [,fill])
+static void text_lpad(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    text_pad(context, argc, argv, &pad_left);
+}
+
+// text_rpad(str, length [,fill])
+static void text_rpad(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    text_pad(context, argc, argv, &pad_right);
+}
+
 #pragma endregion
 
 #pragma region Change case
@@ -688,18 +1208,26 @@ static void text_change_case(sqlite3_context* context, int argc, sqlite3_value**
     }
     size_t n = sqlite3_value_bytes(argv[0]);
 
+    // most characters keep their utf8 length when changing case,
+    // so the result usually fits into a buffer of the same size
+    size_t (*fn)(const char*, size_t, char*, size_t) = sqlite3_user_data(context);
     char* res = malloc(n + 1);
     if (res == NULL) {
         sqlite3_result_error_nomem(context);
         return;
     }
-    memcpy(res, src, n);
-    res[n] = '\0';
-
-    bool (*fn)(char*, size_t) = sqlite3_user_data(context);
-    fn(res, n);
+    size_t size = fn(src, n, res, n);
+    if (size > n) {
+        free(res);
+        res = malloc(size + 1);
+        if (res == NULL) {
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+        fn(src, n, res, size);
+    }
 
-    sqlite3_result_text(context, res, n, free);
+    sqlite3_result_text(context, res, size, free);
 }
 
 #pragma endregion
@@ -786,6 +1314,9 @@ static void text_replace(sqlite3_context* context, int argc, sqlite3_value** arg
     bstring_free(s_res);
 }
 
+// Auxdata marker for the `to` argument of text_translate.
+static char text_translate_marker;
+
 // Replaces each string character that matches a character in the `from` set
 // with the corresponding character in the `to` set. If `from` is longer than `to`,
 // occurrences of the extra characters in `from` are deleted.
@@ -813,16 +1344,101 @@ static void text_translate(sqlite3_context* context, int argc, sqlite3_value** a
         return;
     }
 
-    RuneString s_src = rstring_from_cstring(src);
-    RuneString s_from = rstring_from_cstring(from);
-    RuneString s_to = rstring_from_cstring(to);
-    RuneString s_res = rstring_translate(s_src, s_from, s_to);
-    char* res = rstring_to_cstring(s_res);
-    sqlite3_result_text(context, res, -1, free);
-    rstring_free(s_src);
-    rstring_free(s_from);
-    rstring_free(s_to);
-    rstring_free(s_res);
+    // the mapping is compiled once per query if `from` and `to` are constant:
+    // SQLite keeps the auxdata of each argument only while it stays the same,
+    // so the `to` argument gets a marker to check that it did not change
+    Translation* tr = sqlite3_get_auxdata(context, 1);
+    bool is_new = tr == NULL || sqlite3_get_auxdata(context, 2) == NULL;
+    if (is_new) {
+        tr = translate_compile(from, sqlite3_value_bytes(argv[1]), to, sqlite3_value_bytes(argv[2]));
+        if (tr == NULL) {
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+    }
+
+    // the result is usually no longer than the original string
+    size_t n = sqlite3_value_bytes(argv[0]);
+    char* res = malloc(n + 1);
+    size_t size = res == NULL ? 0 : translate_apply(tr, src, n, res, n);
+    if (res != NULL && size > n) {
+        free(res);
+        res = malloc(size + 1);
+        if (res != NULL) {
+            translate_apply(tr, src, n, res, size);
+        }
+    }
+
+    if (is_new) {
+        sqlite3_set_auxdata(context, 1, tr, (void (*)(void*))translate_free);
+        sqlite3_set_auxdata(context, 2, &text_translate_marker, NULL);
+    }
+    if (res == NULL) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    sqlite3_result_text(context, res, size, free);
+}
+
+// text_replacer_free frees the replacer kept as the function auxdata.
+static void text_replacer_free(void* replacer) {
+    replacer_free(replacer);
+}
+
+// Replaces all occurrences of the JSON object keys in the string with their values
+// in a single pass. Matches are replaced from left to right, preferring the longest key
+// at the same position, and replacements are not replaced again.
+// text_replace_many(str, map)
+static void text_replace_many(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    assert(argc == 2);
+
+    const char* src = (char*)sqlite3_value_text(argv[0]);
+    if (src == NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    const char* map = (char*)sqlite3_value_text(argv[1]);
+    if (map == NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    // the map is compiled once per query if it's constant
+    Replacer* replacer = sqlite3_get_auxdata(context, 1);
+    bool is_new = replacer == NULL;
+    if (is_new) {
+        replacer = replacer_new();
+        if (replacer == NULL) {
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+        int rc = replacer_parse(replacer, map, sqlite3_value_bytes(argv[1]));
+        if (rc == REPLACER_OK && !replacer_build(replacer)) {
+            rc = REPLACER_NOMEM;
+        }
+        if (rc != REPLACER_OK) {
+            replacer_free(replacer);
+            if (rc == REPLACER_NOMEM) {
+                sqlite3_result_error_nomem(context);
+            } else {
+                sqlite3_result_error(
+                    context, "map parameter should be a JSON object of non-empty strings", -1);
+            }
+            return;
+        }
+    }
+
+    size_t size;
+    char* res = replacer_apply(replacer, src, sqlite3_value_bytes(argv[0]), &size);
+    if (is_new) {
+        sqlite3_set_auxdata(context, 1, replacer, text_replacer_free);
+    }
+    if (res == NULL) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    sqlite3_result_text(context, res, size, free);
 }
 
 // Reverses the order of the characters in the string.
@@ -838,6 +1454,13 @@ static void text_reverse(sqlite3_context* context, int argc, sqlite3_value** arg
         return;
     }
 
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    if (text_is_ascii(src, n_src)) {
+        ByteString b_src = bstring_from_cstring(src, n_src);
+        text_result_bstring(context, bstring_reverse(b_src));
+        return;
+    }
+
     RuneString s_src = rstring_from_cstring(src);
     RuneString s_res = rstring_reverse(s_src);
     char* res = rstring_to_cstring(s_res);
@@ -846,6 +1469,55 @@ static void text_reverse(sqlite3_context* context, int argc, sqlite3_value** arg
     rstring_free(s_res);
 }
 
+// Applies a comma-separated list of normalization steps to the string in a single pass.
+// Steps: trim, collapse_ws, lower, upper, casefold, strip_accents.
+// text_normalize(str, steps)
+static void text_normalize(sqlite3_context* context, int argc, sqlite3_value** argv) {
+    assert(argc == 2);
+
+    const char* src = (char*)sqlite3_value_text(argv[0]);
+    if (src == NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+
+    const char* steps_str = (char*)sqlite3_value_text(argv[1]);
+    if (steps_str == NULL) {
+        sqlite3_result_null(context);
+        return;
+    }
+    int steps = normalize_parse(steps_str, sqlite3_value_bytes(argv[1]));
+    if (steps < 0) {
+        sqlite3_result_error(context, "steps parameter should contain known steps only", -1);
+        return;
+    }
+    int case_steps = steps & (NORMALIZE_LOWER | NORMALIZE_UPPER | NORMALIZE_CASEFOLD);
+    if (case_steps & (case_steps - 1)) {
+        sqlite3_result_error(context, "steps parameter should contain one case step at most", -1);
+        return;
+    }
+
+    // the result is usually no longer than the original string
+    size_t n = sqlite3_value_bytes(argv[0]);
+    char* res = malloc(n + 1);
+    if (res == NULL) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+    size_t size = normalize(src, n, res, n, steps);
+    if (size > n) {
+        free(res);
+        res = malloc(size + 1);
+        if (res == NULL) {
+            sqlite3_result_error_nomem(context);
+            return;
+        }
+        normalize(src, n, res, size, steps);
+    }
+
+    sqlite3_result_text(context, res, size, free);
+}
+
 #pragma endregion
 
 #pragma region Properties
@@ -864,9 +1536,10 @@ static void text_length(sqlite3_context* context, int argc, sqlite3_value** argv
         return;
     }
 
-    RuneString s_src = rstring_from_cstring(src);
-    sqlite3_result_int64(context, s_src.length);
-    rstring_free(s_src);
+    size_t n_src = sqlite3_value_bytes(argv[0]);
+    Utf8String s_src = ustring_from_cstring(src, n_src);
+    const CharIndex* index = text_char_index(context, src, n_src);
+    sqlite3_result_int64(context, text_length_of(&s_src, index));
 }
 
 // Returns the number of bytes in the string.
@@ -911,18 +1584,36 @@ static int collate_nocase(void* unused, int n1, const void* s1, int n2, const vo
 
 #pragma endregion
 
+// text_create_indexed registers a function that looks up character
+// indexes in the connection cache. Each function holds a reference
+// to the cache, which SQLite drops when the function goes away.
+static void text_create_indexed(sqlite3* db,
+                                const char* name,
+                                int nargs,
+                                CharIndexCache* cache,
+                                void (*func)(sqlite3_context*, int, sqlite3_value**)) {
+    static const int flags = SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC;
+    charindex_cache_retain(cache);
+    sqlite3_create_function_v2(db, name, nargs, flags, cache, func, 0, 0,
+                               (void (*)(void*))charindex_cache_release);
+}
+
 int text_init(sqlite3* db) {
     static const int flags = SQLITE_UTF8 | SQLITE_INNOCUOUS | SQLITE_DETERMINISTIC;
+    CharIndexCache* cache = charindex_cache_new();
+    if (cache == NULL) {
+        return SQLITE_NOMEM;
+    }
 
     // substrings
-    sqlite3_create_function(db, "text_substring", 2, flags, 0, text_substring2, 0, 0);
-    sqlite3_create_function(db, "text_substring", 3, flags, 0, text_substring3, 0, 0);
-    sqlite3_create_function(db, "text_slice", 2, flags, 0, text_slice2, 0, 0);
-    sqlite3_create_function(db, "text_slice", 3, flags, 0, text_slice3, 0, 0);
-    sqlite3_create_function(db, "text_left", 2, flags, 0, text_left, 0, 0);
-    sqlite3_create_function(db, "left", 2, flags, 0, text_left, 0, 0);
-    sqlite3_create_function(db, "text_right", 2, flags, 0, text_right, 0, 0);
-    sqlite3_create_function(db, "right", 2, flags, 0, text_right, 0, 0);
+    text_create_indexed(db, "text_substring", 2, cache, text_substring2);
+    text_create_indexed(db, "text_substring", 3, cache, text_substring3);
+    text_create_indexed(db, "text_slice", 2, cache, text_slice2);
+    text_create_indexed(db, "text_slice", 3, cache, text_slice3);
+    text_create_indexed(db, "text_left", 2, cache, text_left);
+    text_create_indexed(db, "left", 2, cache, text_left);
+    text_create_indexed(db, "text_right", 2, cache, text_right);
+    text_create_indexed(db, "right", 2, cache, text_right);
 
     // search and match
     sqlite3_create_function(db, "text_index", 2, flags, 0, text_index, 0, 0);
@@ -938,24 +1629,28 @@ int text_init(sqlite3* db) {
     // split and join
     sqlite3_create_function(db, "text_split", 3, flags, 0, text_split, 0, 0);
     sqlite3_create_function(db, "split_part", 3, flags, 0, text_split, 0, 0);
+    sqlite3_create_module(db, "text_split_rows", &split_module, 0);
     sqlite3_create_function(db, "text_join", -1, flags, 0, text_join, 0, 0);
     sqlite3_create_function(db, "concat_ws", -1, flags, 0, text_join, 0, 0);
+    sqlite3_create_window_function(db, "text_join_agg", 2, flags, 0, text_join_agg_step,
+                                   text_join_agg_final, text_join_agg_value,
+                                   text_join_agg_inverse, 0);
     sqlite3_create_function(db, "text_concat", -1, flags, 0, text_concat, 0, 0);
     sqlite3_create_function(db, "concat", -1, flags, 0, text_concat, 0, 0);
     sqlite3_create_function(db, "text_repeat", 2, flags, 0, text_repeat, 0, 0);
     sqlite3_create_function(db, "repeat", 2, flags, 0, text_repeat, 0, 0);
 
     // trim and pad
-    sqlite3_create_function(db, "text_ltrim", -1, flags, rstring_trim_left, text_trim, 0, 0);
-    sqlite3_create_function(db, "ltrim", -1, flags, rstring_trim_left, text_trim, 0, 0);
-    sqlite3_create_function(db, "text_rtrim", -1, flags, rstring_trim_right, text_trim, 0, 0);
-    sqlite3_create_function(db, "rtrim", -1, flags, rstring_trim_right, text_trim, 0, 0);
-    sqlite3_create_function(db, "text_trim", -1, flags, rstring_trim, text_trim, 0, 0);
-    sqlite3_create_function(db, "btrim", -1, flags, rstring_trim, text_trim, 0, 0);
-    sqlite3_create_function(db, "text_lpad", -1, flags, rstring_pad_left, text_pad, 0, 0);
-    sqlite3_create_function(db, "lpad", -1, flags, rstring_pad_left, text_pad, 0, 0);
-    sqlite3_create_function(db, "text_rpad", -1, flags, rstring_pad_right, text_pad, 0, 0);
-    sqlite3_create_function(db, "rpad", -1, flags, rstring_pad_right, text_pad, 0, 0);
+    sqlite3_create_function(db, "text_ltrim", -1, flags, (void*)&trim_left, text_trim, 0, 0);
+    sqlite3_create_function(db, "ltrim", -1, flags, (void*)&trim_left, text_trim, 0, 0);
+    sqlite3_create_function(db, "text_rtrim", -1, flags, (void*)&trim_right, text_trim, 0, 0);
+    sqlite3_create_function(db, "rtrim", -1, flags, (void*)&trim_right, text_trim, 0, 0);
+    sqlite3_create_function(db, "text_trim", -1, flags, (void*)&trim_both, text_trim, 0, 0);
+    sqlite3_create_function(db, "btrim", -1, flags, (void*)&trim_both, text_trim, 0, 0);
+    text_create_indexed(db, "text_lpad", -1, cache, text_lpad);
+    text_create_indexed(db, "lpad", -1, cache, text_lpad);
+    text_create_indexed(db, "text_rpad", -1, cache, text_rpad);
+    text_create_indexed(db, "rpad", -1, cache, text_rpad);
 
     // change case
     sqlite3_create_function(db, "text_upper", 1, flags, utf8_toupper, text_change_case, 0, 0);
@@ -970,18 +1665,27 @@ int text_init(sqlite3* db) {
     sqlite3_create_function(db, "translate", 3, flags, 0, text_translate, 0, 0);
     sqlite3_create_function(db, "text_reverse", 1, flags, 0, text_reverse, 0, 0);
     sqlite3_create_function(db, "reverse", 1, flags, 0, text_reverse, 0, 0);
+    sqlite3_create_function(db, "text_normalize", 2, flags, 0, text_normalize, 0, 0);
+    sqlite3_create_function(db, "text_replace_many", 2, flags, 0, text_replace_many, 0, 0);
 
     // properties
-    sqlite3_create_function(db, "text_length", 1, flags, 0, text_length, 0, 0);
-    sqlite3_create_function(db, "char_length", 1, flags, 0, text_length, 0, 0);
-    sqlite3_create_function(db, "character_length", 1, flags, 0, text_length, 0, 0);
+    text_create_indexed(db, "text_length", 1, cache, text_length);
+    text_create_indexed(db, "char_length", 1, cache, text_length);
+    text_create_indexed(db, "character_length", 1, cache, text_length);
     sqlite3_create_function(db, "text_size", 1, flags, 0, text_size, 0, 0);
     sqlite3_create_function(db, "octet_length", 1, flags, 0, text_size, 0, 0);
     sqlite3_create_function(db, "text_bitsize", 1, flags, 0, text_bit_size, 0, 0);
     sqlite3_create_function(db, "bit_length", 1, flags, 0, text_bit_size, 0, 0);
 
+#if defined(TEXT_DEBUG)
+    sqlite3_create_function(db, "text_debug_counters", 0, SQLITE_UTF8, 0, text_debug_counters, 0,
+                            0);
+#endif
+
     // collation
     sqlite3_create_collation(db, "text_nocase", SQLITE_UTF8, NULL, collate_nocase);
 
+    // the functions hold their own references
+    charindex_cache_release(cache);
     return SQLITE_OK;
 }
@@ -0,0 +1,273 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Compiled LIKE patterns.
+//
+// The pattern is casefolded and split by '%' into segments.
+// Each segment is a sequence of literals and runs of '_',
+// so it always matches the same number of characters.
+// The first segment is matched at the start of the string (unless
+// the pattern starts with '%'), the last one at the end (unless the
+// pattern ends with '%'), and the ones in between are matched at
+// their leftmost position, found by searching for their first literal.
+// The string is casefolded too, so literals are compared as bytes.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/like.h"
+#include "text/search.h"
+#include "text/utf8/utf8.h"
+
+#define LIKE_FAIL SIZE_MAX
+
+// LikeItem is either a literal or a run of '_' wildcards.
+typedef struct {
+    const char* bytes;  // literal bytes, NULL for a run of '_'
+    size_t size;        // number of literal bytes or of '_'
+} LikeItem;
+
+// LikeSegment is a part of the pattern between '%' wildcards.
+typedef struct {
+    size_t first;    // index of the first item
+    size_t count;    // number of items
+    size_t n_chars;  // number of characters the segment matches
+} LikeSegment;
+
+struct LikePattern {
+    char* folded;           // casefolded pattern
+    LikeItem* items;        // items of all segments
+    LikeSegment* segments;  // segments in pattern order
+    size_t n_segments;
+    bool anchored_start;  // the pattern does not start with '%'
+    bool anchored_end;    // the pattern does not end with '%'
+    char* buf;            // casefolded string being matched
+    size_t buf_size;
+};
+
+// like_compile compiles the LIKE pattern, or returns NULL if out of memory.
+LikePattern* like_compile(const char* pattern, size_t n) {
+    LikePattern* pat = calloc(1, sizeof(LikePattern));
+    if (pat == NULL) {
+        return NULL;
+    }
+
+    size_t size = utf8_casefold(pattern, n, NULL, 0);
+    pat->folded = malloc(size + 1);
+    pat->items = malloc((size + 1) * sizeof(LikeItem));
+    pat->segments = malloc((size + 1) * sizeof(LikeSegment));
+    if (pat->folded == NULL || pat->items == NULL || pat->segments == NULL) {
+        like_free(pat);
+        return NULL;
+    }
+    utf8_casefold(pattern, n, pat->folded, size);
+    pat->folded[size] = '\0';
+    pat->anchored_start = size == 0 || pat->folded[0] != '%';
+    pat->anchored_end = size == 0 || pat->folded[size - 1] != '%';
+
+    // '%' and '_' are ASCII, so they never appear inside multi-byte characters
+    size_t n_items = 0;
+    LikeSegment* seg = NULL;
+    for (size_t idx = 0; idx < size; idx++) {
+        char chr = pat->folded[idx];
+        if (chr == '%') {
+            seg = NULL;
+            continue;
+        }
+        if (seg == NULL) {
+            seg = &pat->segments[pat->n_segments++];
+            seg->first = n_items;
+            seg->count = 0;
+            seg->n_chars = 0;
+        }
+        LikeItem* last = seg->count > 0 ? &pat->items[n_items - 1] : NULL;
+        if (chr == '_') {
+            if (last != NULL && last->bytes == NULL) {
+                last->size++;
+            } else {
+                pat->items[n_items++] = (LikeItem){.bytes = NULL, .size = 1};
+                seg->count++;
+            }
+            seg->n_chars++;
+        } else {
+            if (last != NULL && last->bytes != NULL) {
+                last->size++;
+            } else {
+                pat->items[n_items++] = (LikeItem){.bytes = pat->folded + idx, .size = 1};
+                seg->count++;
+            }
+            // count lead bytes only
+            if (((unsigned char)chr & 0xC0) != 0x80) {
+                seg->n_chars++;
+            }
+        }
+    }
+    return pat;
+}
+
+// like_forward returns the position `k` characters after `pos`.
+static size_t like_forward(const char* str, size_t limit, size_t pos, size_t k) {
+    for (size_t i = 0; i < k; i++) {
+        if (pos >= limit) {
+            return LIKE_FAIL;
+        }
+        pos++;
+        while (pos < limit && ((unsigned char)str[pos] & 0xC0) == 0x80) {
+            pos++;
+        }
+    }
+    return pos;
+}
+
+// like_back returns the position `k` characters before `pos`.
+static size_t like_back(const char* str, size_t pos, size_t k) {
+    for (size_t i = 0; i < k; i++) {
+        if (pos == 0) {
+            return LIKE_FAIL;
+        }
+        pos--;
+        while (pos > 0 && ((unsigned char)str[pos] & 0xC0) == 0x80) {
+            pos--;
+        }
+    }
+    return pos;
+}
+
+// like_match_at matches the segment at `pos` and returns the position after it.
+static size_t like_match_at(const LikePattern* pat,
+                            const LikeSegment* seg,
+                            const char* str,
+                            size_t limit,
+                            size_t pos) {
+    const LikeItem* items = pat->items + seg->first;
+    for (size_t i = 0; i < seg->count; i++) {
+        if (items[i].bytes == NULL) {
+            pos = like_forward(str, limit, pos, items[i].size);
+            if (pos == LIKE_FAIL) {
+                return LIKE_FAIL;
+            }
+        } else {
+            if (items[i].size > limit - pos || memcmp(str + pos, items[i].bytes, items[i].size)) {
+                return LIKE_FAIL;
+            }
+            pos += items[i].size;
+        }
+    }
+    return pos;
+}
+
+// like_find matches the segment at the leftmost position at or after `pos`
+// and returns the position after it.
+static size_t like_find(const LikePattern* pat,
+                        const LikeSegment* seg,
+                        const char* str,
+                        size_t limit,
+                        size_t pos) {
+    // a segment starts with a literal, or with a run of '_' followed by a literal
+    const LikeItem* items = pat->items + seg->first;
+    size_t lit = 0;
+    size_t n_before = 0;
+    if (items[0].bytes == NULL) {
+        n_before = items[0].size;
+        lit = 1;
+    }
+    if (lit == seg->count) {
+        return like_forward(str, limit, pos, n_before);
+    }
+
+    size_t from = like_forward(str, limit, pos, n_before);
+    while (from != LIKE_FAIL && from < limit) {
+        const char* at = search_first(str + from, limit - from, items[lit].bytes, items[lit].size);
+        if (at == NULL) {
+            return LIKE_FAIL;
+        }
+        size_t start = like_back(str, at - str, n_before);
+        size_t end = like_match_at(pat, seg, str, limit, start);
+        if (end != LIKE_FAIL) {
+            return end;
+        }
+        from = at - str + 1;
+    }
+    return LIKE_FAIL;
+}
+
+// like_match checks if the string matches the compiled pattern case-insensitively.
+// Returns 1 if it does, 0 if it does not, or -1 if out of memory.
+int like_match(LikePattern* pat, const char* str, size_t n) {
+    if (pat->n_segments == 0) {
+        // empty pattern or only '%'
+        return (pat->anchored_start && pat->anchored_end) ? n == 0 : 1;
+    }
+
+    // a prefix pattern ('abc%') only needs the first characters of the string,
+    // and a character takes at most 4 bytes
+    if (pat->anchored_start && !pat->anchored_end && pat->n_segments == 1) {
+        size_t max_size = pat->segments[0].n_chars * 4;
+        n = n < max_size ? n : max_size;
+    }
+
+    // the casefolded string is kept between calls to avoid allocations
+    size_t size = utf8_casefold(str, n, pat->buf, pat->buf_size);
+    if (size > pat->buf_size) {
+        size_t buf_size = pat->buf_size * 2 > size ? pat->buf_size * 2 : size;
+        char* buf = realloc(pat->buf, buf_size);
+        if (buf == NULL) {
+            return -1;
+        }
+        pat->buf = buf;
+        pat->buf_size = buf_size;
+        utf8_casefold(str, n, pat->buf, pat->buf_size);
+    }
+    const char* folded = pat->buf;
+
+    size_t first = 0;
+    size_t last = pat->n_segments;
+    size_t pos = 0;
+    size_t limit = size;
+
+    if (pat->anchored_start) {
+        pos = like_match_at(pat, &pat->segments[0], folded, limit, 0);
+        if (pos == LIKE_FAIL) {
+            return 0;
+        }
+        if (pat->anchored_end && last == 1) {
+            return pos == size;
+        }
+        first = 1;
+    }
+
+    if (pat->anchored_end) {
+        const LikeSegment* seg = &pat->segments[last - 1];
+        size_t start = like_back(folded, size, seg->n_chars);
+        if (start == LIKE_FAIL || start < pos) {
+            return 0;
+        }
+        if (like_match_at(pat, seg, folded, size, start) != size) {
+            return 0;
+        }
+        limit = start;
+        last--;
+    }
+
+    for (size_t i = first; i < last; i++) {
+        pos = like_find(pat, &pat->segments[i], folded, limit, pos);
+        if (pos == LIKE_FAIL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// like_free frees the compiled pattern.
+void like_free(LikePattern* pat) {
+    if (pat == NULL) {
+        return;
+    }
+    free(pat->folded);
+    free(pat->items);
+    free(pat->segments);
+    free(pat->buf);
+    free(pat);
+}
@@ -0,0 +1,22 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Compiled LIKE patterns.
+
+#ifndef LIKE_H
+#define LIKE_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef struct LikePattern LikePattern;
+
+// like_compile compiles the LIKE pattern, or returns NULL if out of memory.
+LikePattern* like_compile(const char* pattern, size_t n);
+// like_match checks if the string matches the compiled pattern case-insensitively.
+// Returns 1 if it does, 0 if it does not, or -1 if out of memory.
+int like_match(LikePattern* pattern, const char* str, size_t n);
+// like_free frees the compiled pattern.
+void like_free(LikePattern* pattern);
+
+#endif /* LIKE_H */
@@ -0,0 +1,224 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Fused text normalization.
+//
+// All the steps are applied to each character in a single pass,
+// so the string is decoded once and written once.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "text/normalize.h"
+#include "text/utf8/rune.h"
+#include "text/utf8/utf8.h"
+
+// Decoder state for an invalid byte sequence.
+#define UTF8_REJECT 12
+
+// normalize_parse parses a comma-separated list of steps,
+// e.g. "trim,lower", or returns -1 if there is an unknown step.
+int normalize_parse(const char* steps, size_t n) {
+    static const struct {
+        const char* name;
+        int step;
+    } names[] = {
+        {"trim", NORMALIZE_TRIM},
+        {"collapse_ws", NORMALIZE_COLLAPSE_WS},
+        {"lower", NORMALIZE_LOWER},
+        {"upper", NORMALIZE_UPPER},
+        {"casefold", NORMALIZE_CASEFOLD},
+        {"strip_accents", NORMALIZE_STRIP_ACCENTS},
+    };
+
+    int result = 0;
+    size_t idx = 0;
+    while (idx < n) {
+        // skip separators
+        while (idx < n && (steps[idx] == ',' || steps[idx] == ' ')) {
+            idx++;
+        }
+        size_t start = idx;
+        while (idx < n && steps[idx] != ',' && steps[idx] != ' ') {
+            idx++;
+        }
+        if (idx == start) {
+            break;
+        }
+        int step = 0;
+        for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (strlen(names[i].name) == idx - start &&
+                memcmp(names[i].name, steps + start, idx - start) == 0) {
+                step = names[i].step;
+                break;
+            }
+        }
+        if (step == 0) {
+            return -1;
+        }
+        result |= step;
+    }
+    return result;
+}
+
+// normalize_isspace checks if the ASCII character is whitespace.
+static inline bool normalize_isspace(uint8_t chr) {
+    return chr == ' ' || (chr >= '\t' && chr <= '\r');
+}
+
+// normalize_ascii_word converts 8 bytes from src to dst, flipping the case
+// of letters from `first` to `first`+25. Returns false without writing anything
+// if the word contains non-ASCII bytes, or, when `spaces` is true, control
+// characters or two spaces in a row (a single space is copied as is).
+static inline bool normalize_ascii_word(const char* src, char* dst, uint8_t first, bool spaces) {
+    const uint64_t high = 0x8080808080808080ULL;
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t low = 0x7f7f7f7f7f7f7f7fULL;
+    uint64_t word;
+    memcpy(&word, src, 8);
+    if (word & high) {
+        return false;
+    }
+    if (spaces) {
+        // a byte is below ' ' if subtracting ' ' borrows into its high bit
+        if ((word - ones * ' ') & ~word & high) {
+            return false;
+        }
+        // a byte is a space if it is zero after xor with ' '
+        uint64_t eq = word ^ (ones * ' ');
+        uint64_t is_space = ~(((eq & low) + low) | eq) & high;
+        if (is_space & (is_space << 8)) {
+            return false;
+        }
+    }
+    if (first < 0x80) {
+        // a byte is a letter if adding (0x80 - first) sets its high bit,
+        // but adding (0x7f - last) does not
+        uint64_t ge_first = word + ones * (uint8_t)(0x80 - first);
+        uint64_t gt_last = word + ones * (uint8_t)(0x7f - (first + 25));
+        word ^= (ge_first & ~gt_last & high) >> 2;
+    }
+    memcpy(dst, &word, 8);
+    return true;
+}
+
+// normalize writes the normalized string to dst.
+// Writes at most `size` bytes and returns the size of the normalized string.
+size_t normalize(const char* src, size_t n, char* dst, size_t size, int steps) {
+    const bool trim = steps & NORMALIZE_TRIM;
+    const bool collapse = steps & NORMALIZE_COLLAPSE_WS;
+    const bool strip = steps & NORMALIZE_STRIP_ACCENTS;
+    const bool spaces = trim || collapse;
+    // ASCII letters from `first` to `first`+25 have their case flipped
+    const uint8_t first = (steps & (NORMALIZE_LOWER | NORMALIZE_CASEFOLD)) ? 'A'
+                          : (steps & NORMALIZE_UPPER)                      ? 'a'
+                                                                           : 0x80;
+
+    size_t i = 0;        // position in src
+    size_t j = 0;        // position in dst
+    size_t keep = 0;     // position in dst after the last non-space character
+    bool in_ws = false;  // the previous character is whitespace
+    size_t scalar_end = 0;
+    while (i < n) {
+        // whole ASCII words, unless the previous word was not ASCII
+        // or the word starts with a space that should be dropped
+        if (i >= scalar_end && i + 8 <= n && j + 8 <= size &&
+            !(spaces && src[i] == ' ' && (in_ws || (trim && j == 0)))) {
+            if (normalize_ascii_word(src + i, dst + j, first, spaces)) {
+                i += 8;
+                j += 8;
+                // there are no two spaces in a row, so the one before is not a space
+                in_ws = spaces && src[i - 1] == ' ';
+                keep = in_ws ? j - 1 : j;
+                continue;
+            }
+            scalar_end = i + 8;
+        }
+
+        uint8_t byte = (uint8_t)src[i];
+
+        // ASCII characters need no decoding
+        if (byte < 0x80 && !(spaces && normalize_isspace(byte))) {
+            if (j < size) {
+                dst[j] = (char)((uint8_t)(byte - first) < 26 ? byte ^ 0x20 : byte);
+            }
+            i++;
+            keep = ++j;
+            in_ws = false;
+            continue;
+        }
+
+        uint32_t c;
+        char buf[4];
+        int len;
+        if (byte < 0x80) {
+            c = byte;
+            buf[0] = (char)byte;
+            len = 1;
+            i++;
+        } else {
+            utf8_decode_t d = {.state = 0};
+            size_t next = i;
+            do {
+                utf8_decode(&d, (uint8_t)src[next++]);
+            } while (d.state != 0 && d.state != UTF8_REJECT && next < n);
+
+            if (d.state != 0) {
+                // invalid sequence, copy the first byte and resync after it
+                c = byte;
+                buf[0] = (char)byte;
+                len = 1;
+                i++;
+            } else {
+                c = d.codep;
+                i = next;
+                if (strip) {
+                    if (rune_iscombining(c)) {
+                        continue;
+                    }
+                    c = rune_unaccent(c);
+                }
+                uint32_t out = c;
+                if (steps & NORMALIZE_LOWER) {
+                    out = rune_tolower(c);
+                } else if (steps & NORMALIZE_UPPER) {
+                    out = rune_toupper(c);
+                } else if (steps & NORMALIZE_CASEFOLD) {
+                    out = rune_casefold(c);
+                }
+                len = utf8_encode(buf, out);
+                if (len == 0) {
+                    len = utf8_encode(buf, c);
+                }
+            }
+        }
+
+        bool is_space = spaces && (c < 0x80 ? normalize_isspace((uint8_t)c) : rune_isspace(c));
+        if (is_space) {
+            if (trim && j == 0) {
+                // leading whitespace
+                continue;
+            }
+            if (collapse) {
+                if (in_ws) {
+                    continue;
+                }
+                buf[0] = ' ';
+                len = 1;
+            }
+        }
+        in_ws = is_space;
+
+        if (j + len <= size) {
+            memcpy(dst + j, buf, len);
+        }
+        j += len;
+        if (!in_ws) {
+            keep = j;
+        }
+    }
+
+    // trailing whitespace
+    return trim ? keep : j;
+}
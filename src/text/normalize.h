@@ -0,0 +1,28 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Fused text normalization.
+
+#ifndef NORMALIZE_H
+#define NORMALIZE_H
+
+#include <stdlib.h>
+
+// Normalization steps.
+enum {
+    NORMALIZE_TRIM = 1 << 0,           // remove leading and trailing whitespace
+    NORMALIZE_COLLAPSE_WS = 1 << 1,    // replace whitespace runs with a single space
+    NORMALIZE_LOWER = 1 << 2,          // convert to lower case
+    NORMALIZE_UPPER = 1 << 3,          // convert to upper case
+    NORMALIZE_CASEFOLD = 1 << 4,       // convert to folded case
+    NORMALIZE_STRIP_ACCENTS = 1 << 5,  // remove accents from letters
+};
+
+// normalize_parse parses a comma-separated list of steps,
+// e.g. "trim,lower", or returns -1 if there is an unknown step.
+int normalize_parse(const char* steps, size_t n);
+// normalize writes the normalized string to dst.
+// Writes at most `size` bytes and returns the size of the normalized string.
+size_t normalize(const char* src, size_t n, char* dst, size_t size, int steps);
+
+#endif /* NORMALIZE_H */
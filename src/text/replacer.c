@@ -0,0 +1,481 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Replacing many strings at once.
+//
+// The strings to replace are compiled into an Aho-Corasick automaton:
+// a trie of the strings, where each node also links to the node of its
+// longest proper suffix that is in the trie. The automaton finds all the
+// strings in a single pass over the source, whatever their number.
+// Matches are replaced leftmost first, preferring the longest string
+// at the same position, and the scan continues after the replacement.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/replacer.h"
+#include "text/utf8/utf8.h"
+
+// ReplacerNode is a trie node. Node 0 is the root, which is never a child,
+// so 0 also means "no node" in the links.
+typedef struct {
+    uint32_t child;    // first child
+    uint32_t sibling;  // next child of the parent
+    uint32_t fail;     // node of the longest proper suffix
+    uint32_t output;   // nearest node on the suffix links (this one included) that ends a string
+    uint32_t depth;    // number of bytes from the root
+    int32_t value;     // index of the replacement if the node ends a string, -1 otherwise
+    uint8_t byte;      // byte on the edge from the parent
+} ReplacerNode;
+
+// ReplacerValue is a replacement string.
+typedef struct {
+    char* bytes;
+    size_t size;
+} ReplacerValue;
+
+struct Replacer {
+    uint32_t root[256];  // children of the root by byte
+    ReplacerNode* nodes;
+    size_t n_nodes;
+    size_t nodes_cap;
+    ReplacerValue* values;
+    size_t n_values;
+    size_t values_cap;
+};
+
+// replacer_new creates a replacer without strings to replace,
+// or returns NULL if out of memory.
+Replacer* replacer_new(void) {
+    Replacer* r = calloc(1, sizeof(Replacer));
+    if (r == NULL) {
+        return NULL;
+    }
+    r->nodes_cap = 16;
+    r->nodes = calloc(r->nodes_cap, sizeof(ReplacerNode));
+    if (r->nodes == NULL) {
+        free(r);
+        return NULL;
+    }
+    r->nodes[0].value = -1;
+    r->n_nodes = 1;
+    return r;
+}
+
+// replacer_child returns the child of the node by byte, or 0 if there is none.
+static inline uint32_t replacer_child(const Replacer* r, uint32_t node, uint8_t byte) {
+    if (node == 0) {
+        return r->root[byte];
+    }
+    for (uint32_t child = r->nodes[node].child; child != 0; child = r->nodes[child].sibling) {
+        if (r->nodes[child].byte == byte) {
+            return child;
+        }
+    }
+    return 0;
+}
+
+// replacer_add_child adds a child to the node by byte and returns it,
+// or returns 0 if out of memory.
+static uint32_t replacer_add_child(Replacer* r, uint32_t node, uint8_t byte) {
+    if (r->n_nodes == r->nodes_cap) {
+        size_t cap = r->nodes_cap * 2;
+        ReplacerNode* nodes = realloc(r->nodes, cap * sizeof(ReplacerNode));
+        if (nodes == NULL) {
+            return 0;
+        }
+        r->nodes = nodes;
+        r->nodes_cap = cap;
+    }
+    uint32_t child = (uint32_t)r->n_nodes++;
+    ReplacerNode* n_child = &r->nodes[child];
+    memset(n_child, 0, sizeof(ReplacerNode));
+    n_child->value = -1;
+    n_child->byte = byte;
+    n_child->depth = r->nodes[node].depth + 1;
+    if (node == 0) {
+        r->root[byte] = child;
+    } else {
+        n_child->sibling = r->nodes[node].child;
+        r->nodes[node].child = child;
+    }
+    return child;
+}
+
+// replacer_add adds a non-empty string to replace and its replacement.
+// If the string is already added, its replacement is updated.
+// Returns false if out of memory.
+bool replacer_add(Replacer* r, const char* from, size_t n_from, const char* to, size_t n_to) {
+    uint32_t node = 0;
+    for (size_t i = 0; i < n_from; i++) {
+        uint32_t child = replacer_child(r, node, (uint8_t)from[i]);
+        if (child == 0) {
+            child = replacer_add_child(r, node, (uint8_t)from[i]);
+            if (child == 0) {
+                return false;
+            }
+        }
+        node = child;
+    }
+
+    char* bytes = malloc(n_to + 1);
+    if (bytes == NULL) {
+        return false;
+    }
+    memcpy(bytes, to, n_to);
+    bytes[n_to] = '\0';
+
+    if (r->nodes[node].value >= 0) {
+        ReplacerValue* value = &r->values[r->nodes[node].value];
+        free(value->bytes);
+        value->bytes = bytes;
+        value->size = n_to;
+        return true;
+    }
+
+    if (r->n_values == r->values_cap) {
+        size_t cap = r->values_cap == 0 ? 16 : r->values_cap * 2;
+        ReplacerValue* values = realloc(r->values, cap * sizeof(ReplacerValue));
+        if (values == NULL) {
+            free(bytes);
+            return false;
+        }
+        r->values = values;
+        r->values_cap = cap;
+    }
+    r->values[r->n_values] = (ReplacerValue){.bytes = bytes, .size = n_to};
+    r->nodes[node].value = (int32_t)r->n_values++;
+    return true;
+}
+
+// replacer_skip_ws skips the JSON whitespace at `*pos`.
+static void replacer_skip_ws(const char* json, size_t n, size_t* pos) {
+    while (*pos < n && (json[*pos] == ' ' || json[*pos] == '\t' || json[*pos] == '\n' ||
+                        json[*pos] == '\r')) {
+        *pos += 1;
+    }
+}
+
+// replacer_parse_hex parses 4 hex digits at `*pos`, or returns -1 if invalid.
+static int32_t replacer_parse_hex(const char* json, size_t n, size_t* pos) {
+    if (n - *pos < 4) {
+        return -1;
+    }
+    int32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        char chr = json[*pos + i];
+        int digit = (chr >= '0' && chr <= '9')   ? chr - '0'
+                    : (chr >= 'a' && chr <= 'f') ? chr - 'a' + 10
+                    : (chr >= 'A' && chr <= 'F') ? chr - 'A' + 10
+                                                 : -1;
+        if (digit < 0) {
+            return -1;
+        }
+        value = value * 16 + digit;
+    }
+    *pos += 4;
+    return value;
+}
+
+// replacer_parse_string parses the JSON string at `*pos` into dst,
+// which should be at least as large as the rest of the JSON.
+// Returns false if the string is invalid.
+static bool replacer_parse_string(const char* json,
+                                  size_t n,
+                                  size_t* pos,
+                                  char* dst,
+                                  size_t* size) {
+    if (*pos >= n || json[*pos] != '"') {
+        return false;
+    }
+    size_t i = *pos + 1;
+    size_t j = 0;
+    while (i < n && json[i] != '"') {
+        char chr = json[i++];
+        if ((unsigned char)chr < 0x20) {
+            return false;
+        }
+        if (chr != '\\') {
+            dst[j++] = chr;
+            continue;
+        }
+        if (i >= n) {
+            return false;
+        }
+        chr = json[i++];
+        switch (chr) {
+            case '"':
+            case '\\':
+            case '/':
+                dst[j++] = chr;
+                break;
+            case 'b':
+                dst[j++] = '\b';
+                break;
+            case 'f':
+                dst[j++] = '\f';
+                break;
+            case 'n':
+                dst[j++] = '\n';
+                break;
+            case 'r':
+                dst[j++] = '\r';
+                break;
+            case 't':
+                dst[j++] = '\t';
+                break;
+            case 'u': {
+                int32_t c = replacer_parse_hex(json, n, &i);
+                if (c >= 0xD800 && c <= 0xDBFF) {
+                    // a surrogate pair
+                    if (n - i < 2 || json[i] != '\\' || json[i + 1] != 'u') {
+                        return false;
+                    }
+                    i += 2;
+                    int32_t low = replacer_parse_hex(json, n, &i);
+                    if (low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                }
+                // lone low surrogates and invalid digits are not encoded
+                int len = c < 0 ? 0 : utf8_encode(dst + j, (uint32_t)c);
+                if (len == 0) {
+                    return false;
+                }
+                j += len;
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    if (i >= n) {
+        return false;
+    }
+    *pos = i + 1;
+    *size = j;
+    return true;
+}
+
+// replacer_parse adds the strings to replace from a JSON object
+// that maps them to their replacements, e.g. {"cat": "dog"}.
+// Returns REPLACER_OK, REPLACER_INVALID if the JSON is not an object
+// of non-empty keys with string values, or REPLACER_NOMEM.
+int replacer_parse(Replacer* r, const char* json, size_t n) {
+    // an escaped string is never shorter than the unescaped one
+    char* key = malloc(n + 1);
+    char* value = malloc(n + 1);
+    if (key == NULL || value == NULL) {
+        free(key);
+        free(value);
+        return REPLACER_NOMEM;
+    }
+
+    int rc = REPLACER_INVALID;
+    size_t pos = 0;
+    replacer_skip_ws(json, n, &pos);
+    if (pos >= n || json[pos] != '{') {
+        goto done;
+    }
+    pos++;
+    replacer_skip_ws(json, n, &pos);
+    if (pos < n && json[pos] == '}') {
+        pos++;
+    } else {
+        for (;;) {
+            size_t n_key, n_value;
+            replacer_skip_ws(json, n, &pos);
+            if (!replacer_parse_string(json, n, &pos, key, &n_key) || n_key == 0) {
+                goto done;
+            }
+            replacer_skip_ws(json, n, &pos);
+            if (pos >= n || json[pos] != ':') {
+                goto done;
+            }
+            pos++;
+            replacer_skip_ws(json, n, &pos);
+            if (!replacer_parse_string(json, n, &pos, value, &n_value)) {
+                goto done;
+            }
+            if (!replacer_add(r, key, n_key, value, n_value)) {
+                rc = REPLACER_NOMEM;
+                goto done;
+            }
+            replacer_skip_ws(json, n, &pos);
+            if (pos < n && json[pos] == ',') {
+                pos++;
+                continue;
+            }
+            if (pos < n && json[pos] == '}') {
+                pos++;
+                break;
+            }
+            goto done;
+        }
+    }
+    replacer_skip_ws(json, n, &pos);
+    if (pos == n) {
+        rc = REPLACER_OK;
+    }
+
+done:
+    free(key);
+    free(value);
+    return rc;
+}
+
+// replacer_build prepares the replacer after all the strings are added:
+// links each node to the node of its longest proper suffix, visiting
+// the nodes in breadth-first order so that the shorter suffixes are linked first.
+// Returns false if out of memory.
+bool replacer_build(Replacer* r) {
+    uint32_t* queue = malloc(r->n_nodes * sizeof(uint32_t));
+    if (queue == NULL) {
+        return false;
+    }
+    size_t head = 0;
+    size_t tail = 0;
+    for (int byte = 0; byte < 256; byte++) {
+        uint32_t node = r->root[byte];
+        if (node != 0) {
+            r->nodes[node].fail = 0;
+            r->nodes[node].output = r->nodes[node].value >= 0 ? node : 0;
+            queue[tail++] = node;
+        }
+    }
+    while (head < tail) {
+        uint32_t node = queue[head++];
+        for (uint32_t child = r->nodes[node].child; child != 0; child = r->nodes[child].sibling) {
+            uint8_t byte = r->nodes[child].byte;
+            uint32_t fail = r->nodes[node].fail;
+            uint32_t next;
+            while ((next = replacer_child(r, fail, byte)) == 0 && fail != 0) {
+                fail = r->nodes[fail].fail;
+            }
+            ReplacerNode* n_child = &r->nodes[child];
+            n_child->fail = next;
+            n_child->output = n_child->value >= 0 ? child : r->nodes[next].output;
+            queue[tail++] = child;
+        }
+    }
+    free(queue);
+    return true;
+}
+
+// replacer_step moves the automaton from the node by byte.
+static inline uint32_t replacer_step(const Replacer* r, uint32_t node, uint8_t byte) {
+    uint32_t next;
+    while ((next = replacer_child(r, node, byte)) == 0 && node != 0) {
+        node = r->nodes[node].fail;
+    }
+    return next;
+}
+
+// ReplacerBuffer is a growing result string.
+typedef struct {
+    char* bytes;
+    size_t size;
+    size_t capacity;
+} ReplacerBuffer;
+
+// replacer_append appends bytes to the buffer. Returns false if out of memory.
+static bool replacer_append(ReplacerBuffer* buf, const char* bytes, size_t n) {
+    if (buf->size + n + 1 > buf->capacity) {
+        size_t capacity = buf->capacity * 2;
+        if (capacity < buf->size + n + 1) {
+            capacity = buf->size + n + 1;
+        }
+        char* grown = realloc(buf->bytes, capacity);
+        if (grown == NULL) {
+            return false;
+        }
+        buf->bytes = grown;
+        buf->capacity = capacity;
+    }
+    memcpy(buf->bytes + buf->size, bytes, n);
+    buf->size += n;
+    return true;
+}
+
+// replacer_apply returns a new string with all the replacements made,
+// or NULL if out of memory. Sets `size` to the size of the new string.
+char* replacer_apply(const Replacer* r, const char* src, size_t n, size_t* size) {
+    ReplacerBuffer buf = {.bytes = malloc(n + 1), .size = 0, .capacity = n + 1};
+    if (buf.bytes == NULL) {
+        return NULL;
+    }
+
+    size_t copied = 0;  // the source is copied to the result up to this position
+    size_t i = 0;       // position in the source
+    uint32_t node = 0;  // current automaton node
+
+    // leftmost-longest match found so far
+    int32_t match = -1;
+    size_t match_start = 0;
+    size_t match_end = 0;
+
+    for (;;) {
+        if (node == 0 && match < 0) {
+            // skip the bytes that do not start any string
+            while (i < n && r->root[(uint8_t)src[i]] == 0) {
+                i++;
+            }
+        }
+        if (i < n) {
+            node = replacer_step(r, node, (uint8_t)src[i]);
+            i++;
+            uint32_t output = r->nodes[node].output;
+            if (output != 0) {
+                size_t start = i - r->nodes[output].depth;
+                if (match < 0 || start < match_start || (start == match_start && i > match_end)) {
+                    match = r->nodes[output].value;
+                    match_start = start;
+                    match_end = i;
+                }
+            }
+            // a later match starts no earlier than the string the current node spells,
+            // so it may still start before the found one or extend it
+            if (match < 0 || i - r->nodes[node].depth <= match_start) {
+                continue;
+            }
+        } else if (match < 0) {
+            break;
+        }
+
+        // replace the match and scan again from its end
+        const ReplacerValue* value = &r->values[match];
+        if (!replacer_append(&buf, src + copied, match_start - copied) ||
+            !replacer_append(&buf, value->bytes, value->size)) {
+            free(buf.bytes);
+            return NULL;
+        }
+        copied = match_end;
+        i = match_end;
+        node = 0;
+        match = -1;
+    }
+
+    if (!replacer_append(&buf, src + copied, n - copied)) {
+        free(buf.bytes);
+        return NULL;
+    }
+    buf.bytes[buf.size] = '\0';
+    *size = buf.size;
+    return buf.bytes;
+}
+
+// replacer_free frees the replacer.
+void replacer_free(Replacer* r) {
+    if (r == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < r->n_values; i++) {
+        free(r->values[i].bytes);
+    }
+    free(r->values);
+    free(r->nodes);
+    free(r);
+}
@@ -0,0 +1,39 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Replacing many strings at once.
+
+#ifndef REPLACER_H
+#define REPLACER_H
+
+#include <stdbool.h>
+#include <stdlib.h>
+
+// replacer_parse results.
+enum {
+    REPLACER_OK = 0,
+    REPLACER_INVALID = -1,  // invalid JSON or an empty key
+    REPLACER_NOMEM = -2,    // out of memory
+};
+
+typedef struct Replacer Replacer;
+
+// replacer_new creates a replacer without strings to replace,
+// or returns NULL if out of memory.
+Replacer* replacer_new(void);
+// replacer_add adds a non-empty string to replace and its replacement.
+// Returns false if out of memory.
+bool replacer_add(Replacer* r, const char* from, size_t n_from, const char* to, size_t n_to);
+// replacer_parse adds the strings to replace from a JSON object
+// that maps them to their replacements, e.g. {"cat": "dog"}.
+int replacer_parse(Replacer* r, const char* json, size_t n);
+// replacer_build prepares the replacer after all the strings are added.
+// Returns false if out of memory.
+bool replacer_build(Replacer* r);
+// replacer_apply returns a new string with all the replacements made,
+// or NULL if out of memory. Sets `size` to the size of the new string.
+char* replacer_apply(const Replacer* r, const char* src, size_t n, size_t* size);
+// replacer_free frees the replacer.
+void replacer_free(Replacer* r);
+
+#endif /* REPLACER_H */
@@ -233,8 +233,9 @@ bool rstring_like(RuneString pattern, RuneString str) {
         int32_t srune = str.runes[sidx];
 
         if (prune == '%') {
+            // '%' matches nothing at first, and one more character on each retry
             star_idx = ++pidx;
-            match = ++sidx;
+            match = sidx;
             if (pidx == pattern.length) {
                 return true;
             }
@@ -243,7 +244,7 @@ bool rstring_like(RuneString pattern, RuneString str) {
             sidx++;
         } else if (star_idx != SIZE_MAX) {
             pidx = star_idx;
-            sidx = match++;
+            sidx = ++match;
         } else {
             return false;
         }
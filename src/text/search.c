@@ -0,0 +1,248 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Substring search.
+// Short needles are found by comparing their first and last bytes
+// with 16 haystack positions at a time, and checking the middle
+// of each candidate. Long needles use the Two-Way algorithm
+// (Crochemore & Perrin), which is linear in the worst case.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/search.h"
+
+// Vector instruction set used to filter candidates.
+// SSE2 is always available on x86-64 and NEON on AArch64.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SEARCH_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SEARCH_NEON 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static int search_ctz64(uint64_t x) {
+    unsigned long i;
+#if defined(_WIN64)
+    _BitScanForward64(&i, x);
+#else
+    if (_BitScanForward(&i, (unsigned long)x) == 0) {
+        _BitScanForward(&i, (unsigned long)(x >> 32));
+        i += 32;
+    }
+#endif
+    return (int)i;
+}
+#else
+#define search_ctz64(x) __builtin_ctzll(x)
+#endif
+
+// Longest needle searched by filtering first and last bytes.
+#define SEARCH_SHORT_NEEDLE 32
+
+// search_short finds a needle of 2 or more bytes by its first and last bytes.
+static const char* search_short(const char* haystack, size_t n, const char* needle, size_t m) {
+    const unsigned char* h = (const unsigned char*)haystack;
+    const unsigned char first = (unsigned char)needle[0];
+    const unsigned char last = (unsigned char)needle[m - 1];
+    size_t idx = 0;
+
+#if defined(SEARCH_SSE2)
+    const __m128i v_first = _mm_set1_epi8((char)first);
+    const __m128i v_last = _mm_set1_epi8((char)last);
+    for (; idx + m - 1 + 16 <= n; idx += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(h + idx));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(h + idx + m - 1));
+        __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(block_first, v_first),
+                                   _mm_cmpeq_epi8(block_last, v_last));
+        uint64_t mask = (uint64_t)_mm_movemask_epi8(eq);
+        while (mask != 0) {
+            size_t pos = idx + search_ctz64(mask);
+            if (memcmp(h + pos + 1, needle + 1, m - 2) == 0) {
+                return haystack + pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+#elif defined(SEARCH_NEON)
+    const uint8x16_t v_first = vdupq_n_u8(first);
+    const uint8x16_t v_last = vdupq_n_u8(last);
+    for (; idx + m - 1 + 16 <= n; idx += 16) {
+        uint8x16_t eq = vandq_u8(vceqq_u8(vld1q_u8(h + idx), v_first),
+                                 vceqq_u8(vld1q_u8(h + idx + m - 1), v_last));
+        // 4 bits per byte: narrow each 16-bit lane to 8 bits
+        uint64_t mask =
+            vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        mask &= 0x8888888888888888ULL;
+        while (mask != 0) {
+            size_t pos = idx + search_ctz64(mask) / 4;
+            if (memcmp(h + pos + 1, needle + 1, m - 2) == 0) {
+                return haystack + pos;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    // the tail, or the whole haystack without vector instructions
+    while (idx + m <= n) {
+        const unsigned char* at = memchr(h + idx, first, n - m + 1 - idx);
+        if (at == NULL) {
+            return NULL;
+        }
+        idx = at - h;
+        if (h[idx + m - 1] == last && memcmp(h + idx + 1, needle + 1, m - 2) == 0) {
+            return haystack + idx;
+        }
+        idx++;
+    }
+    return NULL;
+}
+
+// search_max_suffix computes the maximal suffix of the needle
+// for the Two-Way algorithm, using either the direct or the reversed
+// byte order. Returns the position before the suffix and sets its period.
+static size_t search_max_suffix(const unsigned char* needle, size_t m, bool reversed,
+                                size_t* period) {
+    size_t ip = SIZE_MAX;  // position before the suffix
+    size_t jp = 0;         // candidate position
+    size_t k = 1, p = 1;
+    while (jp + k < m) {
+        unsigned char a = needle[ip + k];
+        unsigned char b = needle[jp + k];
+        if (a == b) {
+            if (k == p) {
+                jp += p;
+                k = 1;
+            } else {
+                k++;
+            }
+        } else if (reversed ? a < b : a > b) {
+            jp += k;
+            k = 1;
+            p = jp - ip;
+        } else {
+            ip = jp++;
+            k = p = 1;
+        }
+    }
+    *period = p;
+    return ip;
+}
+
+// search_long finds a needle with the Two-Way algorithm,
+// skipping ahead with a bad-character table on the last byte of the window.
+static const char* search_long(const char* haystack, size_t n, const char* needle, size_t m) {
+    const unsigned char* h = (const unsigned char*)haystack;
+    const unsigned char* z = h + n;
+    const unsigned char* nd = (const unsigned char*)needle;
+
+    // position of the last occurrence of each byte in the needle (1-based)
+    size_t shift[256] = {0};
+    for (size_t i = 0; i < m; i++) {
+        shift[nd[i]] = i + 1;
+    }
+
+    // critical factorization: the longer of the two maximal suffixes
+    size_t p, p_rev;
+    size_t ms = search_max_suffix(nd, m, false, &p);
+    size_t ms_rev = search_max_suffix(nd, m, true, &p_rev);
+    if (ms_rev + 1 > ms + 1) {
+        ms = ms_rev;
+        p = p_rev;
+    }
+
+    // for a periodic needle, remember the matched prefix between shifts
+    size_t mem0;
+    if (memcmp(nd, nd + p, ms + 1) != 0) {
+        mem0 = 0;
+        p = (ms > m - ms - 1 ? ms : m - ms - 1) + 1;
+    } else {
+        mem0 = m - p;
+    }
+    size_t mem = 0;
+
+    for (;;) {
+        if ((size_t)(z - h) < m) {
+            return NULL;
+        }
+
+        // check the last byte of the window first
+        size_t k = shift[h[m - 1]];
+        if (k == 0) {
+            h += m;
+            mem = 0;
+            continue;
+        }
+        k = m - k;
+        if (k != 0) {
+            if (k < mem) {
+                k = mem;
+            }
+            h += k;
+            mem = 0;
+            continue;
+        }
+
+        // compare the right half
+        for (k = (ms + 1 > mem ? ms + 1 : mem); k < m && nd[k] == h[k]; k++) {
+        }
+        if (k < m) {
+            h += k - ms;
+            mem = 0;
+            continue;
+        }
+
+        // compare the left half
+        for (k = ms + 1; k > mem && nd[k - 1] == h[k - 1]; k--) {
+        }
+        if (k <= mem) {
+            return (const char*)h;
+        }
+        h += p;
+        mem = mem0;
+    }
+}
+
+// search_first returns a pointer to the first occurrence of the needle in the haystack,
+// or NULL if there is none.
+const char* search_first(const char* haystack, size_t n, const char* needle, size_t m) {
+    if (m == 0) {
+        return haystack;
+    }
+    if (m > n) {
+        return NULL;
+    }
+    if (m == 1) {
+        return memchr(haystack, needle[0], n);
+    }
+    if (m <= SEARCH_SHORT_NEEDLE) {
+        return search_short(haystack, n, needle, m);
+    }
+    return search_long(haystack, n, needle, m);
+}
+
+// search_last returns a pointer to the last occurrence of the needle in the haystack,
+// or NULL if there is none.
+const char* search_last(const char* haystack, size_t n, const char* needle, size_t m) {
+    if (m == 0) {
+        return haystack + n;
+    }
+    if (m > n) {
+        return NULL;
+    }
+    const char first = needle[0];
+    const char last = needle[m - 1];
+    for (size_t idx = n - m + 1; idx > 0; idx--) {
+        const char* at = haystack + idx - 1;
+        if (at[0] == first && at[m - 1] == last && memcmp(at, needle, m) == 0) {
+            return at;
+        }
+    }
+    return NULL;
+}
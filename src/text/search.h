@@ -0,0 +1,18 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Substring search.
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <stdlib.h>
+
+// search_first returns a pointer to the first occurrence of the needle in the haystack,
+// or NULL if there is none.
+const char* search_first(const char* haystack, size_t n, const char* needle, size_t m);
+// search_last returns a pointer to the last occurrence of the needle in the haystack,
+// or NULL if there is none.
+const char* search_last(const char* haystack, size_t n, const char* needle, size_t m);
+
+#endif /* SEARCH_H */
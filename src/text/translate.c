@@ -0,0 +1,196 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Compiled character translation.
+//
+// The mapping is compiled into a direct table for ASCII characters
+// and an open-addressing hash table for the rest, so translating
+// a character takes a single lookup whatever the size of the mapping.
+// The string is translated as UTF-8, without converting it to runes.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/translate.h"
+#include "text/utf8/utf8.h"
+
+// Decoder state for an invalid byte sequence.
+#define UTF8_REJECT 12
+
+// Mapping values for characters that are kept or deleted.
+#define TRANSLATE_KEEP -1
+#define TRANSLATE_DELETE -2
+
+// Hash table key for an empty slot (not a valid code point).
+#define TRANSLATE_EMPTY UINT32_MAX
+
+struct Translation {
+    int32_t ascii[128];  // mapping of ASCII characters
+    uint32_t* keys;      // non-ASCII characters in the `from` set
+    int32_t* values;     // their mapping
+    size_t mask;         // hash table size - 1
+};
+
+// translate_decode decodes the character at `*pos` and moves `*pos` past it.
+// Returns false for an invalid byte sequence, skipping its first byte only.
+static bool translate_decode(const char* str, size_t n, size_t* pos, uint32_t* c) {
+    utf8_decode_t d = {.state = 0};
+    size_t next = *pos;
+    do {
+        utf8_decode(&d, (uint8_t)str[next++]);
+    } while (d.state != 0 && d.state != UTF8_REJECT && next < n);
+    if (d.state != 0) {
+        *c = (uint8_t)str[*pos];
+        *pos += 1;
+        return false;
+    }
+    *c = d.codep;
+    *pos = next;
+    return true;
+}
+
+// translate_slot returns the hash table slot of the character,
+// either the one that holds it or the empty one where it belongs.
+static size_t translate_slot(const Translation* tr, uint32_t c) {
+    size_t slot = (c * 2654435761u) & tr->mask;
+    while (tr->keys[slot] != TRANSLATE_EMPTY && tr->keys[slot] != c) {
+        slot = (slot + 1) & tr->mask;
+    }
+    return slot;
+}
+
+// translate_lookup returns the mapping of the character.
+static inline int32_t translate_lookup(const Translation* tr, uint32_t c) {
+    if (c < 128) {
+        return tr->ascii[c];
+    }
+    if (tr->keys == NULL) {
+        return TRANSLATE_KEEP;
+    }
+    return tr->values[translate_slot(tr, c)];
+}
+
+// translate_compile compiles the mapping of the `from` characters
+// to the `to` characters, or returns NULL if out of memory.
+// If `from` is longer than `to`, the extra `from` characters are deleted.
+// If a character occurs in `from` several times, the first occurrence wins.
+Translation* translate_compile(const char* from, size_t n_from, const char* to, size_t n_to) {
+    Translation* tr = calloc(1, sizeof(Translation));
+    if (tr == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < 128; i++) {
+        tr->ascii[i] = TRANSLATE_KEEP;
+    }
+
+    // every character takes at least one byte, and the table is kept at most half full
+    size_t capacity = 16;
+    while (capacity < 2 * n_from) {
+        capacity *= 2;
+    }
+
+    size_t i_from = 0;
+    size_t i_to = 0;
+    while (i_from < n_from) {
+        uint32_t c;
+        translate_decode(from, n_from, &i_from, &c);
+        int32_t value = TRANSLATE_DELETE;
+        if (i_to < n_to) {
+            uint32_t t;
+            translate_decode(to, n_to, &i_to, &t);
+            value = (int32_t)t;
+        }
+
+        if (c < 128) {
+            if (tr->ascii[c] == TRANSLATE_KEEP) {
+                tr->ascii[c] = value;
+            }
+            continue;
+        }
+        if (tr->keys == NULL) {
+            tr->keys = malloc(capacity * sizeof(uint32_t));
+            tr->values = malloc(capacity * sizeof(int32_t));
+            if (tr->keys == NULL || tr->values == NULL) {
+                translate_free(tr);
+                return NULL;
+            }
+            memset(tr->keys, 0xFF, capacity * sizeof(uint32_t));
+            for (size_t i = 0; i < capacity; i++) {
+                tr->values[i] = TRANSLATE_KEEP;
+            }
+            tr->mask = capacity - 1;
+        }
+        size_t slot = translate_slot(tr, c);
+        if (tr->keys[slot] == TRANSLATE_EMPTY) {
+            tr->keys[slot] = c;
+            tr->values[slot] = value;
+        }
+    }
+    return tr;
+}
+
+// translate_apply writes the translated string to dst.
+// Invalid utf8 bytes are copied as is.
+// Writes at most `size` bytes and returns the size of the translated string.
+size_t translate_apply(const Translation* tr, const char* src, size_t n, char* dst, size_t size) {
+    size_t i = 0;  // position in src
+    size_t j = 0;  // position in dst
+    while (i < n) {
+        uint8_t byte = (uint8_t)src[i];
+        if (byte < 0x80) {
+            int32_t value = tr->ascii[byte];
+            i++;
+            if (value == TRANSLATE_KEEP || (value >= 0 && value < 0x80)) {
+                if (j < size) {
+                    dst[j] = (char)(value == TRANSLATE_KEEP ? byte : value);
+                }
+                j++;
+                continue;
+            }
+            if (value == TRANSLATE_DELETE) {
+                continue;
+            }
+            char buf[4];
+            int len = utf8_encode(buf, (uint32_t)value);
+            if (j + len <= size) {
+                memcpy(dst + j, buf, len);
+            }
+            j += len;
+            continue;
+        }
+
+        size_t start = i;
+        uint32_t c;
+        bool valid = translate_decode(src, n, &i, &c);
+        int32_t value = valid ? translate_lookup(tr, c) : TRANSLATE_KEEP;
+        if (value == TRANSLATE_DELETE) {
+            continue;
+        }
+        if (value == TRANSLATE_KEEP) {
+            if (j + (i - start) <= size) {
+                memcpy(dst + j, src + start, i - start);
+            }
+            j += i - start;
+            continue;
+        }
+        char buf[4];
+        int len = utf8_encode(buf, (uint32_t)value);
+        if (j + len <= size) {
+            memcpy(dst + j, buf, len);
+        }
+        j += len;
+    }
+    return j;
+}
+
+// translate_free frees the compiled mapping.
+void translate_free(Translation* tr) {
+    if (tr == NULL) {
+        return;
+    }
+    free(tr->keys);
+    free(tr->values);
+    free(tr);
+}
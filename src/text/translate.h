@@ -0,0 +1,22 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// Compiled character translation.
+
+#ifndef TRANSLATE_H
+#define TRANSLATE_H
+
+#include <stdlib.h>
+
+typedef struct Translation Translation;
+
+// translate_compile compiles the mapping of the `from` characters
+// to the `to` characters, or returns NULL if out of memory.
+Translation* translate_compile(const char* from, size_t n_from, const char* to, size_t n_to);
+// translate_apply writes the translated string to dst.
+// Writes at most `size` bytes and returns the size of the translated string.
+size_t translate_apply(const Translation* tr, const char* src, size_t n, char* dst, size_t size);
+// translate_free frees the compiled mapping.
+void translate_free(Translation* tr);
+
+#endif /* TRANSLATE_H */
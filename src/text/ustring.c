@@ -0,0 +1,257 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// UTF-8 string view data structure.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/bstring.h"
+#include "text/search.h"
+#include "text/ustring.h"
+#include "text/utf8/utf8.h"
+
+// ustring_new creates an empty string.
+Utf8String ustring_new(void) {
+    Utf8String str = {.bytes = "", .size = 0, .is_ascii = true};
+    return str;
+}
+
+// ustring_from_cstring creates a new string that wraps an existing C string.
+// The string should be zero-terminated after `size` bytes.
+Utf8String ustring_from_cstring(const char* const cstring, size_t size) {
+    Utf8String str = {.bytes = cstring, .size = size, .is_ascii = false};
+    return str;
+}
+
+// ustring_length returns the number of characters in the string.
+size_t ustring_length(Utf8String str) {
+    if (str.is_ascii) {
+        return str.size;
+    }
+    return utf8_len(str.bytes, str.size);
+}
+
+// ustring_slice returns a slice of the string,
+// from the `start` index (inclusive) to the `end` index (non-inclusive).
+// Negative `start` and `end` values count from the end of the string.
+// Only negative indexes require counting all the characters in the string.
+Utf8String ustring_slice(Utf8String str, int start, int end) {
+    if (start < 0 || end < 0) {
+        int length = (int)ustring_length(str);
+        start = start < 0 ? length + start : start;
+        end = end < 0 ? length + end : end;
+    }
+
+    // python-compatible: treat negative start index larger than the length of the string as zero
+    start = start < 0 ? 0 : start;
+
+    // adjusted start index should be less than adjusted end index
+    if (start >= end) {
+        return ustring_new();
+    }
+
+    // indexes past the end of the string are clamped by ustring_substring
+    return ustring_substring(str, start, end - start);
+}
+
+// ustring_substring returns a substring of `length` characters,
+// starting from the `start` index. Decodes only the characters
+// up to the end of the substring.
+Utf8String ustring_substring(Utf8String str, size_t start, size_t length) {
+    if (str.is_ascii) {
+        size_t from = start < str.size ? start : str.size;
+        size_t to = length < str.size - from ? from + length : str.size;
+        Utf8String res = {.bytes = str.bytes + from, .size = to - from, .is_ascii = true};
+        return res;
+    }
+
+    size_t from = utf8_pos(str.bytes, str.size, start);
+    size_t to = str.size;
+    // every character takes at least one byte,
+    // so there is no need to walk the tail if it is shorter than `length`
+    if (length < str.size - from) {
+        to = from + utf8_pos(str.bytes + from, str.size - from, length);
+    }
+    Utf8String res = {.bytes = str.bytes + from, .size = to - from, .is_ascii = false};
+    return res;
+}
+
+// ustring_char_index converts the byte index to the character index.
+static int ustring_char_index(Utf8String str, int idx) {
+    if (idx <= 0 || str.is_ascii) {
+        return idx;
+    }
+    // the prefix is usually ASCII, and checking it is faster than decoding it
+    ByteString prefix = bstring_from_cstring(str.bytes, idx);
+    if (bstring_is_ascii(prefix)) {
+        return idx;
+    }
+    return (int)utf8_len(str.bytes, idx);
+}
+
+// ustring_index returns the first index of the substring in the original string.
+// Valid UTF-8 substrings can only match at character boundaries,
+// so the search runs on bytes and only the prefix before the match is decoded.
+int ustring_index(Utf8String str, Utf8String other) {
+    ByteString s_str = bstring_from_cstring(str.bytes, str.size);
+    ByteString s_other = bstring_from_cstring(other.bytes, other.size);
+    int idx = bstring_index(s_str, s_other);
+    return ustring_char_index(str, idx);
+}
+
+// ustring_last_index returns the last index of the substring in the original string.
+int ustring_last_index(Utf8String str, Utf8String other) {
+    if (other.size == 0) {
+        return (int)ustring_length(str) - 1;
+    }
+    ByteString s_str = bstring_from_cstring(str.bytes, str.size);
+    ByteString s_other = bstring_from_cstring(other.bytes, other.size);
+    int idx = bstring_last_index(s_str, s_other);
+    return ustring_char_index(str, idx);
+}
+
+// ustring_has_border checks if a proper prefix of the separator is also its suffix,
+// so that two occurrences of the separator can overlap.
+static bool ustring_has_border(Utf8String sep) {
+    for (size_t len = 1; len < sep.size; len++) {
+        if (memcmp(sep.bytes, sep.bytes + sep.size - len, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ustring_split_part splits the string by the separator and returns the nth part (0-based).
+// Negative `part` values count from the end of the string (-1 is the last part).
+// Stops searching at the requested part and returns a slice of the original string.
+Utf8String ustring_split_part(Utf8String str, Utf8String sep, int part) {
+    if (str.size == 0) {
+        return ustring_new();
+    }
+    if (sep.size == 0) {
+        return (part == 0 || part == -1) ? str : ustring_new();
+    }
+
+    if (part < 0 && ustring_has_border(sep)) {
+        // overlapping separators are matched from the start of the string,
+        // so the parts have to be counted from the start too
+        size_t n_parts = 1;
+        const char* at = str.bytes;
+        const char* end = str.bytes + str.size;
+        while ((at = search_first(at, end - at, sep.bytes, sep.size)) != NULL) {
+            n_parts++;
+            at += sep.size;
+        }
+        if ((size_t)-part > n_parts) {
+            return ustring_new();
+        }
+        part = (int)n_parts + part;
+    }
+
+    size_t start = 0;
+    size_t end = str.size;
+    if (part >= 0) {
+        // skip `part` separators from the start
+        for (int i = 0; i < part; i++) {
+            const char* at =
+                search_first(str.bytes + start, str.size - start, sep.bytes, sep.size);
+            if (at == NULL) {
+                return ustring_new();
+            }
+            start = at - str.bytes + sep.size;
+        }
+        const char* at = search_first(str.bytes + start, str.size - start, sep.bytes, sep.size);
+        end = at == NULL ? str.size : (size_t)(at - str.bytes);
+    } else {
+        // skip `|part|-1` separators from the end
+        for (int i = -1; i > part; i--) {
+            const char* at = search_last(str.bytes, end, sep.bytes, sep.size);
+            if (at == NULL) {
+                return ustring_new();
+            }
+            end = at - str.bytes;
+        }
+        const char* at = search_last(str.bytes, end, sep.bytes, sep.size);
+        start = at == NULL ? 0 : (size_t)(at - str.bytes) + sep.size;
+    }
+
+    Utf8String res = {.bytes = str.bytes + start, .size = end - start, .is_ascii = str.is_ascii};
+    return res;
+}
+
+// ustring_contains_rune checks if the string contains the character.
+static bool ustring_contains_rune(Utf8String str, uint32_t rune) {
+    utf8_decode_t d = {.state = 0};
+    size_t idx = 0;
+    while (idx < str.size) {
+        do {
+            utf8_decode(&d, (uint8_t)str.bytes[idx++]);
+        } while (d.state && idx < str.size);
+        if (d.codep == rune) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// ustring_trim_start returns the byte position of the first character
+// that is not one of the `chars`.
+static size_t ustring_trim_start(Utf8String str, Utf8String chars) {
+    utf8_decode_t d = {.state = 0};
+    size_t idx = 0;
+    while (idx < str.size) {
+        size_t next = idx;
+        do {
+            utf8_decode(&d, (uint8_t)str.bytes[next++]);
+        } while (d.state && next < str.size);
+        if (!ustring_contains_rune(chars, d.codep)) {
+            break;
+        }
+        idx = next;
+    }
+    return idx;
+}
+
+// ustring_trim_end returns the byte position after the last character
+// that is not one of the `chars`, walking backwards from the end of the string
+// but not before the `start` position.
+static size_t ustring_trim_end(Utf8String str, Utf8String chars, size_t start) {
+    size_t idx = str.size;
+    while (idx > start) {
+        size_t prev = idx - 1;
+        while (prev > start && ((uint8_t)str.bytes[prev] & 0xC0) == 0x80) {
+            prev--;
+        }
+        if (!ustring_contains_rune(chars, utf8_peek(str.bytes + prev))) {
+            break;
+        }
+        idx = prev;
+    }
+    return idx;
+}
+
+// ustring_trim_left trims certain characters from the beginning of the string.
+Utf8String ustring_trim_left(Utf8String str, Utf8String chars) {
+    size_t start = ustring_trim_start(str, chars);
+    Utf8String res = {.bytes = str.bytes + start, .size = str.size - start, .is_ascii = str.is_ascii};
+    return res;
+}
+
+// ustring_trim_right trims certain characters from the end of the string.
+Utf8String ustring_trim_right(Utf8String str, Utf8String chars) {
+    size_t end = ustring_trim_end(str, chars, 0);
+    Utf8String res = {.bytes = str.bytes, .size = end, .is_ascii = str.is_ascii};
+    return res;
+}
+
+// ustring_trim trims certain characters from the beginning and end of the string.
+Utf8String ustring_trim(Utf8String str, Utf8String chars) {
+    size_t start = ustring_trim_start(str, chars);
+    size_t end = ustring_trim_end(str, chars, start);
+    Utf8String res = {.bytes = str.bytes + start, .size = end - start, .is_ascii = str.is_ascii};
+    return res;
+}
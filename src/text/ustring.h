@@ -0,0 +1,42 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+// UTF-8 string view data structure.
+
+#ifndef USTRING_H
+#define USTRING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// Utf8String is a view of a UTF-8 encoded string.
+// It does not own the bytes, so slices of the string
+// point into the original buffer instead of copying it.
+typedef struct {
+    // array of utf-8 encoded bytes
+    const char* bytes;
+    // number of bytes in the string
+    size_t size;
+    // indicates whether the string is known to contain only ASCII characters,
+    // so that character indexes are byte indexes
+    bool is_ascii;
+} Utf8String;
+
+// Utf8String methods.
+Utf8String ustring_new(void);
+Utf8String ustring_from_cstring(const char* const cstring, size_t size);
+
+size_t ustring_length(Utf8String str);
+Utf8String ustring_slice(Utf8String str, int start, int end);
+Utf8String ustring_substring(Utf8String str, size_t start, size_t length);
+
+int ustring_index(Utf8String str, Utf8String other);
+int ustring_last_index(Utf8String str, Utf8String other);
+Utf8String ustring_split_part(Utf8String str, Utf8String sep, int part);
+
+Utf8String ustring_trim_left(Utf8String str, Utf8String chars);
+Utf8String ustring_trim_right(Utf8String str, Utf8String chars);
+Utf8String ustring_trim(Utf8String str, Utf8String chars);
+
+#endif /* USTRING_H */
@@ -2,6 +2,11 @@
 // https://github.com/nalgeon/sqlean
 
 // Case conversion functions for utf8 strings.
+//
+// The functions write the converted string to a separate buffer,
+// because changing the case of a character may change its utf8 length
+// (e.g. 'ı' (2 bytes) becomes 'I' (1 byte) in upper case).
+// ASCII runs are converted 16 bytes at a time without decoding.
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -10,58 +15,156 @@
 #include "text/utf8/rune.h"
 #include "text/utf8/utf8.h"
 
-// utf8_transform converts the utf8 string s using the transform function.
-static bool utf8_transform(char* s, size_t n, uint32_t (*transform)(uint32_t)) {
-    utf8_decode_t d = {.state = 0};
-    while ((n > 0) & (*s != 0)) {
-        size_t i = 0;
+// Vector instruction set used to convert ASCII blocks.
+// SSE2 is always available on x86-64 and NEON on AArch64.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CASE_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CASE_NEON 1
+#endif
+
+// Decoder state for an invalid byte sequence.
+#define UTF8_REJECT 12
+
+// case_ascii_block converts 16 ASCII bytes from src to dst, flipping the case
+// of letters from `first` to `first`+25. Returns false without writing anything
+// if the block contains non-ASCII bytes.
+static bool case_ascii_block(const char* src, char* dst, char first) {
+#if defined(CASE_SSE2)
+    __m128i v = _mm_loadu_si128((const __m128i*)src);
+    if (_mm_movemask_epi8(v) != 0) {
+        return false;
+    }
+    // ASCII bytes are non-negative, so signed comparisons work
+    __m128i ge = _mm_cmpgt_epi8(v, _mm_set1_epi8((char)(first - 1)));
+    __m128i le = _mm_cmplt_epi8(v, _mm_set1_epi8((char)(first + 26)));
+    __m128i flip = _mm_and_si128(_mm_and_si128(ge, le), _mm_set1_epi8(0x20));
+    _mm_storeu_si128((__m128i*)dst, _mm_xor_si128(v, flip));
+    return true;
+#elif defined(CASE_NEON)
+    uint8x16_t v = vld1q_u8((const uint8_t*)src);
+    if (vmaxvq_u8(v) >= 0x80) {
+        return false;
+    }
+    uint8x16_t in_range = vandq_u8(vcgeq_u8(v, vdupq_n_u8((uint8_t)first)),
+                                   vcleq_u8(v, vdupq_n_u8((uint8_t)(first + 25))));
+    vst1q_u8((uint8_t*)dst, veorq_u8(v, vandq_u8(in_range, vdupq_n_u8(0x20))));
+    return true;
+#else
+    // two 8-byte words: a byte is a letter if adding (0x80 - first)
+    // sets its high bit, but adding (0x7f - last) does not
+    const uint64_t high = 0x8080808080808080ULL;
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t words[2];
+    memcpy(words, src, 16);
+    if ((words[0] | words[1]) & high) {
+        return false;
+    }
+    for (int i = 0; i < 2; i++) {
+        uint64_t ge_first = words[i] + ones * (uint8_t)(0x80 - first);
+        uint64_t gt_last = words[i] + ones * (uint8_t)(0x7f - (first + 25));
+        uint64_t is_letter = ge_first & ~gt_last & high;
+        words[i] ^= is_letter >> 2;
+    }
+    memcpy(dst, words, 16);
+    return true;
+#endif
+}
+
+// utf8_transform writes the string converted with the transform function to dst.
+// ASCII letters from `first` to `first`+25 have their case flipped without calling
+// the transform. When `title` is true, converts the first character of each word
+// with the transform and the rest to lower case. Invalid utf8 bytes are copied as is.
+// Writes at most `size` bytes and returns the size of the converted string.
+static size_t utf8_transform(const char* src,
+                             size_t n,
+                             char* dst,
+                             size_t size,
+                             uint32_t (*transform)(uint32_t),
+                             char first,
+                             bool title) {
+    size_t i = 0;  // position in src
+    size_t j = 0;  // position in dst
+    size_t scalar_end = 0;
+    bool word_start = true;
+    while (i < n) {
+        // whole ASCII blocks, unless the previous block was not ASCII
+        if (!title && i >= scalar_end && i + 16 <= n && j + 16 <= size) {
+            if (case_ascii_block(src + i, dst + j, first)) {
+                i += 16;
+                j += 16;
+                continue;
+            }
+            scalar_end = i + 16;
+        }
+
+        uint8_t byte = (uint8_t)src[i];
+        if (byte < 0x80 && !title) {
+            if (j < size) {
+                dst[j] = (byte >= (uint8_t)first && byte <= (uint8_t)(first + 25))
+                             ? (char)(byte ^ 0x20)
+                             : (char)byte;
+            }
+            i++;
+            j++;
+            continue;
+        }
+
+        // decode the next character
+        utf8_decode_t d = {.state = 0};
+        size_t next = i;
         do {
-            utf8_decode(&d, (uint8_t)s[i++]);
-        } while (d.state);
-        uint32_t c = transform(d.codep);
-        int len = utf8_encode(s, c);
+            utf8_decode(&d, (uint8_t)src[next++]);
+        } while (d.state != 0 && d.state != UTF8_REJECT && next < n);
+
+        char buf[4];
+        int len = 0;
+        if (d.state == 0) {
+            uint32_t c;
+            if (title) {
+                c = word_start ? transform(d.codep) : rune_tolower(d.codep);
+                word_start = !rune_isword(d.codep);
+            } else {
+                c = transform(d.codep);
+            }
+            len = utf8_encode(buf, c);
+        }
         if (len == 0) {
-            return false;
+            // invalid sequence, copy the first byte and resync after it
+            buf[0] = src[i];
+            len = 1;
+            next = i + 1;
+        }
+
+        if (j + len <= size) {
+            memcpy(dst + j, buf, len);
         }
-        s += len;
-        n -= len;
+        i = next;
+        j += len;
     }
-    return true;
+    return j;
 }
 
-// utf8_tolower converts the utf8 string s to lowercase.
-// Returns true if successful, false if an error occurred.
-bool utf8_tolower(char* s, size_t n) {
-    return utf8_transform(s, n, rune_tolower);
+// utf8_tolower writes the lowercase version of the utf8 string src to dst.
+// Writes at most `size` bytes and returns the size of the converted string,
+// which may differ from the size of the original one.
+size_t utf8_tolower(const char* src, size_t n, char* dst, size_t size) {
+    return utf8_transform(src, n, dst, size, rune_tolower, 'A', false);
 }
 
-// utf8_toupper converts the utf8 string s to uppercase.
-bool utf8_toupper(char* s, size_t n) {
-    return utf8_transform(s, n, rune_toupper);
+// utf8_toupper writes the uppercase version of the utf8 string src to dst.
+size_t utf8_toupper(const char* src, size_t n, char* dst, size_t size) {
+    return utf8_transform(src, n, dst, size, rune_toupper, 'a', false);
 }
 
-// utf8_casefold converts the utf8 string s to folded-case.
-bool utf8_casefold(char* s, size_t n) {
-    return utf8_transform(s, n, rune_casefold);
+// utf8_casefold writes the folded-case version of the utf8 string src to dst.
+size_t utf8_casefold(const char* src, size_t n, char* dst, size_t size) {
+    return utf8_transform(src, n, dst, size, rune_casefold, 'A', false);
 }
 
-// utf8_totitle converts the utf8 string s to title-case.
-bool utf8_totitle(char* s, size_t n) {
-    utf8_decode_t d = {.state = 0};
-    bool upper = true;
-    while ((n > 0) & (*s != 0)) {
-        size_t i = 0;
-        do {
-            utf8_decode(&d, (uint8_t)s[i++]);
-        } while (d.state);
-        uint32_t c = upper ? rune_toupper(d.codep) : rune_tolower(d.codep);
-        int len = utf8_encode(s, c);
-        if (len == 0) {
-            return false;
-        }
-        upper = !rune_isword(d.codep);
-        s += len;
-        n -= len;
-    }
-    return true;
+// utf8_totitle writes the title-case version of the utf8 string src to dst.
+size_t utf8_totitle(const char* src, size_t n, char* dst, size_t size) {
+    return utf8_transform(src, n, dst, size, rune_toupper, 'a', true);
 }
@@ -30,6 +30,7 @@
 
 #include "text/utf8/rune.h"
 
+#include "text/utf8/accents.h"
 #include "text/utf8/groups.h"
 #include "text/utf8/tables.h"
 
@@ -121,58 +122,117 @@ bool rune_isword(uint32_t c) {
     return rune_isalpha(c) || rune_isgroup(U8G_Nd, c) || rune_isgroup(U8G_Pc, c);
 }
 
+// rune_iscombining returns true if c is a combining diacritical mark.
+bool rune_iscombining(uint32_t c) {
+    return (c >= 0x0300 && c <= 0x036F) || (c >= 0x1AB0 && c <= 0x1AFF) ||
+           (c >= 0x1DC0 && c <= 0x1DFF) || (c >= 0x20D0 && c <= 0x20FF) ||
+           (c >= 0xFE20 && c <= 0xFE2F);
+}
+
 // Character transformation functions.
 
+// The case mapping ranges are sorted, so the functions below
+// use binary search to find the first range that ends at or after c.
+
 // rune_casefold returns the unicode casefold of c.
 uint32_t rune_casefold(uint32_t c) {
-    for (int i = 0; i < casefold_len; ++i) {
-        const struct CaseMapping entry = casemappings[i];
-        if (c <= entry.c2) {
-            if (c < entry.c1) {
-                return c;
-            }
-            int d = entry.m2 - entry.c2;
-            if (d == 1) {
-                return c + ((entry.c2 & 1) == (c & 1));
-            }
-            return (uint32_t)((int)c + d);
+    if (c < 0x80) {
+        return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+    }
+    int lo = 0, hi = casefold_len;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (casemappings[mid].c2 < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
-    return c;
+    if (lo == casefold_len) {
+        return c;
+    }
+    const struct CaseMapping entry = casemappings[lo];
+    if (c < entry.c1) {
+        return c;
+    }
+    int d = entry.m2 - entry.c2;
+    if (d == 1) {
+        return c + ((entry.c2 & 1) == (c & 1));
+    }
+    return (uint32_t)((int)c + d);
 }
 
 // rune_tolower returns the lowercase version of c.
 uint32_t rune_tolower(uint32_t c) {
-    for (int i = 0; i < (int)(sizeof upcase_ind / sizeof *upcase_ind); ++i) {
-        const struct CaseMapping entry = casemappings[upcase_ind[i]];
-        if (c <= entry.c2) {
-            if (c < entry.c1) {
-                return c;
-            }
-            int d = entry.m2 - entry.c2;
-            if (d == 1) {
-                return c + ((entry.c2 & 1) == (c & 1));
-            }
-            return (uint32_t)((int)c + d);
+    if (c < 0x80) {
+        return (c >= 'A' && c <= 'Z') ? c + 32 : c;
+    }
+    int lo = 0, hi = (int)(sizeof upcase_ind / sizeof *upcase_ind);
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (casemappings[upcase_ind[mid]].c2 < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
-    return c;
+    if (lo == (int)(sizeof upcase_ind / sizeof *upcase_ind)) {
+        return c;
+    }
+    const struct CaseMapping entry = casemappings[upcase_ind[lo]];
+    if (c < entry.c1) {
+        return c;
+    }
+    int d = entry.m2 - entry.c2;
+    if (d == 1) {
+        return c + ((entry.c2 & 1) == (c & 1));
+    }
+    return (uint32_t)((int)c + d);
 }
 
 // rune_toupper returns the uppercase version of c.
 uint32_t rune_toupper(uint32_t c) {
-    for (int i = 0; i < (int)(sizeof lowcase_ind / sizeof *lowcase_ind); ++i) {
-        const struct CaseMapping entry = casemappings[lowcase_ind[i]];
-        if (c <= entry.m2) {
-            int d = entry.m2 - entry.c2;
-            if (c < (uint32_t)(entry.c1 + d)) {
-                return c;
-            }
-            if (d == 1) {
-                return c - ((entry.m2 & 1) == (c & 1));
-            }
-            return (uint32_t)((int)c - d);
+    if (c < 0x80) {
+        return (c >= 'a' && c <= 'z') ? c - 32 : c;
+    }
+    int lo = 0, hi = (int)(sizeof lowcase_ind / sizeof *lowcase_ind);
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (casemappings[lowcase_ind[mid]].m2 < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == (int)(sizeof lowcase_ind / sizeof *lowcase_ind)) {
+        return c;
+    }
+    const struct CaseMapping entry = casemappings[lowcase_ind[lo]];
+    int d = entry.m2 - entry.c2;
+    if (c < (uint32_t)(entry.c1 + d)) {
+        return c;
+    }
+    if (d == 1) {
+        return c - ((entry.m2 & 1) == (c & 1));
+    }
+    return (uint32_t)((int)c - d);
+}
+
+// rune_unaccent returns the base letter of an accented Latin or Greek letter,
+// or c itself if it has no accents.
+uint32_t rune_unaccent(uint32_t c) {
+    const int len = (int)(sizeof accentmappings / sizeof *accentmappings);
+    if (c < accentmappings[0].c || c > accentmappings[len - 1].c) {
+        return c;
+    }
+    int lo = 0, hi = len;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (accentmappings[mid].c < c) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
-    return c;
+    return (lo < len && accentmappings[lo].c == c) ? accentmappings[lo].base : c;
 }
@@ -40,9 +40,11 @@ bool rune_isblank(uint32_t c);
 bool rune_isspace(uint32_t c);
 bool rune_iscased(uint32_t c);
 bool rune_isword(uint32_t c);
+bool rune_iscombining(uint32_t c);
 
 uint32_t rune_casefold(uint32_t c);
 uint32_t rune_tolower(uint32_t c);
 uint32_t rune_toupper(uint32_t c);
+uint32_t rune_unaccent(uint32_t c);
 
 #endif  // UTF8_RUNE_H
\ No newline at end of file
@@ -39,13 +39,13 @@ int utf8_icmp(const char* s1, size_t n1, const char* s2, size_t n2);
 // utf8_valid returns true if s is a valid utf8 string.
 bool utf8_valid(const char* s, size_t n);
 
-// utf8_tolower converts the utf8 string s to lowercase.
-bool utf8_tolower(char* s, size_t n);
-// utf8_toupper converts the utf8 string s to uppercase.
-bool utf8_toupper(char* s, size_t n);
-// utf8_totitle converts the utf8 string s to title-case.
-bool utf8_totitle(char* s, size_t n);
-// utf8_casefold converts the utf8 string s to folded-case.
-bool utf8_casefold(char* s, size_t n);
+// utf8_tolower writes the lowercase version of the utf8 string src to dst.
+size_t utf8_tolower(const char* src, size_t n, char* dst, size_t size);
+// utf8_toupper writes the uppercase version of the utf8 string src to dst.
+size_t utf8_toupper(const char* src, size_t n, char* dst, size_t size);
+// utf8_totitle writes the title-case version of the utf8 string src to dst.
+size_t utf8_totitle(const char* src, size_t n, char* dst, size_t size);
+// utf8_casefold writes the folded-case version of the utf8 string src to dst.
+size_t utf8_casefold(const char* src, size_t n, char* dst, size_t size);
 
 #endif  // UTF8_H
@@ -35,6 +35,9 @@
 **  validatetext=BOOL   validate UTF-8 encoding of text fields
 **  affinity=AFFINITY   affinity to apply to each returned value
 **  nulls=BOOL          empty fields are returned as NULL
+**  buffer=SIZE         size of the read buffer for unmapped files
+**  index=BOOL          keep a row offset index next to the file
+**  infer=N             infer column types from the first N records
 **
 **
 ** Defaults:
@@ -60,6 +63,9 @@
 **  validatetext=no     do not validate text field encoding
 **  affinity=none       do not apply affinity to each returned value
 **  nulls=off           empty fields returned as zero-length
+**  buffer=64K          read unmapped files 64 KiB at a time
+**  index=no            do not keep a row offset index
+**  infer               nothing.  Columns have no declared type
 **
 **
 ** Parameter types:
@@ -69,6 +75,8 @@
 **  BOOL                means something that evaluates as true or false
 **                          it is case insensitive
 **                          yes, no, true, false, 1, 0
+**  SIZE                means a whole number of bytes, optionally
+**                          followed by K, M or G (case insensitive)
 **  AFFINITY            means an SQLite3 type specification
 **                          it is case insensitive
 **                          none, blob, text, integer, real, numeric
@@ -102,6 +110,22 @@
 **
 ** The platform/compiler/OS fopen call is responsible for interpreting
 ** the filename.  It may contain anything recognized by the OS.
+** Regular files are memory-mapped where the OS supports it, and fields
+** are then returned straight from the mapping.  The file must not be
+** truncated while it is being read.  Other files are read buffer bytes
+** at a time, and the OS is told that they are read sequentially.
+**
+** The index option makes the first full scan of a regular file save
+** the offset of every VSV_INDEX_STRIDE-th record to filename.vsvidx.
+** Queries that start at a later rowid or OFFSET then seek close to
+** it instead of reading the file from the beginning.  The index is
+** ignored, and rebuilt by the next full scan, once the size or the
+** modification time of the file changes.
+**
+** The infer option samples the first N records to generate a schema
+** with an INTEGER, REAL, DATE, DATETIME or TEXT column type, and then
+** applies integer or real affinity to each INTEGER or REAL column.  It
+** cannot be combined with schema= or affinity=.
 **
 ** The separator string containing exactly one character, or a valid
 ** escape sequence.  Recognized escape sequences are:
@@ -230,9 +254,11 @@
 #include <ctype.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include "sqlite3ext.h"
 SQLITE_EXTENSION_INIT3
@@ -246,15 +272,104 @@ SQLITE_EXTENSION_INIT3
 #define VSV_NOINLINE
 #endif
 
+/*
+** Files are memory-mapped where the platform supports it, so that
+** fields can be returned without copying them.  Compile with
+** -DVSV_OMIT_MMAP to always read files through stdio.
+*/
+#if !defined(_WIN32) && !defined(VSV_OMIT_MMAP)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define VSV_MMAP 1
+#endif
+
+/*
+** vsv_import() parses a mapped file on a pool of threads.  Compile with
+** -DVSV_OMIT_THREADS to parse it on the calling thread only.
+*/
+#if defined(VSV_MMAP) && !defined(VSV_OMIT_THREADS)
+#include <pthread.h>
+#define VSV_THREADS 1
+#endif
+
+/*
+** Compressed files are decompressed while they are read.  Compile with
+** -DVSV_ZLIB and link with -lz to read gzip files, and with -DVSV_ZSTD
+** and -lzstd to read zstd files.
+*/
+#if defined(VSV_ZLIB)
+#include <zlib.h>
+#endif
+#if defined(VSV_ZSTD)
+#include <zstd.h>
+#endif
+#if defined(VSV_ZLIB) || defined(VSV_ZSTD)
+#define VSV_DECOMPRESS 1
+#endif
+
+/*
+** Vector instruction set used to scan for separators and quotes.
+** AVX2 is only used when the compiler targets it (e.g. -mavx2),
+** SSE2 is always available on x86-64 and NEON on AArch64.
+*/
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VSV_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VSV_SSE2 1
+#elif defined(__ARM_NEON) || defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define VSV_NEON 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static int vsv_ctz32(unsigned int x) {
+    unsigned long i;
+    _BitScanForward(&i, x);
+    return (int)i;
+}
+#if defined(_WIN64)
+static int vsv_ctz64(unsigned long long x) {
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return (int)i;
+}
+#endif
+#else
+#define vsv_ctz32(x) __builtin_ctz(x)
+#define vsv_ctz64(x) __builtin_ctzll(x)
+#endif
+
 /*
 ** Max size of the error message in a VsvReader
 */
 #define VSV_MXERR 200
 
 /*
-** Size of the VsvReader input buffer
+** Default size of the VsvReader input buffer, and the largest size
+** the buffer= parameter accepts
+*/
+#define VSV_INBUFSZ (64 * 1024)
+#define VSV_MAXBUFSZ (1024 * 1024 * 1024)
+
+/*
+** A source of decompressed input for a VsvReader.  The source reads
+** the compressed file, but the reader owns it and closes it.
 */
-#define VSV_INBUFSZ 1024
+typedef struct VsvSource VsvSource;
+struct VsvSource {
+    /* Decompress up to n bytes into z.  Return the number of bytes,
+    ** 0 at the end of input, or -1 on error with a message in zErr */
+    long (*xRead)(VsvSource* pSrc, char* z, size_t n);
+    void (*xClose)(VsvSource* pSrc);
+    FILE* in;                 /* The compressed file */
+    unsigned char* zBuf;      /* Compressed input buffer */
+    size_t nPeek;             /* Bytes of magic number already in zBuf */
+    char zErr[VSV_MXERR];     /* Error message */
+};
 
 /*
 ** A context object used when read a VSV file.
@@ -262,6 +377,8 @@ SQLITE_EXTENSION_INIT3
 typedef struct VsvReader VsvReader;
 struct VsvReader {
     FILE* in;             /* Read the VSV text from this input stream */
+    VsvSource* pSrc;      /* Decompresses p->in, or 0 to read it as is */
+    sqlite3_int64 nRead;  /* Bytes read from pSrc so far */
     char* z;              /* Accumulated text for a field */
     int n;                /* Number of bytes in z */
     int nAlloc;           /* Space allocated for z[] */
@@ -273,8 +390,16 @@ struct VsvReader {
     int dsep;             /* Decimal Seperator Character */
     int affinity;         /* Perform Affinity Conversions */
     int notNull;          /* Have we seen data for field */
+    int bInPlace;         /* Fields are read in place from zIn[] */
+    int bSlice;           /* The current field is read in place */
+    int bEscaped;         /* The current field contains escaped quotes */
+    int bNoMem;           /* The input buffer could not be grown */
+    int bError;           /* The input could not be decompressed */
+    size_t iSlice;        /* Offset of the current field in zIn[] */
+    size_t iRow;          /* Start of the current row in zIn[] */
     size_t iIn;           /* Next unread character in the input buffer */
     size_t nIn;           /* Number of characters in the input buffer */
+    size_t nInAlloc;      /* Space allocated for the input buffer */
     char* zIn;            /* The input buffer */
     char zErr[VSV_MXERR]; /* Error message */
 };
@@ -284,14 +409,25 @@ struct VsvReader {
 */
 static void vsv_reader_init(VsvReader* p) {
     p->in = 0;
+    p->pSrc = 0;
+    p->nRead = 0;
     p->z = 0;
     p->n = 0;
     p->nAlloc = 0;
     p->nLine = 0;
     p->bNotFirst = 0;
+    p->iIn = 0;
     p->nIn = 0;
     p->zIn = 0;
     p->notNull = 0;
+    p->bInPlace = 0;
+    p->bSlice = 0;
+    p->bEscaped = 0;
+    p->bNoMem = 0;
+    p->bError = 0;
+    p->iSlice = 0;
+    p->iRow = 0;
+    p->nInAlloc = 0;
     p->zErr[0] = 0;
 }
 
@@ -299,6 +435,9 @@ static void vsv_reader_init(VsvReader* p) {
 ** Close and reset a VsvReader object
 */
 static void vsv_reader_reset(VsvReader* p) {
+    if (p->pSrc) {
+        p->pSrc->xClose(p->pSrc);
+    }
     if (p->in) {
         fclose(p->in);
         sqlite3_free(p->zIn);
@@ -317,20 +456,417 @@ static void vsv_errmsg(VsvReader* p, const char* zFormat, ...) {
     va_end(ap);
 }
 
+#if defined(VSV_DECOMPRESS)
+/*
+** Input sources.  A VsvReader reads a plain file with fread().  A file
+** that starts with the gzip or zstd magic number is read through a
+** VsvSource instead, which decompresses it into the input buffer.
+**
+** When there is more than one CPU, a VsvThreadSource runs the source
+** on a helper thread, which decompresses the next block while the
+** reader parses the current one.
+*/
+#define VSV_SOURCE_BUFSZ (64 * 1024)   /* Compressed input buffer size */
+#define VSV_THREAD_BLOCK (256 * 1024)  /* Decompressed block size */
+
+static int vsv_import_default_threads(void);
+
+/*
+** Read the next block of compressed input into pSrc->zBuf, starting
+** with the magic number read when the file was opened.  Return the
+** number of bytes read, 0 at the end of the file, or -1 on error.
+*/
+static long vsv_source_fill(VsvSource* pSrc) {
+    size_t got;
+    if (pSrc->nPeek > 0) {
+        got = pSrc->nPeek;
+        pSrc->nPeek = 0;
+        return (long)got;
+    }
+    got = fread(pSrc->zBuf, 1, VSV_SOURCE_BUFSZ, pSrc->in);
+    if (got == 0 && ferror(pSrc->in)) {
+        sqlite3_snprintf(VSV_MXERR, pSrc->zErr, "read error");
+        return -1;
+    }
+    return (long)got;
+}
+
+#if defined(VSV_ZLIB)
+typedef struct VsvGzipSource {
+    VsvSource base;
+    z_stream strm; /* Inflate state */
+    int bEnd;      /* True at the end of a gzip member */
+} VsvGzipSource;
+
+/*
+** Decompress gzip data.  Concatenated gzip members are read one after
+** the other, as gzip does.
+*/
+static long vsv_gzip_read(VsvSource* pSrc, char* z, size_t n) {
+    VsvGzipSource* p = (VsvGzipSource*)pSrc;
+    if (n > 0x40000000) {
+        n = 0x40000000;
+    }
+    p->strm.next_out = (Bytef*)z;
+    p->strm.avail_out = (uInt)n;
+    while (p->strm.avail_out == n) {
+        int rc;
+        if (p->strm.avail_in == 0) {
+            long got = vsv_source_fill(pSrc);
+            if (got < 0) {
+                return -1;
+            }
+            if (got == 0) {
+                if (!p->bEnd) {
+                    sqlite3_snprintf(VSV_MXERR, pSrc->zErr, "truncated gzip data");
+                    return -1;
+                }
+                return 0;
+            }
+            p->strm.next_in = pSrc->zBuf;
+            p->strm.avail_in = (uInt)got;
+        }
+        if (p->bEnd) {
+            inflateReset(&p->strm);
+            p->bEnd = 0;
+        }
+        rc = inflate(&p->strm, Z_NO_FLUSH);
+        if (rc == Z_STREAM_END) {
+            p->bEnd = 1;
+        } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+            sqlite3_snprintf(VSV_MXERR, pSrc->zErr, "corrupt gzip data");
+            return -1;
+        }
+    }
+    return (long)(n - p->strm.avail_out);
+}
+
+static void vsv_gzip_close(VsvSource* pSrc) {
+    inflateEnd(&((VsvGzipSource*)pSrc)->strm);
+    sqlite3_free(pSrc->zBuf);
+    sqlite3_free(pSrc);
+}
+
+static VsvSource* vsv_gzip_open(void) {
+    VsvGzipSource* p = sqlite3_malloc(sizeof(*p));
+    if (p == 0) {
+        return 0;
+    }
+    memset(p, 0, sizeof(*p));
+    if (inflateInit2(&p->strm, 15 + 16) != Z_OK) {
+        sqlite3_free(p);
+        return 0;
+    }
+    p->base.xRead = vsv_gzip_read;
+    p->base.xClose = vsv_gzip_close;
+    return &p->base;
+}
+#endif
+
+#if defined(VSV_ZSTD)
+typedef struct VsvZstdSource {
+    VsvSource base;
+    ZSTD_DStream* pStream; /* Decompression state */
+    ZSTD_inBuffer in;      /* Compressed input not decompressed yet */
+    size_t nHint;          /* Last result of ZSTD_decompressStream(), 0 after a frame */
+} VsvZstdSource;
+
+/*
+** Decompress zstd data.  Concatenated frames are read one after the
+** other.
+*/
+static long vsv_zstd_read(VsvSource* pSrc, char* z, size_t n) {
+    VsvZstdSource* p = (VsvZstdSource*)pSrc;
+    ZSTD_outBuffer out;
+    if (n > 0x40000000) {
+        n = 0x40000000;
+    }
+    out.dst = z;
+    out.size = n;
+    out.pos = 0;
+    while (out.pos == 0) {
+        size_t rc;
+        if (p->in.pos == p->in.size) {
+            long got = vsv_source_fill(pSrc);
+            if (got < 0) {
+                return -1;
+            }
+            if (got == 0) {
+                if (p->nHint != 0) {
+                    sqlite3_snprintf(VSV_MXERR, pSrc->zErr, "truncated zstd data");
+                    return -1;
+                }
+                return 0;
+            }
+            p->in.src = pSrc->zBuf;
+            p->in.size = (size_t)got;
+            p->in.pos = 0;
+        }
+        rc = ZSTD_decompressStream(p->pStream, &out, &p->in);
+        if (ZSTD_isError(rc)) {
+            sqlite3_snprintf(VSV_MXERR, pSrc->zErr, "corrupt zstd data: %s",
+                             ZSTD_getErrorName(rc));
+            return -1;
+        }
+        p->nHint = rc;
+    }
+    return (long)out.pos;
+}
+
+static void vsv_zstd_close(VsvSource* pSrc) {
+    ZSTD_freeDStream(((VsvZstdSource*)pSrc)->pStream);
+    sqlite3_free(pSrc->zBuf);
+    sqlite3_free(pSrc);
+}
+
+static VsvSource* vsv_zstd_open(void) {
+    VsvZstdSource* p = sqlite3_malloc(sizeof(*p));
+    if (p == 0) {
+        return 0;
+    }
+    memset(p, 0, sizeof(*p));
+    p->pStream = ZSTD_createDStream();
+    if (p->pStream == 0 || ZSTD_isError(ZSTD_initDStream(p->pStream))) {
+        ZSTD_freeDStream(p->pStream);
+        sqlite3_free(p);
+        return 0;
+    }
+    p->nHint = 1;
+    p->base.xRead = vsv_zstd_read;
+    p->base.xClose = vsv_zstd_close;
+    return &p->base;
+}
+#endif
+
+#if defined(VSV_THREADS)
+typedef struct VsvThreadSource {
+    VsvSource base;
+    VsvSource* pInner;      /* The source run on the helper thread */
+    pthread_t thread;       /* The helper thread */
+    pthread_mutex_t mutex;  /* Protects the fields below */
+    pthread_cond_t cond;    /* Signalled when a block is filled or emptied */
+    char* aBlock[2];        /* Two blocks of VSV_THREAD_BLOCK bytes */
+    long anBlock[2];        /* Bytes in each block, -1 on error */
+    int abFull[2];          /* True if the block is ready to be read */
+    int bDone;              /* True once the helper thread has stopped */
+    int bStop;              /* True to stop the helper thread */
+    int iRead;              /* Block being read */
+    size_t iOff;            /* Bytes of aBlock[iRead] already read */
+} VsvThreadSource;
+
+/*
+** The helper thread fills the blocks in turn until the end of input,
+** an error, or until the reader is closed
+*/
+static void* vsv_thread_main(void* pArg) {
+    VsvThreadSource* p = (VsvThreadSource*)pArg;
+    int i = 0;
+    long got = 1;
+    pthread_mutex_lock(&p->mutex);
+    while (got > 0) {
+        long n = 0;
+        while (p->abFull[i] && !p->bStop) {
+            pthread_cond_wait(&p->cond, &p->mutex);
+        }
+        if (p->bStop) {
+            break;
+        }
+        pthread_mutex_unlock(&p->mutex);
+        do {
+            got = p->pInner->xRead(p->pInner, p->aBlock[i] + n, VSV_THREAD_BLOCK - n);
+            if (got > 0) {
+                n += got;
+            }
+        } while (got > 0 && n < VSV_THREAD_BLOCK);
+        if (got < 0) {
+            memcpy(p->base.zErr, p->pInner->zErr, VSV_MXERR);
+        }
+        pthread_mutex_lock(&p->mutex);
+        p->anBlock[i] = got < 0 ? -1 : n;
+        p->abFull[i] = 1;
+        pthread_cond_broadcast(&p->cond);
+        i ^= 1;
+    }
+    p->bDone = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+    return 0;
+}
+
+static long vsv_thread_read(VsvSource* pSrc, char* z, size_t n) {
+    VsvThreadSource* p = (VsvThreadSource*)pSrc;
+    long nBlock;
+    size_t k;
+    pthread_mutex_lock(&p->mutex);
+    while (!p->abFull[p->iRead] && !p->bDone) {
+        pthread_cond_wait(&p->cond, &p->mutex);
+    }
+    nBlock = p->abFull[p->iRead] ? p->anBlock[p->iRead] : 0;
+    pthread_mutex_unlock(&p->mutex);
+    if (nBlock <= 0) {
+        return nBlock;
+    }
+    k = (size_t)nBlock - p->iOff;
+    if (k > n) {
+        k = n;
+    }
+    memcpy(z, p->aBlock[p->iRead] + p->iOff, k);
+    p->iOff += k;
+    if (p->iOff == (size_t)nBlock) {
+        pthread_mutex_lock(&p->mutex);
+        p->abFull[p->iRead] = 0;
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->mutex);
+        p->iRead ^= 1;
+        p->iOff = 0;
+    }
+    return (long)k;
+}
+
+static void vsv_thread_close(VsvSource* pSrc) {
+    VsvThreadSource* p = (VsvThreadSource*)pSrc;
+    pthread_mutex_lock(&p->mutex);
+    p->bStop = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+    pthread_join(p->thread, 0);
+    pthread_mutex_destroy(&p->mutex);
+    pthread_cond_destroy(&p->cond);
+    p->pInner->xClose(p->pInner);
+    sqlite3_free(p->aBlock[0]);
+    sqlite3_free(p);
+}
+
+/*
+** Run pInner on a helper thread.  Return 0 if the thread cannot be
+** started, in which case pInner is left to the caller.
+*/
+static VsvSource* vsv_thread_open(VsvSource* pInner) {
+    VsvThreadSource* p = sqlite3_malloc(sizeof(*p));
+    if (p == 0) {
+        return 0;
+    }
+    memset(p, 0, sizeof(*p));
+    p->pInner = pInner;
+    p->aBlock[0] = sqlite3_malloc64(2 * (sqlite3_uint64)VSV_THREAD_BLOCK);
+    if (p->aBlock[0] == 0) {
+        sqlite3_free(p);
+        return 0;
+    }
+    p->aBlock[1] = p->aBlock[0] + VSV_THREAD_BLOCK;
+    pthread_mutex_init(&p->mutex, 0);
+    pthread_cond_init(&p->cond, 0);
+    if (pthread_create(&p->thread, 0, vsv_thread_main, p) != 0) {
+        pthread_mutex_destroy(&p->mutex);
+        pthread_cond_destroy(&p->cond);
+        sqlite3_free(p->aBlock[0]);
+        sqlite3_free(p);
+        return 0;
+    }
+    p->base.xRead = vsv_thread_read;
+    p->base.xClose = vsv_thread_close;
+    return &p->base;
+}
+#endif
+
+#define VSV_COMPRESS_NONE 0
+#define VSV_COMPRESS_GZIP 1
+#define VSV_COMPRESS_ZSTD 2
+
+/*
+** Return the compression format of a file that starts with the n bytes
+** at z, among those compiled in
+*/
+static int vsv_compression(const unsigned char* z, size_t n) {
+#if defined(VSV_ZLIB)
+    if (n >= 2 && z[0] == 0x1f && z[1] == 0x8b) {
+        return VSV_COMPRESS_GZIP;
+    }
+#endif
+#if defined(VSV_ZSTD)
+    if (n >= 4 && z[0] == 0x28 && z[1] == 0xb5 && z[2] == 0x2f && z[3] == 0xfd) {
+        return VSV_COMPRESS_ZSTD;
+    }
+#endif
+    (void)z;
+    (void)n;
+    return VSV_COMPRESS_NONE;
+}
+
+/*
+** Check the magic number of the file of a VsvReader, and read the file
+** through a source if it is compressed.  Otherwise, the bytes of the
+** magic number are left in the input buffer, so that pipes need not be
+** seekable.  Return non-zero if out of memory.
+*/
+static int vsv_source_open(VsvReader* p) {
+    unsigned char aMagic[4];
+    size_t n = fread(aMagic, 1, sizeof(aMagic), p->in);
+    VsvSource* pSrc = 0;
+    switch (vsv_compression(aMagic, n)) {
+#if defined(VSV_ZLIB)
+        case VSV_COMPRESS_GZIP:
+            pSrc = vsv_gzip_open();
+            break;
+#endif
+#if defined(VSV_ZSTD)
+        case VSV_COMPRESS_ZSTD:
+            pSrc = vsv_zstd_open();
+            break;
+#endif
+        default:
+            if (n > p->nInAlloc) {
+                /* the buffer is smaller than the magic number */
+                n = p->nInAlloc;
+                fseek(p->in, (long)n, SEEK_SET);
+            }
+            memcpy(p->zIn, aMagic, n);
+            p->nIn = n;
+            return 0;
+    }
+    if (pSrc == 0) {
+        return 1;
+    }
+    pSrc->in = p->in;
+    pSrc->zBuf = sqlite3_malloc(VSV_SOURCE_BUFSZ);
+    if (pSrc->zBuf == 0) {
+        pSrc->xClose(pSrc);
+        return 1;
+    }
+    memcpy(pSrc->zBuf, aMagic, n);
+    pSrc->nPeek = n;
+    p->pSrc = pSrc;
+#if defined(VSV_THREADS)
+    if (sqlite3_threadsafe() && vsv_import_default_threads() > 0) {
+        VsvSource* pThread = vsv_thread_open(pSrc);
+        if (pThread) {
+            p->pSrc = pThread;
+        }
+    }
+#endif
+    return 0;
+}
+#endif
+
 /*
 ** Open the file associated with a VsvReader
 ** Return the number of errors.
+**
+** The file is read in nBuffer-byte blocks straight into the input
+** buffer, so stdio does not buffer it again.
 */
 static int vsv_reader_open(VsvReader* p,          /* The reader to open */
                            const char* zFilename, /* Read from this filename */
-                           const char* zData      /*  ... or use this data */
+                           const char* zData,     /*  ... or use this data */
+                           size_t nBuffer         /* Size of the input buffer */
 ) {
     if (zFilename) {
-        p->zIn = sqlite3_malloc(VSV_INBUFSZ);
+        p->zIn = sqlite3_malloc64(nBuffer);
         if (p->zIn == 0) {
             vsv_errmsg(p, "out of memory");
             return 1;
         }
+        p->nInAlloc = nBuffer;
         p->in = fopen(zFilename, "rb");
         if (p->in == 0) {
             sqlite3_free(p->zIn);
@@ -338,6 +874,17 @@ static int vsv_reader_open(VsvReader* p,          /* The reader to open */
             vsv_errmsg(p, "cannot open '%s' for reading", zFilename);
             return 1;
         }
+        setvbuf(p->in, 0, _IONBF, 0);
+#if defined(VSV_MMAP) && defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(fileno(p->in), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#if defined(VSV_DECOMPRESS)
+        if (vsv_source_open(p)) {
+            vsv_reader_reset(p);
+            vsv_errmsg(p, "out of memory");
+            return 1;
+        }
+#endif
     } else {
         assert(p->in == 0);
         p->zIn = (char*)zData;
@@ -346,23 +893,91 @@ static int vsv_reader_open(VsvReader* p,          /* The reader to open */
     return 0;
 }
 
+/*
+** Open a VsvReader on n bytes of text in memory, which need not be
+** zero-terminated and must outlive the reader
+*/
+static void vsv_reader_open_memory(VsvReader* p, const char* z, size_t n) {
+    assert(p->in == 0);
+    p->zIn = (char*)z;
+    p->nIn = n;
+}
+
+/*
+** Return the number of unread bytes in the input buffer, refilling it
+** from the file if it is empty.  Return 0 at end of input.
+**
+** When fields are read in place, the current row is kept at the start
+** of the buffer on refill, and the buffer grows to hold the whole row.
+*/
+static size_t vsv_available(VsvReader* p) {
+    if (p->iIn >= p->nIn && p->in != 0) {
+        size_t got;
+        if (p->bInPlace) {
+            size_t nKeep = p->nIn - p->iRow;
+            if (nKeep == p->nInAlloc) {
+                char* zNew = sqlite3_realloc64(p->zIn, (sqlite3_uint64)p->nInAlloc * 2);
+                if (zNew == 0) {
+                    vsv_errmsg(p, "out of memory");
+                    p->bNoMem = 1;
+                    return 0;
+                }
+                p->zIn = zNew;
+                p->nInAlloc *= 2;
+            }
+            memmove(p->zIn, p->zIn + p->iRow, nKeep);
+            p->iSlice -= p->iRow;
+            p->iIn -= p->iRow;
+            p->iRow = 0;
+            p->nIn = nKeep;
+        } else {
+            p->nIn = 0;
+            p->iIn = 0;
+        }
+#if defined(VSV_DECOMPRESS)
+        if (p->pSrc) {
+            long nGot = p->bError ? 0 : p->pSrc->xRead(p->pSrc, p->zIn + p->nIn, p->nInAlloc - p->nIn);
+            if (nGot < 0) {
+                vsv_errmsg(p, "%s", p->pSrc->zErr);
+                p->bError = 1;
+                nGot = 0;
+            }
+            got = (size_t)nGot;
+            p->nRead += nGot;
+        } else
+#endif
+            got = fread(p->zIn + p->nIn, 1, p->nInAlloc - p->nIn, p->in);
+        p->nIn += got;
+    }
+    return p->iIn < p->nIn ? p->nIn - p->iIn : 0;
+}
+
+/*
+** Return the offset of the next unread character from the start of the
+** file, or of the data
+*/
+static sqlite3_int64 vsv_reader_tell(VsvReader* p) {
+    if (p->in == 0) {
+        return (sqlite3_int64)p->iIn;
+    }
+    if (p->pSrc) {
+        return p->nRead - (sqlite3_int64)(p->nIn - p->iIn);
+    }
+    return (sqlite3_int64)ftell(p->in) - (sqlite3_int64)(p->nIn - p->iIn);
+}
+
 /*
 ** The input buffer has overflowed.  Refill the input buffer, then
 ** return the next character
 */
 static VSV_NOINLINE int vsv_getc_refill(VsvReader* p) {
-    size_t got;
-
     assert(p->iIn >= p->nIn); /* Only called on an empty input buffer */
     assert(p->in != 0);       /* Only called if reading from a file */
 
-    got = fread(p->zIn, 1, VSV_INBUFSZ, p->in);
-    if (got == 0) {
+    if (vsv_available(p) == 0) {
         return EOF;
     }
-    p->nIn = got;
-    p->iIn = 1;
-    return p->zIn[0];
+    return ((unsigned char*)p->zIn)[p->iIn++];
 }
 
 /*
@@ -378,6 +993,133 @@ static int vsv_getc(VsvReader* p) {
     return ((unsigned char*)p->zIn)[p->iIn++];
 }
 
+/*
+** Return the offset of the first byte in z[0..n) that is equal to
+** a, b or c, or n if there is no such byte.  Scans 16 or 32 bytes
+** at a time where vector instructions are available.
+*/
+static size_t vsv_scan(const char* z, size_t n, char a, char b, char c) {
+    size_t i = 0;
+#if defined(VSV_AVX2)
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    const __m256i vc = _mm256_set1_epi8(c);
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(z + i));
+        __m256i eq = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)),
+            _mm256_cmpeq_epi8(v, vc));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(eq);
+        if (mask) {
+            return i + vsv_ctz32(mask);
+        }
+    }
+#elif defined(VSV_SSE2)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    const __m128i vc = _mm_set1_epi8(c);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(z + i));
+        __m128i eq = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+                                  _mm_cmpeq_epi8(v, vc));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(eq);
+        if (mask) {
+            return i + vsv_ctz32(mask);
+        }
+    }
+#elif defined(VSV_NEON)
+    const uint8x16_t va = vdupq_n_u8((uint8_t)a);
+    const uint8x16_t vb = vdupq_n_u8((uint8_t)b);
+    const uint8x16_t vc = vdupq_n_u8((uint8_t)c);
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8((const uint8_t*)(z + i));
+        uint8x16_t eq = vorrq_u8(vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb)), vceqq_u8(v, vc));
+        /* narrow each byte of the comparison result to 4 bits */
+        uint64_t mask =
+            vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+        if (mask) {
+            return i + (vsv_ctz64(mask) >> 2);
+        }
+    }
+#else
+    /* portable fallback: test 8 bytes at a time for a zero byte
+    ** in (word ^ pattern), then locate it byte by byte */
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t pa = ones * (unsigned char)a;
+    const uint64_t pb = ones * (unsigned char)b;
+    const uint64_t pc = ones * (unsigned char)c;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w, xa, xb, xc;
+        memcpy(&w, z + i, sizeof(w));
+        xa = w ^ pa;
+        xb = w ^ pb;
+        xc = w ^ pc;
+        if (((xa - ones) & ~xa & highs) | ((xb - ones) & ~xb & highs) |
+            ((xc - ones) & ~xc & highs)) {
+            break;
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (z[i] == a || z[i] == b || z[i] == c) {
+            return i;
+        }
+    }
+    return n;
+}
+
+/*
+** Make room for at least n more bytes (plus a terminator) in p->z.
+** Return 0 on success and non-zero if there is an OOM error
+*/
+static VSV_NOINLINE int vsv_reserve(VsvReader* p, size_t n) {
+    char* zNew;
+    sqlite3_int64 nNew;
+    if ((sqlite3_int64)p->n + (sqlite3_int64)n + 1 <= p->nAlloc) {
+        return 0;
+    }
+    nNew = (sqlite3_int64)p->nAlloc * 2 + (sqlite3_int64)n + 100;
+    if (nNew > 0x7fffffff) {
+        vsv_errmsg(p, "field too large");
+        return 1;
+    }
+    zNew = sqlite3_realloc64(p->z, nNew);
+    if (zNew == 0) {
+        vsv_errmsg(p, "out of memory");
+        return 1;
+    }
+    p->z = zNew;
+    p->nAlloc = (int)nNew;
+    return 0;
+}
+
+/*
+** Append n bytes from z to the VsvReader.z[] array.
+** Return 0 on success and non-zero if there is an OOM error
+*/
+static int vsv_append_span(VsvReader* p, const char* z, size_t n) {
+    if (p->n + n + 1 > (size_t)p->nAlloc && vsv_reserve(p, n)) {
+        return 1;
+    }
+    memcpy(p->z + p->n, z, n);
+    p->n += (int)n;
+    return 0;
+}
+
+/*
+** Take n more bytes into a field that is read in place.
+** Return 0 on success and non-zero if the field is too large
+*/
+static int vsv_extend_slice(VsvReader* p, size_t n) {
+    if ((size_t)p->n + n >= 0x7fffffff) {
+        vsv_errmsg(p, "field too large");
+        return 1;
+    }
+    p->n += (int)n;
+    return 0;
+}
+
 /*
 ** Increase the size of p->z and append character c to the end.
 ** Return 0 on success and non-zero if there is an OOM error
@@ -416,6 +1158,9 @@ static int vsv_append(VsvReader* p, char c) {
 **   +  Input comes from p->in.
 **   +  Store results in p->z of length p->n.  Space to hold p->z comes
 **      from sqlite3_malloc64().
+**   +  If p->bInPlace is set, fields are not copied: the result points
+**      into p->zIn[] at p->iSlice and is not zero-terminated, and escaped
+**      quotes are left as they are, with p->bEscaped set.
 **   +  Keep track of the line number in p->nLine.
 **   +  Store the character that terminates the field in p->cTerm.  Store
 **      EOF on end-of-file.
@@ -423,10 +1168,12 @@ static int vsv_append(VsvReader* p, char c) {
 ** Return 0 at EOF or on OOM.  On EOF, the p->cTerm character will have
 ** been set to EOF.
 */
-static char* vsv_read_one_field(VsvReader* p) {
+static const char* vsv_read_one_field(VsvReader* p) {
     int c;
     p->notNull = 0;
     p->n = 0;
+    p->bSlice = 0;
+    p->bEscaped = 0;
     c = vsv_getc(p);
     if (c == EOF) {
         p->cTerm = EOF;
@@ -437,12 +1184,44 @@ static char* vsv_read_one_field(VsvReader* p) {
         int startLine = p->nLine;
         p->notNull = 1;
         pc = ppc = 0;
+        if (p->bInPlace) {
+            p->bSlice = 1;
+            p->iSlice = p->iIn;
+        }
         while (1) {
+            /*
+            ** Copy a run of characters other than quotes and newlines in
+            ** bulk.  Such a run can only end the field if it follows a
+            ** quote, so that case is left to the character-wise logic.
+            */
+            if (pc != '"' && !(pc == '\r' && ppc == '"')) {
+                size_t nAvail = vsv_available(p);
+                if (nAvail > 0) {
+                    const unsigned char* zRun = (const unsigned char*)p->zIn + p->iIn;
+                    size_t nRun = vsv_scan((const char*)zRun, nAvail, '"', '\n', '"');
+                    if (nRun > 0) {
+                        if (p->bSlice ? vsv_extend_slice(p, nRun)
+                                      : vsv_append_span(p, (const char*)zRun, nRun)) {
+                            return 0;
+                        }
+                        p->iIn += nRun;
+                        ppc = nRun > 1 ? zRun[nRun - 2] : pc;
+                        pc = zRun[nRun - 1];
+                    }
+                }
+            }
             c = vsv_getc(p);
             if (c == '\n') {
                 p->nLine++;
             }
             if (c == '"' && pc == '"') {
+                /* an escaped quote: keep both quotes when read in place */
+                if (p->bSlice) {
+                    p->bEscaped = 1;
+                    if (vsv_extend_slice(p, 1)) {
+                        return 0;
+                    }
+                }
                 pc = ppc;
                 ppc = 0;
                 continue;
@@ -450,9 +1229,10 @@ static char* vsv_read_one_field(VsvReader* p) {
             if ((c == p->fsep && pc == '"') || (c == p->rsep && pc == '"') ||
                 (p->rsep == '\n' && c == '\n' && pc == '\r' && ppc == '"') ||
                 (c == EOF && pc == '"')) {
+                const char* z = p->bSlice ? p->zIn + p->iSlice : p->z;
                 do {
                     p->n--;
-                } while (p->z[p->n] != '"');
+                } while (z[p->n] != '"');
                 p->cTerm = (char)c;
                 break;
             }
@@ -461,26 +1241,33 @@ static char* vsv_read_one_field(VsvReader* p) {
                 break;
             }
             if (c == EOF) {
-                vsv_errmsg(p, "line %d: unterminated %c-quoted field\n", startLine, '"');
+                /* input that ends early reports why, not the quote it cut */
+                if (!p->bError) {
+                    vsv_errmsg(p, "line %d: unterminated %c-quoted field\n", startLine, '"');
+                }
                 p->cTerm = (char)c;
                 break;
             }
-            if (vsv_append(p, (char)c)) {
+            if (p->bSlice ? vsv_extend_slice(p, 1) : vsv_append(p, (char)c)) {
                 return 0;
             }
             ppc = pc;
             pc = c;
         }
     } else {
+        if (p->bInPlace) {
+            p->bSlice = 1;
+            p->iSlice = p->iIn - 1;
+        }
         /*
         ** If this is the first field being parsed and it begins with the
         ** UTF-8 BOM  (0xEF BB BF) then skip the BOM
         */
         if ((c & 0xff) == 0xef && p->bNotFirst == 0) {
-            vsv_append(p, (char)c);
+            p->bSlice ? vsv_extend_slice(p, 1) : vsv_append(p, (char)c);
             c = vsv_getc(p);
             if ((c & 0xff) == 0xbb) {
-                vsv_append(p, (char)c);
+                p->bSlice ? vsv_extend_slice(p, 1) : vsv_append(p, (char)c);
                 c = vsv_getc(p);
                 if ((c & 0xff) == 0xbf) {
                     p->bNotFirst = 1;
@@ -490,18 +1277,30 @@ static char* vsv_read_one_field(VsvReader* p) {
             }
         }
         while (c != EOF && c != p->rsep && c != p->fsep) {
+            size_t nAvail;
             if (c == '\n')
                 p->nLine++;
             if (!p->notNull)
                 p->notNull = 1;
-            if (vsv_append(p, (char)c))
+            if (p->bSlice ? vsv_extend_slice(p, 1) : vsv_append(p, (char)c))
                 return 0;
+            /* copy the rest of the field up to a separator or newline in bulk */
+            nAvail = vsv_available(p);
+            if (nAvail > 0) {
+                const char* zRun = p->zIn + p->iIn;
+                size_t nRun = vsv_scan(zRun, nAvail, (char)p->fsep, (char)p->rsep, '\n');
+                if (nRun > 0 &&
+                    (p->bSlice ? vsv_extend_slice(p, nRun) : vsv_append_span(p, zRun, nRun)))
+                    return 0;
+                p->iIn += nRun;
+            }
             c = vsv_getc(p);
         }
         if (c == '\n') {
             p->nLine++;
         }
-        if (p->n > 0 && (p->rsep == '\n' || p->fsep == '\n') && p->z[p->n - 1] == '\r') {
+        if (p->n > 0 && (p->rsep == '\n' || p->fsep == '\n') &&
+            (p->bSlice ? p->zIn + p->iSlice : p->z)[p->n - 1] == '\r') {
             p->n--;
             if (p->n == 0) {
                 p->notNull = 0;
@@ -509,33 +1308,153 @@ static char* vsv_read_one_field(VsvReader* p) {
         }
         p->cTerm = (char)c;
     }
+    p->bNotFirst = 1;
+    if (p->bSlice) {
+        return p->zIn + p->iSlice;
+    }
     if (p->z) {
         p->z[p->n] = 0;
+        return p->z;
     }
-    p->bNotFirst = 1;
-    return p->z;
+    return "";
 }
 
 /*
-** Forward references to the various virtual table methods implemented
-** in this file.
+** Skip the rest of the current record, after a field terminated by the
+** field separator.  Unquoted fields are not parsed: the input is only
+** scanned for the record separator and for quotes that open a field.
+** Fields are read in place, so nothing is copied.
 */
-static int vsvtabCreate(sqlite3*, void*, int, const char* const*, sqlite3_vtab**, char**);
-static int vsvtabConnect(sqlite3*, void*, int, const char* const*, sqlite3_vtab**, char**);
-static int vsvtabBestIndex(sqlite3_vtab*, sqlite3_index_info*);
-static int vsvtabDisconnect(sqlite3_vtab*);
-static int vsvtabOpen(sqlite3_vtab*, sqlite3_vtab_cursor**);
-static int vsvtabClose(sqlite3_vtab_cursor*);
-static int vsvtabFilter(sqlite3_vtab_cursor*,
-                        int idxNum,
-                        const char* idxStr,
-                        int argc,
-                        sqlite3_value** argv);
-static int vsvtabNext(sqlite3_vtab_cursor*);
+static void vsv_skip_record(VsvReader* p) {
+    int bFieldStart = 1;
+    assert(p->bInPlace);
+    while (1) {
+        size_t nAvail = vsv_available(p);
+        const char* z;
+        size_t k;
+        if (nAvail == 0) {
+            p->cTerm = EOF;
+            return;
+        }
+        z = p->zIn + p->iIn;
+        if (bFieldStart && z[0] == '"') {
+            vsv_read_one_field(p);
+            if (p->cTerm != p->fsep) {
+                return;
+            }
+            continue;
+        }
+        k = vsv_scan(z, nAvail, (char)p->rsep, '"', (char)p->rsep);
+        if (k == nAvail) {
+            p->iIn += k;
+            bFieldStart = z[k - 1] == p->fsep;
+        } else if (z[k] == '"') {
+            /* a quote only opens a field right after a separator */
+            bFieldStart = k > 0 ? z[k - 1] == p->fsep : bFieldStart;
+            if (bFieldStart) {
+                p->iIn += k;
+            } else {
+                p->iIn += k + 1;
+            }
+        } else {
+            p->iIn += k + 1;
+            p->cTerm = p->rsep;
+            return;
+        }
+    }
+}
+
+/*
+** A growable scratch buffer for unescaped fields
+*/
+typedef struct VsvArena {
+    char* z;    /* Unescaped fields, each zero-terminated */
+    int n;      /* Bytes used in z */
+    int nAlloc; /* Space allocated for z */
+} VsvArena;
+
+/*
+** Unescape the n-byte quoted field content in z, in which each pair of
+** quotes stands for one quote, into an arena.  Return the offset of the
+** result and store its length in *pnOut, or return -1 if there is an
+** OOM error.
+*/
+static int vsv_arena_unescape(VsvArena* pArena, const char* z, int n, int* pnOut) {
+    int iOff = pArena->n;
+    int i, j;
+    char* zOut;
+    if ((sqlite3_int64)iOff + n + 1 > pArena->nAlloc) {
+        sqlite3_int64 nNew = (sqlite3_int64)pArena->nAlloc * 2 + n + 100;
+        char* zNew;
+        if (nNew > 0x7fffffff) {
+            return -1;
+        }
+        zNew = sqlite3_realloc64(pArena->z, nNew);
+        if (zNew == 0) {
+            return -1;
+        }
+        pArena->z = zNew;
+        pArena->nAlloc = (int)nNew;
+    }
+    zOut = pArena->z + iOff;
+    for (i = 0, j = 0; i < n; i++) {
+        zOut[j++] = z[i];
+        if (z[i] == '"' && i + 1 < n && z[i + 1] == '"') {
+            i++;
+        }
+    }
+    zOut[j] = 0;
+    pArena->n += j + 1;
+    *pnOut = j;
+    return iOff;
+}
+
+/*
+** Forward references to the various virtual table methods implemented
+** in this file.
+*/
+static int vsvtabCreate(sqlite3*, void*, int, const char* const*, sqlite3_vtab**, char**);
+static int vsvtabConnect(sqlite3*, void*, int, const char* const*, sqlite3_vtab**, char**);
+static int vsvtabBestIndex(sqlite3_vtab*, sqlite3_index_info*);
+static int vsvtabDisconnect(sqlite3_vtab*);
+static int vsvtabOpen(sqlite3_vtab*, sqlite3_vtab_cursor**);
+static int vsvtabClose(sqlite3_vtab_cursor*);
+static int vsvtabFilter(sqlite3_vtab_cursor*,
+                        int idxNum,
+                        const char* idxStr,
+                        int argc,
+                        sqlite3_value** argv);
+static int vsvtabNext(sqlite3_vtab_cursor*);
 static int vsvtabEof(sqlite3_vtab_cursor*);
 static int vsvtabColumn(sqlite3_vtab_cursor*, sqlite3_context*, int);
 static int vsvtabRowid(sqlite3_vtab_cursor*, sqlite3_int64*);
 
+/*
+** What is known about a VSV file to tell whether it has changed.  A
+** file rewritten within the same second may keep its size, so the
+** modification time is kept to the nanosecond where the platform has
+** it, and a file replaced by another one differs in inode or device.
+*/
+typedef struct VsvStat {
+    sqlite3_int64 iSize;  /* File size in bytes, or -1 if unknown */
+    sqlite3_int64 iMtime; /* Modification time in nanoseconds */
+    sqlite3_int64 iIno;   /* Inode number */
+    sqlite3_int64 iDev;   /* Device number */
+} VsvStat;
+
+/*
+** A memory mapping of a VSV file.  The table keeps a reference to its
+** latest mapping, and each cursor one to the mapping it reads from, so
+** that a mapping outlives the cursors still reading it when the file
+** changes and the table maps it again.
+*/
+typedef struct VsvMap {
+    char* z;       /* Mapped bytes */
+    size_t n;      /* Size of the mapping in bytes */
+    int nRef;      /* Number of references to this mapping */
+    VsvStat sStat; /* The file when it was mapped */
+} VsvMap;
+
 /*
 ** An instance of the VSV virtual table
 */
@@ -551,20 +1470,78 @@ typedef struct VsvTable {
     int affinity;      /* Perform affinity conversions */
     int nulls;         /* Process NULLs */
     int validateUTF8;  /* Validate UTF8 */
+    size_t nBuffer;    /* Size of the input buffer of a cursor */
+    int bFilter;       /* Constraints may be checked against raw fields */
+    VsvMap* pMap;      /* Latest memory mapping of zFilename, if any */
+    char* zIndex;              /* Name of the sidecar index file, if index=yes */
+    sqlite3_int64* aIndex;     /* Offset of every VSV_INDEX_STRIDE-th record */
+    int nIndex;                /* Number of entries in aIndex[], 0 if none */
+    VsvStat sIndexStat;        /* The file when the index was built */
+    int* aAffinity;            /* Affinity of each column if infer=N, else 0 */
 } VsvTable;
 
+/*
+** A constraint pushed down by xBestIndex.  A row is skipped when the
+** column certainly fails the comparison with every value in apVal[]
+** (more than one for an IN list).
+*/
+typedef struct VsvFilter {
+    int iCol;               /* Column constrained */
+    int op;                 /* SQLITE_INDEX_CONSTRAINT_* operator */
+    int nVal;               /* Number of values in apVal[] */
+    sqlite3_value** apVal;  /* Right-hand side values */
+} VsvFilter;
+
 /*
 ** A cursor for the VSV virtual table
 */
 typedef struct VsvCursor {
     sqlite3_vtab_cursor base; /* Base class.  Must be first */
     VsvReader rdr;            /* The VsvReader object */
-    char** azVal;             /* Value of the current row */
-    int* aLen;                /* Allocation Length of each entry */
+    VsvMap* pMap;             /* Mapping rdr reads from, or 0 */
+    size_t* aOff;             /* Offset of each entry from the start of the row */
     int* dLen;                /* Data Length of each entry */
+    int* aState;              /* VSV_FIELD_* state of each entry */
+    int nParse;               /* Number of leading columns used by the query */
+    VsvArena arena;           /* Unescaped entries of the current row */
+    VsvFilter* aFilter;       /* Constraints checked before a row is returned */
+    int nFilter;              /* Number of entries in aFilter[] */
+    sqlite3_int64 iLast;      /* Rowid of the last row to return, or negative */
     sqlite3_int64 iRowid;     /* The current rowid.  Negative for EOF */
+    int bBuild;               /* Collect record offsets for the sidecar index */
+    sqlite3_int64* aBuild;    /* Record offsets collected so far */
+    int nBuild;               /* Number of entries in aBuild[] */
+    int nBuildAlloc;          /* Space allocated for aBuild[] */
+    VsvStat sBuildStat;       /* The file when the scan started */
 } VsvCursor;
 
+/*
+** Entries of the current row are located by vsvtabNext and only
+** unescaped and converted when vsvtabColumn asks for them
+*/
+#define VSV_FIELD_RAW 0     /* At aOff[] from the start of the row in rdr.zIn[] */
+#define VSV_FIELD_ESCAPED 1 /* Same, but with escaped quotes */
+#define VSV_FIELD_ARENA 2   /* Unescaped at aOff[] in arena.z[] */
+
+/*
+** idxNum holds the number of leading columns used by the query, and
+** flags for the LIMIT and OFFSET arguments that follow the constraints
+*/
+#define VSV_INDEX_COLUMNS 0xffff
+#define VSV_INDEX_LIMIT 0x10000
+#define VSV_INDEX_OFFSET 0x20000
+
+static int vsv_filter_row(VsvCursor* pCur);
+static char* vsv_infer_schema(VsvReader* p,
+                              const char* zFilename,
+                              const char* zData,
+                              size_t nBuffer,
+                              int bHeader,
+                              int nSkip,
+                              int nSample,
+                              int* pnCol,
+                              int** paAffinity);
+
 /*
 ** Transfer error message text from a reader into a VsvTable
 */
@@ -573,11 +1550,285 @@ static void vsv_xfer_error(VsvTable* pTab, VsvReader* pRdr) {
     pTab->base.zErrMsg = sqlite3_mprintf("%s", pRdr->zErr);
 }
 
+/*
+** Fill in a VsvStat for a regular file.
+** Return 0 on success and non-zero if there is no such file.
+*/
+static int vsv_file_stat(const char* zFilename, VsvStat* pStat) {
+    struct stat st;
+    if (stat(zFilename, &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG) {
+        return 1;
+    }
+    pStat->iSize = (sqlite3_int64)st.st_size;
+    pStat->iMtime = (sqlite3_int64)st.st_mtime * 1000000000;
+#if defined(__APPLE__)
+    pStat->iMtime += st.st_mtimespec.tv_nsec;
+#elif !defined(_WIN32)
+    pStat->iMtime += st.st_mtim.tv_nsec;
+#endif
+    pStat->iIno = (sqlite3_int64)st.st_ino;
+    pStat->iDev = (sqlite3_int64)st.st_dev;
+    return 0;
+}
+
+/*
+** Return true if two VsvStat describe the same version of a file
+*/
+static int vsv_stat_same(const VsvStat* pA, const VsvStat* pB) {
+    return pA->iSize == pB->iSize && pA->iMtime == pB->iMtime && pA->iIno == pB->iIno &&
+           pA->iDev == pB->iDev;
+}
+
+#if defined(VSV_MMAP)
+/*
+** Map the first n bytes of a file into memory.  An empty file cannot
+** be mapped, but there is nothing to read, so it maps to "".
+** Return 0 on success and non-zero on failure.
+*/
+static int vsv_mmap(const char* zFilename, size_t n, char** pzMap) {
+    int fd;
+    void* pMap;
+    if (n == 0) {
+        *pzMap = "";
+        return 0;
+    }
+    fd = open(zFilename, O_RDONLY);
+    if (fd < 0) {
+        return 1;
+    }
+    pMap = mmap(0, n, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pMap == MAP_FAILED) {
+        return 1;
+    }
+#if defined(VSV_DECOMPRESS)
+    if (vsv_compression((const unsigned char*)pMap, n) != VSV_COMPRESS_NONE) {
+        /* compressed files are read through their decompressor */
+        munmap(pMap, n);
+        return 1;
+    }
+#endif
+#if defined(POSIX_MADV_SEQUENTIAL)
+    /* files are scanned from start to end: read ahead aggressively */
+    posix_madvise(pMap, n, POSIX_MADV_SEQUENTIAL);
+#endif
+    *pzMap = (char*)pMap;
+    return 0;
+}
+
+/*
+** Release a mapping made by vsv_mmap()
+*/
+static void vsv_munmap(char* zMap, size_t n) {
+    if (zMap && n > 0) {
+        munmap(zMap, n);
+    }
+}
+#endif
+
+/*
+** Drop a reference to a VsvMap, and release the mapping with the last
+** one
+*/
+static void vsv_map_unref(VsvMap* pMap) {
+    if (pMap == 0 || --pMap->nRef > 0) {
+        return;
+    }
+#if defined(VSV_MMAP)
+    vsv_munmap(pMap->z, pMap->n);
+#endif
+    sqlite3_free(pMap);
+}
+
+/*
+** Map the file of a VsvTable into memory.  The latest mapping is
+** reused unless the file has changed since, in which case the file is
+** mapped again, and cursors keep reading the mapping they started
+** with.  Return 0 on success, and non-zero if the file cannot be mapped
+** and has to be read through stdio instead.
+*/
+static int vsv_map_file(VsvTable* pTab) {
+#if defined(VSV_MMAP)
+    VsvStat sStat;
+    VsvMap* pMap;
+    if (pTab->zFilename == 0 || vsv_file_stat(pTab->zFilename, &sStat)) {
+        return 1;
+    }
+    if (pTab->pMap) {
+        if (vsv_stat_same(&pTab->pMap->sStat, &sStat)) {
+            return 0;
+        }
+        vsv_map_unref(pTab->pMap);
+        pTab->pMap = 0;
+    }
+    if ((sqlite3_uint64)sStat.iSize > (size_t)-1) {
+        return 1;
+    }
+    pMap = sqlite3_malloc(sizeof(*pMap));
+    if (pMap == 0) {
+        return 1;
+    }
+    if (vsv_mmap(pTab->zFilename, (size_t)sStat.iSize, &pMap->z)) {
+        sqlite3_free(pMap);
+        return 1;
+    }
+    pMap->n = (size_t)sStat.iSize;
+    pMap->nRef = 1;
+    pMap->sStat = sStat;
+    pTab->pMap = pMap;
+    return 0;
+#else
+    return 1;
+#endif
+}
+
+/*
+** Sidecar index.  With index=yes, the first scan that reads a file to
+** the end stores the offset of every VSV_INDEX_STRIDE-th record in
+** FILENAME.vsvidx, along with the size, modification time, inode and
+** device of the file.  Later scans seek to the nearest stored record
+** for rowid constraints and OFFSET instead of reading everything
+** before it.  Before a scan seeks to a stored record, it checks that
+** the byte before it is a record separator.
+**
+** The file holds VSV_INDEX_MAGIC, then VSV_INDEX_KEY 64-bit words in
+** native byte order (stride, fsep, rsep, start of data, file size,
+** modification time, inode and device), the number of offsets, and the
+** offsets.  An index whose key does not match the file is rebuilt.
+*/
+#if !defined(VSV_INDEX_STRIDE)
+#define VSV_INDEX_STRIDE 1024
+#endif
+#define VSV_INDEX_MAGIC "VSVIDX02"
+#define VSV_INDEX_KEY 8
+
+/*
+** Fill in the key of the sidecar index of a VsvTable
+*/
+static void vsv_index_key(VsvTable* pTab, sqlite3_int64* aKey, const VsvStat* pStat) {
+    aKey[0] = VSV_INDEX_STRIDE;
+    aKey[1] = pTab->fsep;
+    aKey[2] = pTab->rsep;
+    aKey[3] = pTab->iStart;
+    aKey[4] = pStat->iSize;
+    aKey[5] = pStat->iMtime;
+    aKey[6] = pStat->iIno;
+    aKey[7] = pStat->iDev;
+}
+
+/*
+** Replace the sidecar index held by a VsvTable
+*/
+static void vsv_index_set(VsvTable* pTab,
+                          sqlite3_int64* aIndex,
+                          int nIndex,
+                          const VsvStat* pStat) {
+    sqlite3_free(pTab->aIndex);
+    pTab->aIndex = aIndex;
+    pTab->nIndex = nIndex;
+    if (pStat) {
+        pTab->sIndexStat = *pStat;
+    }
+}
+
+/*
+** Read the sidecar index of a VsvTable, if there is one that matches
+** the given version of its file
+*/
+static void vsv_index_load(VsvTable* pTab, const VsvStat* pStat) {
+    char zMagic[sizeof(VSV_INDEX_MAGIC) - 1];
+    sqlite3_int64 aHdr[VSV_INDEX_KEY + 1];
+    sqlite3_int64 aKey[VSV_INDEX_KEY];
+    sqlite3_int64* aIndex = 0;
+    sqlite3_int64 nIndex;
+    FILE* in = fopen(pTab->zIndex, "rb");
+    if (in == 0) {
+        return;
+    }
+    vsv_index_key(pTab, aKey, pStat);
+    if (fread(zMagic, sizeof(zMagic), 1, in) == 1 &&
+        memcmp(zMagic, VSV_INDEX_MAGIC, sizeof(zMagic)) == 0 &&
+        fread(aHdr, sizeof(aHdr), 1, in) == 1 && memcmp(aHdr, aKey, sizeof(aKey)) == 0) {
+        nIndex = aHdr[VSV_INDEX_KEY];
+        if (nIndex > 0 && nIndex <= 0x7fffffff) {
+            aIndex = sqlite3_malloc64(sizeof(sqlite3_int64) * nIndex);
+            if (aIndex && fread(aIndex, sizeof(sqlite3_int64), (size_t)nIndex, in) == (size_t)nIndex) {
+                vsv_index_set(pTab, aIndex, (int)nIndex, pStat);
+                aIndex = 0;
+            }
+        }
+    }
+    sqlite3_free(aIndex);
+    fclose(in);
+}
+
+/*
+** Write the sidecar index of a VsvTable, replacing any other, and keep
+** it for later scans.  The index is only an optimization, so it is not
+** an error if it cannot be written.
+*/
+static void vsv_index_save(VsvTable* pTab,
+                           sqlite3_int64* aIndex,
+                           int nIndex,
+                           const VsvStat* pStat) {
+    sqlite3_int64 aHdr[VSV_INDEX_KEY + 1];
+    char* zTemp = sqlite3_mprintf("%s-tmp", pTab->zIndex);
+    FILE* out = zTemp ? fopen(zTemp, "wb") : 0;
+    vsv_index_key(pTab, aHdr, pStat);
+    aHdr[VSV_INDEX_KEY] = nIndex;
+    if (out) {
+        int bOk = fwrite(VSV_INDEX_MAGIC, sizeof(VSV_INDEX_MAGIC) - 1, 1, out) == 1 &&
+                  fwrite(aHdr, sizeof(aHdr), 1, out) == 1 &&
+                  fwrite(aIndex, sizeof(sqlite3_int64), nIndex, out) == (size_t)nIndex;
+        bOk = fclose(out) == 0 && bOk;
+        /* rename() does not replace an existing file everywhere */
+        remove(pTab->zIndex);
+        if (!bOk || rename(zTemp, pTab->zIndex) != 0) {
+            remove(zTemp);
+        }
+    }
+    sqlite3_free(zTemp);
+    vsv_index_set(pTab, aIndex, nIndex, pStat);
+}
+
+/*
+** Return 1 if a VsvTable has a sidecar index that matches its file,
+** loading it if needed, or 0 if it has none.  The current version of
+** the file is stored in *pStat, with a size of -1 if the file cannot
+** be indexed.
+*/
+static int vsv_index_check(VsvTable* pTab, VsvStat* pStat) {
+    pStat->iSize = -1;
+    if (pTab->zIndex == 0 || vsv_file_stat(pTab->zFilename, pStat)) {
+        return 0;
+    }
+    if (pTab->nIndex > 0 && !vsv_stat_same(&pTab->sIndexStat, pStat)) {
+        vsv_index_set(pTab, 0, 0, 0);
+    }
+    if (pTab->nIndex == 0) {
+        vsv_index_load(pTab, pStat);
+    }
+    return pTab->nIndex > 0;
+}
+
+/*
+** Drop the sidecar index of a VsvTable that turned out not to match
+** its file, so that the next full scan builds it again
+*/
+static void vsv_index_drop(VsvTable* pTab) {
+    vsv_index_set(pTab, 0, 0, 0);
+    remove(pTab->zIndex);
+}
+
 /*
 ** This method is the destructor for a VsvTable object.
 */
 static int vsvtabDisconnect(sqlite3_vtab* pVtab) {
     VsvTable* p = (VsvTable*)pVtab;
+    vsv_map_unref(p->pMap);
+    vsv_index_set(p, 0, 0, 0);
+    sqlite3_free(p->zIndex);
+    sqlite3_free(p->aAffinity);
     sqlite3_free(p->zFilename);
     sqlite3_free(p->zData);
     sqlite3_free(p);
@@ -728,6 +1979,44 @@ static int vsv_boolean_parameter(const char* zTag, /* Tag we are looking for */
     return 0;
 }
 
+/*
+** Parse a size in bytes: a whole number with an optional K, M or G
+** suffix (case insensitive) for KiB, MiB or GiB.
+** Return the size, or 0 if it is invalid or larger than VSV_MAXBUFSZ.
+*/
+static size_t vsv_parse_size(const char* z) {
+    sqlite3_uint64 n = 0;
+    if (!isdigit((unsigned char)z[0])) {
+        return 0;
+    }
+    while (isdigit((unsigned char)z[0])) {
+        n = n * 10 + (z[0] - '0');
+        if (n > VSV_MAXBUFSZ) {
+            return 0;
+        }
+        z++;
+    }
+    switch (z[0]) {
+        case 'g':
+        case 'G':
+            n *= 1024;
+            /* fall through */
+        case 'm':
+        case 'M':
+            n *= 1024;
+            /* fall through */
+        case 'k':
+        case 'K':
+            n *= 1024;
+            z++;
+    }
+    z = vsv_skip_whitespace(z);
+    if (z[0] != 0 || n > VSV_MAXBUFSZ) {
+        return 0;
+    }
+    return (size_t)n;
+}
+
 /*
 ** Convert the seperator character specification into the character code
 ** Return 1 signifies error, 0 for no error
@@ -803,6 +2092,7 @@ static int vsv_parse_sep_char(char* in, int dflt, int* out) {
 **    rsep=RSEP                  Record Seperator
 **    dsep=RSEP                  Decimal Seperator
 **    skip=N                     skip N records of file (default 0)
+**    buffer=SIZE                read buffer size (default 64K)
 **    affinity=AFF               affinity to apply to ALL columns
 **                               default:  none
 **                               none text integer real numeric
@@ -828,16 +2118,21 @@ static int vsvtabConnect(sqlite3* db,
     int nCol = -99;        /* Value of the columns= parameter */
     int nSkip = -1;        /* Value of the skip= parameter */
     int bNulls = -1;       /* Process Nulls flag */
+    int bIndex = -1;       /* Sidecar index flag */
+    int nInfer = -1;       /* Value of the infer= parameter */
+    size_t nBuffer;        /* Value of the buffer= parameter */
     VsvReader sRdr;        /* A VSV file reader used to store an error
                             ** message and/or to count the number of columns */
-    static const char* azParam[] = {"filename", "data", "schema", "fsep", "rsep", "dsep"};
-    char* azPValue[6]; /* Parameter values */
+    static const char* azParam[] = {"filename", "data", "schema", "fsep",
+                                    "rsep",     "dsep", "buffer"};
+    char* azPValue[7]; /* Parameter values */
 #define VSV_FILENAME (azPValue[0])
 #define VSV_DATA (azPValue[1])
 #define VSV_SCHEMA (azPValue[2])
 #define VSV_FSEP (azPValue[3])
 #define VSV_RSEP (azPValue[4])
 #define VSV_DSEP (azPValue[5])
+#define VSV_BUFFER (azPValue[6])
 
     assert(sizeof(azPValue) == sizeof(azParam));
     memset(&sRdr, 0, sizeof(sRdr));
@@ -872,6 +2167,12 @@ static int vsvtabConnect(sqlite3* db,
                 goto vsvtab_connect_error;
             }
             bNulls = b;
+        } else if (vsv_boolean_parameter("index", 5, z, &b)) {
+            if (bIndex >= 0) {
+                vsv_errmsg(&sRdr, "more than one 'index' parameter");
+                goto vsvtab_connect_error;
+            }
+            bIndex = b;
         } else if ((zValue = vsv_parameter("columns", 7, z)) != 0) {
             if (nCol > 0) {
                 vsv_errmsg(&sRdr, "more than one 'columns' parameter");
@@ -892,6 +2193,16 @@ static int vsvtabConnect(sqlite3* db,
                 vsv_errmsg(&sRdr, "skip= value must be positive");
                 goto vsvtab_connect_error;
             }
+        } else if ((zValue = vsv_parameter("infer", 5, z)) != 0) {
+            if (nInfer > 0) {
+                vsv_errmsg(&sRdr, "more than one 'infer' parameter");
+                goto vsvtab_connect_error;
+            }
+            nInfer = atoi(zValue);
+            if (nInfer <= 0) {
+                vsv_errmsg(&sRdr, "infer= value must be positive");
+                goto vsvtab_connect_error;
+            }
         } else if ((zValue = vsv_parameter("affinity", 8, z)) != 0) {
             if (affinity > -1) {
                 vsv_errmsg(&sRdr, "more than one 'affinity' parameter");
@@ -918,6 +2229,10 @@ static int vsvtabConnect(sqlite3* db,
             goto vsvtab_connect_error;
         }
     }
+    if (nInfer > 0 && (VSV_SCHEMA || affinity >= 0)) {
+        vsv_errmsg(&sRdr, "infer= cannot be used with schema= or affinity=");
+        goto vsvtab_connect_error;
+    }
     if (affinity == -1) {
         affinity = 0;
     }
@@ -927,6 +2242,12 @@ static int vsvtabConnect(sqlite3* db,
     if (validateUTF8 == -1) {
         validateUTF8 = 0;
     }
+    if (VSV_BUFFER == 0) {
+        nBuffer = VSV_INBUFSZ;
+    } else if ((nBuffer = vsv_parse_size(VSV_BUFFER)) == 0) {
+        vsv_errmsg(&sRdr, "cannot parse buffer: '%s'", VSV_BUFFER);
+        goto vsvtab_connect_error;
+    }
     if ((VSV_FILENAME == 0) == (VSV_DATA == 0)) {
         vsv_errmsg(&sRdr, "must specify either filename= or data= but not both");
         goto vsvtab_connect_error;
@@ -943,7 +2264,7 @@ static int vsvtabConnect(sqlite3* db,
         vsv_errmsg(&sRdr, "cannot parse dsep: '%s'", VSV_DSEP);
         goto vsvtab_connect_error;
     }
-    if ((nCol <= 0 || bHeader == 1) && vsv_reader_open(&sRdr, VSV_FILENAME, VSV_DATA)) {
+    if ((nCol <= 0 || bHeader == 1) && vsv_reader_open(&sRdr, VSV_FILENAME, VSV_DATA, nBuffer)) {
         goto vsvtab_connect_error;
     }
     pNew = sqlite3_malloc(sizeof(*pNew));
@@ -958,6 +2279,14 @@ static int vsvtabConnect(sqlite3* db,
     pNew->affinity = affinity;
     pNew->validateUTF8 = validateUTF8;
     pNew->nulls = bNulls;
+    pNew->nBuffer = nBuffer;
+    /*
+    ** Columns of a generated schema have no declared type, unless it
+    ** is inferred, so SQLite compares the text they hold without
+    ** converting it first
+    */
+    pNew->bFilter =
+        VSV_SCHEMA == 0 && nInfer < 0 && !validateUTF8 && (affinity == 0 || affinity == 2);
     if (VSV_SCHEMA == 0) {
         sqlite3_str* pStr = sqlite3_str_new(0);
         char* zSep = "";
@@ -977,7 +2306,7 @@ static int vsvtabConnect(sqlite3* db,
             }
         } else {
             do {
-                char* z = vsv_read_one_field(&sRdr);
+                const char* z = vsv_read_one_field(&sRdr);
                 if ((nCol > 0 && iCol < nCol) || (nCol < 0 && bHeader)) {
                     sqlite3_str_appendf(pStr, "%s\"%w\"", zSep, z);
                     zSep = ",";
@@ -1012,7 +2341,7 @@ static int vsvtabConnect(sqlite3* db,
     if (nSkip > 0) {
         int tskip = nSkip + (bHeader == 1);
         vsv_reader_reset(&sRdr);
-        if (vsv_reader_open(&sRdr, VSV_FILENAME, VSV_DATA)) {
+        if (vsv_reader_open(&sRdr, VSV_FILENAME, VSV_DATA, nBuffer)) {
             goto vsvtab_connect_error;
         }
         do {
@@ -1036,9 +2365,27 @@ static int vsvtabConnect(sqlite3* db,
     } else if (pNew->zData) {
         pNew->iStart = (int)sRdr.iIn;
     } else {
-        pNew->iStart = (int)(ftell(sRdr.in) - sRdr.nIn + sRdr.iIn);
+        pNew->iStart = (int)vsv_reader_tell(&sRdr);
     }
     vsv_reader_reset(&sRdr);
+    if (nInfer > 0) {
+        char* zSchema = vsv_infer_schema(&sRdr, pNew->zFilename, pNew->zData, nBuffer, bHeader == 1,
+                                         nSkip > 0 ? nSkip : 0, nInfer, &nCol, &pNew->aAffinity);
+        if (zSchema == 0) {
+            goto vsvtab_connect_error;
+        }
+        vsv_reader_reset(&sRdr);
+        sqlite3_free(VSV_SCHEMA);
+        VSV_SCHEMA = zSchema;
+    }
+    if (bIndex == 1 && pNew->zFilename) {
+        VsvStat sStat;
+        pNew->zIndex = sqlite3_mprintf("%s.vsvidx", pNew->zFilename);
+        if (pNew->zIndex == 0) {
+            goto vsvtab_connect_oom;
+        }
+        vsv_index_check(pNew, &sStat);
+    }
     rc = sqlite3_declare_vtab(db, VSV_SCHEMA);
     if (rc) {
         vsv_errmsg(&sRdr, "bad schema: '%s' - %s", VSV_SCHEMA, sqlite3_errmsg(db));
@@ -1088,11 +2435,27 @@ static void vsvtabCursorRowReset(VsvCursor* pCur) {
     VsvTable* pTab = (VsvTable*)pCur->base.pVtab;
     int i;
     for (i = 0; i < pTab->nCol; i++) {
-        sqlite3_free(pCur->azVal[i]);
-        pCur->azVal[i] = 0;
-        pCur->aLen[i] = 0;
+        pCur->aOff[i] = 0;
         pCur->dLen[i] = -1;
+        pCur->aState[i] = VSV_FIELD_RAW;
+    }
+    pCur->arena.n = 0;
+}
+
+/*
+** Release the constraints held by a VsvCursor.
+*/
+static void vsvtabCursorFilterReset(VsvCursor* pCur) {
+    int i, j;
+    for (i = 0; i < pCur->nFilter; i++) {
+        for (j = 0; j < pCur->aFilter[i].nVal; j++) {
+            sqlite3_value_free(pCur->aFilter[i].apVal[j]);
+        }
+        sqlite3_free(pCur->aFilter[i].apVal);
     }
+    sqlite3_free(pCur->aFilter);
+    pCur->aFilter = 0;
+    pCur->nFilter = 0;
 }
 
 /*
@@ -1114,7 +2477,11 @@ static int vsvtabCreate(sqlite3* db,
 static int vsvtabClose(sqlite3_vtab_cursor* cur) {
     VsvCursor* pCur = (VsvCursor*)cur;
     vsvtabCursorRowReset(pCur);
+    vsvtabCursorFilterReset(pCur);
     vsv_reader_reset(&pCur->rdr);
+    vsv_map_unref(pCur->pMap);
+    sqlite3_free(pCur->arena.z);
+    sqlite3_free(pCur->aBuild);
     sqlite3_free(cur);
     return SQLITE_OK;
 }
@@ -1126,76 +2493,152 @@ static int vsvtabOpen(sqlite3_vtab* p, sqlite3_vtab_cursor** ppCursor) {
     VsvTable* pTab = (VsvTable*)p;
     VsvCursor* pCur;
     size_t nByte;
-    nByte = sizeof(*pCur) + (sizeof(char*) + (2 * sizeof(int))) * pTab->nCol;
+    nByte = sizeof(*pCur) + (sizeof(size_t) + (2 * sizeof(int))) * pTab->nCol;
     pCur = sqlite3_malloc64(nByte);
     if (pCur == 0)
         return SQLITE_NOMEM;
     memset(pCur, 0, nByte);
-    pCur->azVal = (char**)&pCur[1];
-    pCur->aLen = (int*)&pCur->azVal[pTab->nCol];
-    pCur->dLen = (int*)&pCur->aLen[pTab->nCol];
+    pCur->aOff = (size_t*)&pCur[1];
+    pCur->dLen = (int*)&pCur->aOff[pTab->nCol];
+    pCur->aState = (int*)&pCur->dLen[pTab->nCol];
+    pCur->nParse = pTab->nCol;
+    pCur->iLast = -1;
     pCur->rdr.fsep = pTab->fsep;
     pCur->rdr.rsep = pTab->rsep;
     pCur->rdr.dsep = pTab->dsep;
     pCur->rdr.affinity = pTab->affinity;
+    pCur->rdr.bInPlace = 1;
     *ppCursor = &pCur->base;
-    if (vsv_reader_open(&pCur->rdr, pTab->zFilename, pTab->zData)) {
+    if (vsv_map_file(pTab) == 0) {
+        pCur->pMap = pTab->pMap;
+        pCur->pMap->nRef++;
+        vsv_reader_open_memory(&pCur->rdr, pCur->pMap->z, pCur->pMap->n);
+    } else if (vsv_reader_open(&pCur->rdr, pTab->zFilename, pTab->zData, pTab->nBuffer)) {
+        /* SQLite does not call xClose for a cursor that failed to open */
         vsv_xfer_error(pTab, &pCur->rdr);
+        sqlite3_free(pCur);
+        *ppCursor = 0;
         return SQLITE_ERROR;
     }
     return SQLITE_OK;
 }
 
+/*
+** Keep the offset of the next record for the sidecar index, if it is
+** one of the records the index holds.  The index is only built if all
+** of them could be kept.
+*/
+static void vsv_index_note(VsvCursor* pCur) {
+    if (pCur->iRowid % VSV_INDEX_STRIDE != 0) {
+        return;
+    }
+    if (pCur->nBuild == pCur->nBuildAlloc) {
+        sqlite3_int64 nNew = (sqlite3_int64)pCur->nBuildAlloc * 2 + 64;
+        sqlite3_int64* aNew;
+        if (nNew > 0x7fffffff ||
+            (aNew = sqlite3_realloc64(pCur->aBuild, sizeof(sqlite3_int64) * nNew)) == 0) {
+            pCur->bBuild = 0;
+            return;
+        }
+        pCur->aBuild = aNew;
+        pCur->nBuildAlloc = (int)nNew;
+    }
+    pCur->aBuild[pCur->nBuild++] = vsv_reader_tell(&pCur->rdr);
+}
+
+/*
+** A scan that started at the beginning has read all iRowid records.
+** Save the sidecar index, unless the file changed during the scan.
+*/
+static void vsv_index_finish(VsvCursor* pCur) {
+    VsvTable* pTab = (VsvTable*)pCur->base.pVtab;
+    sqlite3_int64 nIndex = (pCur->iRowid + VSV_INDEX_STRIDE - 1) / VSV_INDEX_STRIDE;
+    VsvStat sStat;
+    pCur->bBuild = 0;
+    if (nIndex == 0 || nIndex > pCur->nBuild || vsv_file_stat(pTab->zFilename, &sStat) ||
+        !vsv_stat_same(&sStat, &pCur->sBuildStat)) {
+        return;
+    }
+    vsv_index_save(pTab, pCur->aBuild, (int)nIndex, &sStat);
+    pCur->aBuild = 0;
+    pCur->nBuild = 0;
+    pCur->nBuildAlloc = 0;
+}
+
 /*
 ** Advance a VsvCursor to its next row of input.
 ** Set the EOF marker if we reach the end of input.
+**
+** Only the location of each field is recorded here.  Fields past the
+** last column used by the query are skipped without being parsed, and
+** rows that fail a pushed-down constraint are skipped before SQLite
+** sees any of their columns.
 */
 static int vsvtabNext(sqlite3_vtab_cursor* cur) {
     VsvCursor* pCur = (VsvCursor*)cur;
     VsvTable* pTab = (VsvTable*)cur->pVtab;
-    int i = 0;
-    char* z;
+    int i;
+    int rc;
+    const char* z;
     do {
-        z = vsv_read_one_field(&pCur->rdr);
-        if (z == 0) {
-            if (i < pTab->nCol)
-                pCur->dLen[i] = -1;
-        } else if (i < pTab->nCol) {
-            if (pCur->aLen[i] < pCur->rdr.n + 1) {
-                char* zNew = sqlite3_realloc64(pCur->azVal[i], pCur->rdr.n + 1);
-                if (zNew == 0) {
-                    z = 0;
-                    vsv_errmsg(&pCur->rdr, "out of memory");
-                    vsv_xfer_error(pTab, &pCur->rdr);
-                    break;
+        if (pCur->iRowid == pCur->iLast) {
+            pCur->iRowid = -1;
+            return SQLITE_OK;
+        }
+        if (pCur->bBuild) {
+            vsv_index_note(pCur);
+        }
+        i = 0;
+        pCur->rdr.iRow = pCur->rdr.iIn;
+        pCur->arena.n = 0;
+        do {
+            if (i > 0 && i >= pCur->nParse) {
+                vsv_skip_record(&pCur->rdr);
+                break;
+            }
+            z = vsv_read_one_field(&pCur->rdr);
+            if (z == 0) {
+                if (i < pTab->nCol)
+                    pCur->dLen[i] = -1;
+            } else if (i < pTab->nCol) {
+                if (!pCur->rdr.notNull && pTab->nulls) {
+                    pCur->dLen[i] = -1;
+                } else {
+                    pCur->aOff[i] = pCur->rdr.iSlice - pCur->rdr.iRow;
+                    pCur->dLen[i] = pCur->rdr.n;
+                    pCur->aState[i] = pCur->rdr.bEscaped ? VSV_FIELD_ESCAPED : VSV_FIELD_RAW;
                 }
-                pCur->azVal[i] = zNew;
-                pCur->aLen[i] = pCur->rdr.n + 1;
+                i++;
             }
-            if (!pCur->rdr.notNull && pTab->nulls) {
-                pCur->dLen[i] = -1;
-            } else {
-                pCur->dLen[i] = pCur->rdr.n;
-                memcpy(pCur->azVal[i], z, pCur->rdr.n + 1);
+        } while (pCur->rdr.cTerm == pCur->rdr.fsep);
+        if (pCur->rdr.bNoMem) {
+            vsv_xfer_error(pTab, &pCur->rdr);
+            return SQLITE_NOMEM;
+        }
+        if (pCur->rdr.bError) {
+            vsv_xfer_error(pTab, &pCur->rdr);
+            return SQLITE_ERROR;
+        }
+        if ((pCur->rdr.cTerm == EOF && i == 0)) {
+            if (pCur->bBuild) {
+                vsv_index_finish(pCur);
             }
-            i++;
+            pCur->iRowid = -1;
+            return SQLITE_OK;
         }
-    } while (pCur->rdr.cTerm == pCur->rdr.fsep);
-    if ((pCur->rdr.cTerm == EOF && i == 0)) {
-        pCur->iRowid = -1;
-    } else {
         pCur->iRowid++;
         while (i < pTab->nCol) {
             pCur->dLen[i] = -1;
             i++;
         }
-    }
-    return SQLITE_OK;
+        rc = vsv_filter_row(pCur);
+    } while (rc == 0);
+    return rc < 0 ? SQLITE_NOMEM : SQLITE_OK;
 }
 
 /*
 **
-** Determine affinity of field
+** Determine affinity of the n-byte field in arg
 **
 ** ignore leading space
 ** then may have + or -
@@ -1205,15 +2648,18 @@ static int vsvtabNext(sqlite3_vtab_cursor* cur) {
 ** then may have + or -
 ** then may have digits
 ** then may have trailing space
+**
+** The offset of the decimal separator, if any, is stored in *piSep.
 */
-static int vsv_isValidNumber(int dsep, char* arg) {
-    char* start;
-    char* stop;
+static int vsv_isValidNumber(int dsep, const char* arg, int n, int* piSep) {
+    const char* start;
+    const char* stop;
     int isValid = 0;
     int hasDigit = 0;
 
+    *piSep = -1;
     start = arg;
-    stop = arg + strlen(arg) - 1;
+    stop = arg + n - 1;
     while (start <= stop && *start == ' ')  // strip spaces from begining
     {
         start++;
@@ -1229,27 +2675,25 @@ static int vsv_isValidNumber(int dsep, char* arg) {
     {
         start++;
     }
-    if (start <= stop && isdigit(*start))  // must have a digit to be valid
+    if (start <= stop && isdigit((unsigned char)*start))  // must have a digit to be valid
     {
         hasDigit = 1;
         isValid = 1;
     }
-    while (start <= stop && isdigit(*start))  // bunch of digits
+    while (start <= stop && isdigit((unsigned char)*start))  // bunch of digits
     {
         start++;
     }
     if (start <= stop && *start == dsep)  // may have decimal separator
     {
         isValid = 2;
-        if (*start != '.') {
-            *start = '.';
-        }
+        *piSep = (int)(start - arg);
         start++;
     }
-    if (start <= stop && isdigit(*start)) {
+    if (start <= stop && isdigit((unsigned char)*start)) {
         hasDigit = 1;
     }
-    while (start <= stop && isdigit(*start))  // bunch of digits
+    while (start <= stop && isdigit((unsigned char)*start))  // bunch of digits
     {
         start++;
     }
@@ -1266,10 +2710,10 @@ static int vsv_isValidNumber(int dsep, char* arg) {
     if (start <= stop && isValid == 3 && (*start == '+' || *start == '-')) {
         start++;
     }
-    if (start <= stop && isValid == 3 && isdigit(*start)) {
+    if (start <= stop && isValid == 3 && isdigit((unsigned char)*start)) {
         isValid = 2;
     }
-    while (start <= stop && isdigit(*start))  // bunch of digits
+    while (start <= stop && isdigit((unsigned char)*start))  // bunch of digits
     {
         start++;
     }
@@ -1284,17 +2728,46 @@ vsv_end_isValidNumber:
 }
 
 /*
-** Validate UTF-8
+** Copy the n-byte number in z to zBuf, or to a new allocation if it
+** does not fit, so that it can be passed to strtoll() or strtold().
+** The decimal separator at offset iSep is replaced with a point.
+** Return 0 if there is an OOM error.
+*/
+static char* vsv_number_copy(const char* z, int n, int iSep, char* zBuf, int nBuf) {
+    char* zNum = n < nBuf ? zBuf : sqlite3_malloc64((sqlite3_int64)n + 1);
+    if (zNum) {
+        memcpy(zNum, z, n);
+        zNum[n] = 0;
+        if (iSep >= 0) {
+            zNum[iSep] = '.';
+        }
+    }
+    return zNum;
+}
+
+/*
+** Return the length of the n-byte field in z up to the first embedded
+** null, that is the length of the field as a C string
+*/
+static int vsv_strlen(const char* z, int n) {
+    const char* zNul = memchr(z, 0, n);
+    return zNul ? (int)(zNul - z) : n;
+}
+
+/*
+** Validate UTF-8 of the n-byte field in z up to the first embedded null
 ** Return -1 if invalid else length
 */
-static long long vsv_utf8IsValid(char* string) {
+static long long vsv_utf8IsValid(const char* string, int n) {
     long long length = 0;
-    unsigned char* start;
+    const unsigned char* start;
+    const unsigned char* end;
     int trailing = 0;
     unsigned char c;
 
-    start = (unsigned char*)string;
-    while ((c = *start)) {
+    start = (const unsigned char*)string;
+    end = start + n;
+    while (start < end && (c = *start)) {
         if (trailing) {
             if ((c & 0xC0) == 0x80) {
                 trailing--;
@@ -1336,141 +2809,573 @@ static long long vsv_utf8IsValid(char* string) {
 }
 
 /*
-** Return values of columns for the row at which the VsvCursor
-** is currently pointing.
+** Return a field as text.  If validatetext is in effect, a field that
+** is not valid UTF-8 or contains embedded nulls is returned as a blob,
+** or, if bStrict is set, raises an error.
 */
-static int vsvtabColumn(sqlite3_vtab_cursor* cur, /* The cursor */
-                        sqlite3_context* ctx,     /* First argument to sqlite3_result_...() */
-                        int i                     /* Which column to return */
-) {
-    VsvCursor* pCur = (VsvCursor*)cur;
-    VsvTable* pTab = (VsvTable*)cur->pVtab;
-    long long dLen = pCur->dLen[i];
-    long long length = 0;
-
-    if (i >= 0 && i < pTab->nCol && pCur->azVal[i] != 0 && dLen > -1) {
-        switch (pTab->affinity) {
-            case 0: {
-                if (pTab->validateUTF8) {
-                    length = vsv_utf8IsValid(pCur->azVal[i]);
-                    if (length == dLen) {
-                        sqlite3_result_text(ctx, pCur->azVal[i], dLen, SQLITE_TRANSIENT);
-                    } else {
-                        sqlite3_result_error(ctx, "Invalid UTF8 Data", -1);
-                    }
-                } else {
-                    sqlite3_result_text(ctx, pCur->azVal[i], -1, SQLITE_TRANSIENT);
-                }
-                break;
+static void vsv_result_text(sqlite3_context* ctx,
+                            VsvTable* pTab,
+                            const char* z,
+                            int n,
+                            int bStrict,
+                            void (*xDel)(void*)) {
+    long long length;
+    if (!pTab->validateUTF8) {
+        sqlite3_result_text(ctx, z, vsv_strlen(z, n), xDel);
+        return;
+    }
+    length = vsv_utf8IsValid(z, n);
+    if (bStrict) {
+        if (length == n) {
+            sqlite3_result_text(ctx, z, n, xDel);
+        } else {
+            sqlite3_result_error(ctx, "Invalid UTF8 Data", -1);
+        }
+    } else if (length < n) {
+        sqlite3_result_blob(ctx, z, n, xDel);
+    } else {
+        sqlite3_result_text(ctx, z, (int)length, xDel);
+    }
+}
+
+/*
+** Return the content of field i of the current row, unescaping it on
+** first use, and store its length in *pn.  Return 0 if there is an OOM
+** error.  The field must not be NULL.
+*/
+static const char* vsv_field(VsvCursor* pCur, int i, int* pn) {
+    if (pCur->aState[i] == VSV_FIELD_ESCAPED) {
+        const char* z = pCur->rdr.zIn + pCur->rdr.iRow + pCur->aOff[i];
+        int iOff = vsv_arena_unescape(&pCur->arena, z, pCur->dLen[i], &pCur->dLen[i]);
+        if (iOff < 0) {
+            return 0;
+        }
+        pCur->aOff[i] = iOff;
+        pCur->aState[i] = VSV_FIELD_ARENA;
+    }
+    *pn = pCur->dLen[i];
+    if (pCur->aState[i] == VSV_FIELD_ARENA) {
+        return pCur->arena.z + pCur->aOff[i];
+    }
+    return pCur->rdr.zIn + pCur->rdr.iRow + pCur->aOff[i];
+}
+
+/*
+** Return 1 if the n-byte text in z might be converted to a number when
+** numeric affinity is applied to it, that is if it starts with a digit,
+** a sign or a point after optional whitespace.  Return 0 otherwise.
+*/
+static int vsv_maybe_numeric(const char* z, int n) {
+    int i = 0;
+    while (i < n && (z[i] == ' ' || (z[i] >= '\t' && z[i] <= '\r'))) {
+        i++;
+    }
+    return i < n && (isdigit((unsigned char)z[i]) || z[i] == '+' || z[i] == '-' || z[i] == '.');
+}
+
+/*
+** Compare the n-byte text in z with the right-hand side of a constraint
+** the way SQLite does for a column without a declared type.  Return 0 if
+** the comparison certainly fails, or 1 if it holds or might hold.
+**
+** Text sorts after numbers and before blobs.  Text that might be numeric
+** is only decided by SQLite, as the right-hand side may have numeric
+** affinity, which converts such text before it is compared.
+*/
+static int vsv_filter_test(int op, const char* z, int n, sqlite3_value* pVal) {
+    int c;
+    switch (sqlite3_value_type(pVal)) {
+        case SQLITE_NULL:
+            return 0;
+        case SQLITE_INTEGER:
+        case SQLITE_FLOAT:
+            if (vsv_maybe_numeric(z, n)) {
+                return 1;
             }
-            case 1: {
-                sqlite3_result_blob(ctx, pCur->azVal[i], dLen, SQLITE_TRANSIENT);
-                break;
+            c = 1;
+            break;
+        case SQLITE_BLOB:
+            c = -1;
+            break;
+        default: {
+            const char* zVal = (const char*)sqlite3_value_text(pVal);
+            int nVal = sqlite3_value_bytes(pVal);
+            int bNum = vsv_maybe_numeric(z, n);
+            if (zVal == 0) {
+                return 1;
             }
-            case 2: {
-                if (pTab->validateUTF8) {
-                    length = vsv_utf8IsValid(pCur->azVal[i]);
-                    if (length < dLen) {
-                        sqlite3_result_blob(ctx, pCur->azVal[i], dLen, SQLITE_TRANSIENT);
-                    } else {
-                        sqlite3_result_text(ctx, pCur->azVal[i], length, SQLITE_TRANSIENT);
-                    }
-                } else {
-                    sqlite3_result_text(ctx, pCur->azVal[i], -1, SQLITE_TRANSIENT);
+            if (bNum != vsv_maybe_numeric(zVal, nVal)) {
+                /* unequal either way, but the order depends on affinity */
+                if (op != SQLITE_INDEX_CONSTRAINT_EQ) {
+                    return 1;
                 }
+            } else if (bNum) {
+                return 1;
+            }
+            c = memcmp(z, zVal, n < nVal ? n : nVal);
+            if (c == 0) {
+                c = n - nVal;
+            }
+        }
+    }
+    switch (op) {
+        case SQLITE_INDEX_CONSTRAINT_EQ:
+            return c == 0;
+        case SQLITE_INDEX_CONSTRAINT_GT:
+            return c > 0;
+        case SQLITE_INDEX_CONSTRAINT_GE:
+            return c >= 0;
+        case SQLITE_INDEX_CONSTRAINT_LT:
+            return c < 0;
+        case SQLITE_INDEX_CONSTRAINT_LE:
+            return c <= 0;
+    }
+    return 1;
+}
+
+/*
+** Check the current row against the constraints pushed down by
+** xBestIndex.  Return 1 if SQLite might accept the row, 0 if it would
+** certainly reject it, or -1 if there is an OOM error.
+**
+** Only the fields of constrained columns are looked at, and SQLite
+** still checks every row returned, so a row that is kept by mistake
+** costs time but does not change the result.
+*/
+static int vsv_filter_row(VsvCursor* pCur) {
+    int i, j;
+    for (i = 0; i < pCur->nFilter; i++) {
+        VsvFilter* pFilter = &pCur->aFilter[i];
+        const char* z;
+        int n;
+        if (pFilter->iCol < 0) {
+            /* rowid constraints bound the scan in xFilter */
+            continue;
+        }
+        if (pCur->dLen[pFilter->iCol] < 0) {
+            /* NULL fails every comparison */
+            return 0;
+        }
+        z = vsv_field(pCur, pFilter->iCol, &n);
+        if (z == 0) {
+            return -1;
+        }
+        n = vsv_strlen(z, n);
+        for (j = 0; j < pFilter->nVal; j++) {
+            if (vsv_filter_test(pFilter->op, z, n, pFilter->apVal[j])) {
                 break;
             }
-            case 3: {
-                switch (vsv_isValidNumber(pCur->rdr.dsep, pCur->azVal[i])) {
-                    case 1: {
-                        sqlite3_result_int64(ctx, strtoll(pCur->azVal[i], 0, 10));
-                        break;
-                    }
-                    default: {
-                        if (pTab->validateUTF8) {
-                            length = vsv_utf8IsValid(pCur->azVal[i]);
-                            if (length < dLen) {
-                                sqlite3_result_blob(ctx, pCur->azVal[i], dLen, SQLITE_TRANSIENT);
-                            } else {
-                                sqlite3_result_text(ctx, pCur->azVal[i], length, SQLITE_TRANSIENT);
-                            }
-                        } else {
-                            sqlite3_result_text(ctx, pCur->azVal[i], -1, SQLITE_TRANSIENT);
-                        }
-                        break;
-                    }
-                }
+        }
+        if (j == pFilter->nVal) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+** Parse the n-byte text in z as a decimal integer of at most 18 digits
+** with an optional sign, which always fits in 64 bits.  Return 1 and
+** store the value in *piVal, or return 0 if z is anything else, which
+** leaves it to strtoll().
+*/
+static int vsv_parse_integer(const char* z, int n, sqlite3_int64* piVal) {
+    sqlite3_int64 v = 0;
+    int i = 0;
+    int bNeg = 0;
+    if (n > 0 && (z[0] == '-' || z[0] == '+')) {
+        bNeg = z[0] == '-';
+        i = 1;
+    }
+    if (i == n || n - i > 18) {
+        return 0;
+    }
+    for (; i < n; i++) {
+        if (z[i] < '0' || z[i] > '9') {
+            return 0;
+        }
+        v = v * 10 + (z[i] - '0');
+    }
+    *piVal = bNeg ? -v : v;
+    return 1;
+}
+
+/*
+** Parse the n-byte text in z as a plain decimal number of at most 15
+** digits, with an optional sign and decimal separator but no exponent.
+** Return 1 and store the value in *prVal, or return 0 if z is anything
+** else, which leaves it to strtod().
+**
+** Such a number is m / 10^k with m < 2^53 and k <= 15, where both
+** operands are exact doubles, so the one rounding of the division gives
+** the same result as strtod().
+*/
+static int vsv_parse_real(int dsep, const char* z, int n, double* prVal) {
+    static const double aPow10[] = {1e0, 1e1, 1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                    1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    sqlite3_int64 m = 0;
+    int i = 0;
+    int bNeg = 0;
+    int nDigit = 0;
+    int nFrac = -1;
+    double r;
+    if (n > 0 && (z[0] == '-' || z[0] == '+')) {
+        bNeg = z[0] == '-';
+        i = 1;
+    }
+    for (; i < n; i++) {
+        if (z[i] >= '0' && z[i] <= '9') {
+            if (++nDigit > 15) {
+                return 0;
+            }
+            m = m * 10 + (z[i] - '0');
+            if (nFrac >= 0) {
+                nFrac++;
+            }
+        } else if (z[i] == dsep && nFrac < 0) {
+            nFrac = 0;
+        } else {
+            return 0;
+        }
+    }
+    if (nDigit == 0) {
+        return 0;
+    }
+    r = nFrac > 0 ? (double)m / aPow10[nFrac] : (double)m;
+    *prVal = bNeg ? -r : r;
+    return 1;
+}
+
+/*
+** Kinds of fields seen by infer=N and vsv_infer().  Each sampled field
+** sets one bit for its column, and the type of the column follows from
+** the bits set.
+*/
+#define VSV_SEEN_INTEGER 1
+#define VSV_SEEN_REAL 2
+#define VSV_SEEN_DATE 4
+#define VSV_SEEN_DATETIME 8
+#define VSV_SEEN_TEXT 16
+
+/*
+** Return 1 if the n bytes in z are all digits
+*/
+static int vsv_all_digits(const char* z, int n) {
+    int i;
+    for (i = 0; i < n; i++) {
+        if (!isdigit((unsigned char)z[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+** Classify the n-byte text in z as a YYYY-MM-DD date, a date followed by
+** a HH:MM[:SS[.SSS]] time with an optional Z or +HH:MM zone, or text
+*/
+static int vsv_infer_date(const char* z, int n) {
+    int i;
+    if (n < 10 || !vsv_all_digits(z, 4) || z[4] != '-' || !vsv_all_digits(z + 5, 2) ||
+        z[7] != '-' || !vsv_all_digits(z + 8, 2) || atoi(z + 5) < 1 || atoi(z + 5) > 12 ||
+        atoi(z + 8) < 1 || atoi(z + 8) > 31) {
+        return VSV_SEEN_TEXT;
+    }
+    if (n == 10) {
+        return VSV_SEEN_DATE;
+    }
+    if (n < 16 || (z[10] != ' ' && z[10] != 'T') || !vsv_all_digits(z + 11, 2) || z[13] != ':' ||
+        !vsv_all_digits(z + 14, 2) || atoi(z + 11) > 23 || atoi(z + 14) > 59) {
+        return VSV_SEEN_TEXT;
+    }
+    i = 16;
+    if (i + 3 <= n && z[i] == ':' && vsv_all_digits(z + i + 1, 2)) {
+        i += 3;
+        if (i + 2 <= n && z[i] == '.' && isdigit((unsigned char)z[i + 1])) {
+            for (i++; i < n && isdigit((unsigned char)z[i]); i++) {
+            }
+        }
+    }
+    if (i < n && z[i] == 'Z') {
+        i++;
+    } else if (i + 6 == n && (z[i] == '+' || z[i] == '-') && vsv_all_digits(z + i + 1, 2) &&
+               z[i + 3] == ':' && vsv_all_digits(z + i + 4, 2)) {
+        i += 6;
+    }
+    return i == n ? VSV_SEEN_DATETIME : VSV_SEEN_TEXT;
+}
+
+/*
+** Classify the n-byte field in z.  Empty fields say nothing about the
+** type of their column.  Integers of more than 18 digits might not fit
+** in 64 bits, so they are taken as text rather than rounded.
+*/
+static int vsv_infer_field(int dsep, const char* z, int n) {
+    int i, iSep, nDigit = 0;
+    if (n == 0) {
+        return 0;
+    }
+    switch (vsv_isValidNumber(dsep, z, n, &iSep)) {
+        case 1:
+            for (i = 0; i < n; i++) {
+                nDigit += isdigit((unsigned char)z[i]) != 0;
+            }
+            return nDigit <= 18 ? VSV_SEEN_INTEGER : VSV_SEEN_TEXT;
+        case 2:
+            return VSV_SEEN_REAL;
+    }
+    return vsv_infer_date(z, n);
+}
+
+/*
+** Return the declared type of a column from the kinds of its sampled
+** fields, and store in *pAffinity the affinity= code that its values
+** are returned with
+*/
+static const char* vsv_infer_type(int mSeen, int* pAffinity) {
+    *pAffinity = 0;
+    if (mSeen == VSV_SEEN_INTEGER) {
+        *pAffinity = 3;
+        return "INTEGER";
+    }
+    if (mSeen == VSV_SEEN_REAL || mSeen == (VSV_SEEN_INTEGER | VSV_SEEN_REAL)) {
+        *pAffinity = 4;
+        return "REAL";
+    }
+    if (mSeen == VSV_SEEN_DATE) {
+        return "DATE";
+    }
+    if (mSeen != 0 && (mSeen & ~(VSV_SEEN_DATE | VSV_SEEN_DATETIME)) == 0) {
+        return "DATETIME";
+    }
+    return "TEXT";
+}
+
+/*
+** Sample up to nSample records of a VSV file, after the header row and
+** nSkip more records, and build a CREATE TABLE statement that declares
+** the type of each column.  Columns are named after the header, or cX
+** where X is the column number.  If *pnCol is positive, the table has
+** that many columns, otherwise *pnCol is set to the number of fields in
+** the first record.  The affinity= code of each column is stored in a
+** new array in *paAffinity.
+**
+** p must have its separators set.  Return 0 on error, with a message in
+** p->zErr.  The caller resets the reader in either case.
+*/
+static char* vsv_infer_schema(VsvReader* p,
+                              const char* zFilename,
+                              const char* zData,
+                              size_t nBuffer,
+                              int bHeader,
+                              int nSkip,
+                              int nSample,
+                              int* pnCol,
+                              int** paAffinity) {
+    sqlite3_str* pStr;
+    char* zSchema = 0;
+    char** azName = 0; /* Header fields */
+    int nName = 0;
+    int* aSeen = 0; /* VSV_SEEN_* bits of each column */
+    int nSeen = 0;
+    int nFirst = 0; /* Number of fields in the first record */
+    int* aAffinity;
+    int i, iRow;
+
+    *paAffinity = 0;
+    if (vsv_reader_open(p, zFilename, zData, nBuffer)) {
+        return 0;
+    }
+    if (bHeader) {
+        do {
+            const char* z = vsv_read_one_field(p);
+            char** azNew;
+            if (z == 0) {
                 break;
             }
-            case 4: {
-                switch (vsv_isValidNumber(pCur->rdr.dsep, pCur->azVal[i])) {
-                    case 1:
-                    case 2: {
-                        sqlite3_result_double(ctx, strtod(pCur->azVal[i], 0));
-                        break;
-                    }
-                    default: {
-                        if (pTab->validateUTF8) {
-                            length = vsv_utf8IsValid(pCur->azVal[i]);
-                            if (length < dLen) {
-                                sqlite3_result_blob(ctx, pCur->azVal[i], dLen, SQLITE_TRANSIENT);
-                            } else {
-                                sqlite3_result_text(ctx, pCur->azVal[i], length, SQLITE_TRANSIENT);
-                            }
-                        } else {
-                            sqlite3_result_text(ctx, pCur->azVal[i], -1, SQLITE_TRANSIENT);
-                        }
-                        break;
-                    }
-                }
+            azNew = sqlite3_realloc64(azName, (nName + 1) * sizeof(char*));
+            if (azNew == 0) {
+                goto vsv_infer_oom;
+            }
+            azName = azNew;
+            if ((azName[nName] = sqlite3_mprintf("%s", z)) == 0) {
+                goto vsv_infer_oom;
+            }
+            nName++;
+        } while (p->cTerm == p->fsep);
+    }
+    for (i = 0; i < nSkip && p->cTerm != EOF; i++) {
+        do {
+            vsv_read_one_field(p);
+        } while (p->cTerm == p->fsep);
+    }
+    for (iRow = 0; iRow < nSample && p->cTerm != EOF; iRow++) {
+        int iCol = 0;
+        do {
+            const char* z = vsv_read_one_field(p);
+            if (z == 0) {
                 break;
             }
-            case 5: {
-                switch (vsv_isValidNumber(pCur->rdr.dsep, pCur->azVal[i])) {
-                    case 1: {
-                        sqlite3_result_int64(ctx, strtoll(pCur->azVal[i], 0, 10));
-                        break;
-                    }
-                    case 2: {
-                        long double dv, fp, ip;
-
-                        dv = strtold(pCur->azVal[i], 0);
-                        fp = modfl(dv, &ip);
-                        if (sizeof(long double) > sizeof(double)) {
-                            if (fp == 0.0L && dv >= -9223372036854775808.0L &&
-                                dv <= 9223372036854775807.0L) {
-                                sqlite3_result_int64(ctx, (long long)dv);
-                            } else {
-                                sqlite3_result_double(ctx, (double)dv);
-                            }
-                        } else {
-                            // Only convert if it will fit in a 6-byte varint
-                            if (fp == 0.0L && dv >= -140737488355328.0L &&
-                                dv <= 140737488355328.0L) {
-                                sqlite3_result_int64(ctx, (long long)dv);
-                            } else {
-                                sqlite3_result_double(ctx, (double)dv);
-                            }
-                        }
-                        break;
-                    }
-                    default: {
-                        if (pTab->validateUTF8) {
-                            length = vsv_utf8IsValid(pCur->azVal[i]);
-                            if (length < dLen) {
-                                sqlite3_result_blob(ctx, pCur->azVal[i], dLen, SQLITE_TRANSIENT);
-                            } else {
-                                sqlite3_result_text(ctx, pCur->azVal[i], length, SQLITE_TRANSIENT);
-                            }
-                        } else {
-                            sqlite3_result_text(ctx, pCur->azVal[i], -1, SQLITE_TRANSIENT);
-                        }
-                        break;
-                    }
+            if (iCol == nSeen) {
+                int* aNew = sqlite3_realloc64(aSeen, (nSeen + 1) * sizeof(int));
+                if (aNew == 0) {
+                    goto vsv_infer_oom;
                 }
+                aSeen = aNew;
+                aSeen[nSeen++] = 0;
+            }
+            aSeen[iCol++] |= vsv_infer_field(p->dsep, z, p->n);
+        } while (p->cTerm == p->fsep);
+        if (iRow == 0) {
+            nFirst = iCol;
+        }
+    }
+    if (p->zErr[0]) {
+        goto vsv_infer_done;
+    }
+    if (*pnCol <= 0) {
+        *pnCol = bHeader ? nName : nFirst;
+    }
+    if (*pnCol <= 0) {
+        vsv_errmsg(p, "no columns to infer");
+        goto vsv_infer_done;
+    }
+    aAffinity = sqlite3_malloc64(*pnCol * sizeof(int));
+    if (aAffinity == 0) {
+        goto vsv_infer_oom;
+    }
+    *paAffinity = aAffinity;
+    pStr = sqlite3_str_new(0);
+    sqlite3_str_appendall(pStr, "CREATE TABLE x(");
+    for (i = 0; i < *pnCol; i++) {
+        const char* zType = vsv_infer_type(i < nSeen ? aSeen[i] : 0, &aAffinity[i]);
+        const char* zSep = i > 0 ? "," : "";
+        if (i < nName) {
+            sqlite3_str_appendf(pStr, "%s\"%w\" %s", zSep, azName[i], zType);
+        } else {
+            sqlite3_str_appendf(pStr, "%sc%d %s", zSep, bHeader ? i + 1 : i, zType);
+        }
+    }
+    sqlite3_str_appendall(pStr, ")");
+    zSchema = sqlite3_str_finish(pStr);
+    if (zSchema == 0) {
+        goto vsv_infer_oom;
+    }
+    goto vsv_infer_done;
+
+vsv_infer_oom:
+    vsv_errmsg(p, "out of memory");
+
+vsv_infer_done:
+    if (zSchema == 0) {
+        sqlite3_free(*paAffinity);
+        *paAffinity = 0;
+    }
+    for (i = 0; i < nName; i++) {
+        sqlite3_free(azName[i]);
+    }
+    sqlite3_free(azName);
+    sqlite3_free(aSeen);
+    return zSchema;
+}
+
+/*
+** Return values of columns for the row at which the VsvCursor
+** is currently pointing.
+**
+** Fields are unescaped on first use.  Fields of a memory-mapped file or
+** of data= text stay valid for as long as the table exists, so they are
+** handed to SQLite without another copy.
+*/
+static int vsvtabColumn(sqlite3_vtab_cursor* cur, /* The cursor */
+                        sqlite3_context* ctx,     /* First argument to sqlite3_result_...() */
+                        int i                     /* Which column to return */
+) {
+    VsvCursor* pCur = (VsvCursor*)cur;
+    VsvTable* pTab = (VsvTable*)cur->pVtab;
+    const char* z;
+    int dLen, nStr, iSep, kind, affinity;
+    void (*xDel)(void*);
+    char zBuf[64];
+    char* zNum;
+    sqlite3_int64 iVal;
+    double rVal;
+
+    if (i < 0 || i >= pTab->nCol || pCur->dLen[i] < 0) {
+        return SQLITE_OK;
+    }
+    z = vsv_field(pCur, i, &dLen);
+    if (z == 0) {
+        sqlite3_result_error_nomem(ctx);
+        return SQLITE_OK;
+    }
+    if (pCur->aState[i] == VSV_FIELD_ARENA || pCur->rdr.in != 0) {
+        xDel = SQLITE_TRANSIENT;
+    } else {
+        xDel = SQLITE_STATIC;
+    }
+    affinity = pTab->aAffinity ? pTab->aAffinity[i] : pTab->affinity;
+    switch (affinity) {
+        case 0: {
+            vsv_result_text(ctx, pTab, z, dLen, 1, xDel);
+            return SQLITE_OK;
+        }
+        case 1: {
+            sqlite3_result_blob(ctx, z, dLen, xDel);
+            return SQLITE_OK;
+        }
+        case 2: {
+            vsv_result_text(ctx, pTab, z, dLen, 0, xDel);
+            return SQLITE_OK;
+        }
+    }
+    nStr = vsv_strlen(z, dLen);
+    if (affinity == 4) {
+        if (vsv_parse_real(pCur->rdr.dsep, z, nStr, &rVal)) {
+            sqlite3_result_double(ctx, rVal);
+            return SQLITE_OK;
+        }
+    } else if (vsv_parse_integer(z, nStr, &iVal)) {
+        sqlite3_result_int64(ctx, iVal);
+        return SQLITE_OK;
+    }
+    kind = vsv_isValidNumber(pCur->rdr.dsep, z, nStr, &iSep);
+    if (kind == 0 || (kind == 2 && affinity == 3)) {
+        vsv_result_text(ctx, pTab, z, dLen, 0, xDel);
+        return SQLITE_OK;
+    }
+    zNum = vsv_number_copy(z, nStr, iSep, zBuf, sizeof(zBuf));
+    if (zNum == 0) {
+        sqlite3_result_error_nomem(ctx);
+        return SQLITE_OK;
+    }
+    if (kind == 1 && affinity != 4) {
+        sqlite3_result_int64(ctx, strtoll(zNum, 0, 10));
+    } else if (affinity == 4) {
+        sqlite3_result_double(ctx, strtod(zNum, 0));
+    } else {
+        long double dv, fp, ip;
+
+        dv = strtold(zNum, 0);
+        fp = modfl(dv, &ip);
+        if (sizeof(long double) > sizeof(double)) {
+            if (fp == 0.0L && dv >= -9223372036854775808.0L && dv <= 9223372036854775807.0L) {
+                sqlite3_result_int64(ctx, (long long)dv);
+            } else {
+                sqlite3_result_double(ctx, (double)dv);
+            }
+        } else {
+            // Only convert if it will fit in a 6-byte varint
+            if (fp == 0.0L && dv >= -140737488355328.0L && dv <= 140737488355328.0L) {
+                sqlite3_result_int64(ctx, (long long)dv);
+            } else {
+                sqlite3_result_double(ctx, (double)dv);
             }
         }
     }
+    if (zNum != zBuf) {
+        sqlite3_free(zNum);
+    }
     return SQLITE_OK;
 }
 
@@ -1493,55 +3398,1699 @@ static int vsvtabEof(sqlite3_vtab_cursor* cur) {
 }
 
 /*
-** Only a full table scan is supported.  So xFilter simply rewinds to
-** the beginning.
+** Decode the constraints chosen by xBestIndex from idxStr, where each
+** one is "OP COLUMN IN;", and take copies of their values from argv[].
+** Return the number of arguments consumed, or -1 if there is an OOM
+** error.
 */
-static int vsvtabFilter(sqlite3_vtab_cursor* pVtabCursor,
-                        int idxNum,
-                        const char* idxStr,
-                        int argc,
-                        sqlite3_value** argv) {
-    VsvCursor* pCur = (VsvCursor*)pVtabCursor;
-    VsvTable* pTab = (VsvTable*)pVtabCursor->pVtab;
-    pCur->iRowid = 0;
-    if (pCur->rdr.in == 0) {
-        assert(pCur->rdr.zIn == pTab->zData);
-        assert(pTab->iStart >= 0);
-        assert((size_t)pTab->iStart <= pCur->rdr.nIn);
-        pCur->rdr.iIn = pTab->iStart;
-    } else {
-        fseek(pCur->rdr.in, pTab->iStart, SEEK_SET);
-        pCur->rdr.iIn = 0;
-        pCur->rdr.nIn = 0;
+static int vsvtabCursorFilterInit(VsvCursor* pCur, const char* idxStr, sqlite3_value** argv) {
+    const char* z;
+    int n = 0;
+    for (z = idxStr; z && *z; z++) {
+        n += *z == ';';
     }
-    return vsvtabNext(pVtabCursor);
+    if (n == 0) {
+        return 0;
+    }
+    pCur->aFilter = sqlite3_malloc64(sizeof(VsvFilter) * n);
+    if (pCur->aFilter == 0) {
+        return -1;
+    }
+    for (z = idxStr; pCur->nFilter < n; z++) {
+        VsvFilter* pFilter = &pCur->aFilter[pCur->nFilter];
+        sqlite3_value* pArg = argv[pCur->nFilter];
+        char* zEnd;
+        int bIn;
+        pFilter->op = (int)strtol(z, &zEnd, 10);
+        pFilter->iCol = (int)strtol(zEnd, &zEnd, 10);
+        bIn = (int)strtol(zEnd, &zEnd, 10);
+        z = zEnd;
+        pFilter->nVal = 0;
+        pFilter->apVal = 0;
+        pCur->nFilter++;
+#ifdef SQLITE_INDEX_CONSTRAINT_LIMIT
+        if (bIn) {
+            sqlite3_value* pVal;
+            int rc;
+            for (rc = sqlite3_vtab_in_first(pArg, &pVal); rc == SQLITE_OK && pVal;
+                 rc = sqlite3_vtab_in_next(pArg, &pVal)) {
+                sqlite3_value** apNew;
+                apNew = sqlite3_realloc64(pFilter->apVal, sizeof(pVal) * (pFilter->nVal + 1));
+                if (apNew == 0) {
+                    return -1;
+                }
+                pFilter->apVal = apNew;
+                if ((apNew[pFilter->nVal] = sqlite3_value_dup(pVal)) == 0) {
+                    return -1;
+                }
+                pFilter->nVal++;
+            }
+            if (rc != SQLITE_OK && rc != SQLITE_DONE) {
+                return -1;
+            }
+            continue;
+        }
+#else
+        (void)bIn;
+#endif
+        pFilter->apVal = sqlite3_malloc64(sizeof(pArg));
+        if (pFilter->apVal == 0) {
+            return -1;
+        }
+        if ((pFilter->apVal[0] = sqlite3_value_dup(pArg)) == 0) {
+            return -1;
+        }
+        pFilter->nVal = 1;
+    }
+    return n;
 }
 
 /*
-** Only a forward full table scan is supported.  xBestIndex is mostly
-** a no-op.
+** Rowids past this one are treated as unbounded
 */
-static int vsvtabBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
-    pIdxInfo->estimatedCost = 1000000;
-    return SQLITE_OK;
+#define VSV_ROWID_MAX ((sqlite3_int64)1 << 62)
+
+static sqlite3_int64 vsv_rowid_clamp(double r) {
+    return r < 0 ? -1 : r > (double)VSV_ROWID_MAX ? VSV_ROWID_MAX : (sqlite3_int64)r;
 }
 
-static sqlite3_module vsv_module = {
-    .xCreate = vsvtabCreate,
-    .xConnect = vsvtabConnect,
-    .xBestIndex = vsvtabBestIndex,
-    .xDisconnect = vsvtabDisconnect,
-    .xDestroy = vsvtabDisconnect,
-    .xOpen = vsvtabOpen,
-    .xClose = vsvtabClose,
-    .xFilter = vsvtabFilter,
-    .xNext = vsvtabNext,
-    .xEof = vsvtabEof,
-    .xColumn = vsvtabColumn,
-    .xRowid = vsvtabRowid,
-};
+/*
+** Narrow the range [*piFirst, *piLast] of rowids that can satisfy a
+** rowid constraint.  Values that are not numbers leave it as it is,
+** since SQLite decides how they compare.
+*/
+static void vsv_rowid_bound(int op,
+                            sqlite3_value* pVal,
+                            sqlite3_int64* piFirst,
+                            sqlite3_int64* piLast) {
+    sqlite3_int64 iFloor, iCeil;
+    switch (sqlite3_value_numeric_type(pVal)) {
+        case SQLITE_NULL:
+            *piLast = 0;
+            return;
+        case SQLITE_INTEGER: {
+            sqlite3_int64 v = sqlite3_value_int64(pVal);
+            iFloor = iCeil = v < 0 ? -1 : v > VSV_ROWID_MAX ? VSV_ROWID_MAX : v;
+            break;
+        }
+        case SQLITE_FLOAT: {
+            double r = sqlite3_value_double(pVal);
+            if (r != r) {
+                return;
+            }
+            iFloor = vsv_rowid_clamp(floor(r));
+            iCeil = vsv_rowid_clamp(ceil(r));
+            break;
+        }
+        default:
+            return;
+    }
+    switch (op) {
+        case SQLITE_INDEX_CONSTRAINT_EQ:
+            if (iFloor != iCeil) {
+                *piLast = 0;
+            }
+            if (iFloor > *piFirst) {
+                *piFirst = iFloor;
+            }
+            if (iFloor < *piLast) {
+                *piLast = iFloor;
+            }
+            break;
+        case SQLITE_INDEX_CONSTRAINT_GT:
+            if (iFloor + 1 > *piFirst) {
+                *piFirst = iFloor + 1;
+            }
+            break;
+        case SQLITE_INDEX_CONSTRAINT_GE:
+            if (iCeil > *piFirst) {
+                *piFirst = iCeil;
+            }
+            break;
+        case SQLITE_INDEX_CONSTRAINT_LT:
+            if (iCeil - 1 < *piLast) {
+                *piLast = iCeil - 1;
+            }
+            break;
+        case SQLITE_INDEX_CONSTRAINT_LE:
+            if (iFloor < *piLast) {
+                *piLast = iFloor;
+            }
+            break;
+    }
+}
+
+#if defined(VSV_DECOMPRESS)
+/*
+** Position a VsvCursor at offset iOff of the decompressed data of its
+** file.  Compressed data can only be read forward, so the file is
+** opened again to go back beyond the input buffer.
+*/
+static void vsvtabCursorSeekCompressed(VsvCursor* pCur, sqlite3_int64 iOff) {
+    VsvTable* pTab = (VsvTable*)pCur->base.pVtab;
+    VsvReader* p = &pCur->rdr;
+    sqlite3_int64 iBuf = p->nRead - (sqlite3_int64)p->nIn;
+    if (iOff < iBuf) {
+        VsvReader sRdr;
+        vsv_reader_init(&sRdr);
+        if (vsv_reader_open(&sRdr, pTab->zFilename, 0, pTab->nBuffer)) {
+            /* keep reading from where the cursor is, and report the error */
+            memcpy(p->zErr, sRdr.zErr, VSV_MXERR);
+            p->bError = 1;
+            p->iIn = p->nIn;
+            return;
+        }
+        sRdr.fsep = p->fsep;
+        sRdr.rsep = p->rsep;
+        sRdr.dsep = p->dsep;
+        sRdr.affinity = p->affinity;
+        sRdr.bInPlace = p->bInPlace;
+        vsv_reader_reset(p);
+        *p = sRdr;
+        iBuf = 0;
+    }
+    /* skip forward, a buffer at a time */
+    while (iOff > p->nRead) {
+        p->iIn = p->iRow = p->nIn;
+        if (vsv_available(p) == 0) {
+            break;
+        }
+    }
+    p->iRow = 0;
+    iBuf = p->nRead - (sqlite3_int64)p->nIn;
+    p->iIn = iOff - iBuf < (sqlite3_int64)p->nIn ? (size_t)(iOff - iBuf) : p->nIn;
+}
+#endif
+
+/*
+** Position a VsvCursor at offset iOff of its file or data
+*/
+static void vsvtabCursorSeek(VsvCursor* pCur, sqlite3_int64 iOff) {
+    pCur->rdr.iRow = 0;
+#if defined(VSV_DECOMPRESS)
+    if (pCur->rdr.pSrc) {
+        vsvtabCursorSeekCompressed(pCur, iOff);
+        return;
+    }
+#endif
+    if (pCur->rdr.in == 0) {
+        /* a mapped file may have been truncated since it was opened */
+        if ((sqlite3_uint64)iOff <= pCur->rdr.nIn) {
+            pCur->rdr.iIn = (size_t)iOff;
+        } else {
+            pCur->rdr.iIn = pCur->rdr.nIn;
+        }
+    } else {
+        fseek(pCur->rdr.in, (long)iOff, SEEK_SET);
+        pCur->rdr.iIn = 0;
+        pCur->rdr.nIn = 0;
+    }
+}
+
+/*
+** Return true if offset iOff of the input of a VsvCursor follows a
+** record separator, as a record kept in the sidecar index does.
+** Compressed input cannot be checked without reading up to iOff, so
+** it always passes.
+*/
+static int vsvtabCursorAtRecord(VsvCursor* pCur, sqlite3_int64 iOff) {
+    VsvReader* p = &pCur->rdr;
+    if (iOff <= 0) {
+        return 0;
+    }
+    if (p->in == 0) {
+        return (sqlite3_uint64)iOff <= p->nIn && p->zIn[iOff - 1] == p->rsep;
+    }
+    if (p->pSrc) {
+        return 1;
+    }
+    return fseek(p->in, (long)(iOff - 1), SEEK_SET) == 0 && fgetc(p->in) == p->rsep;
+}
+
+/*
+** Check the file of a mapped VsvCursor before a scan.  If it has
+** changed, the cursor switches to a new mapping of it, so that it reads
+** neither stale rows nor pages past the end of a truncated file.  If
+** the file can no longer be mapped, it is read through stdio instead.
+*/
+static int vsvtabCursorRemap(VsvCursor* pCur) {
+    VsvTable* pTab = (VsvTable*)pCur->base.pVtab;
+    VsvReader sRdr;
+    if (vsv_map_file(pTab) == 0) {
+        if (pCur->pMap != pTab->pMap) {
+            vsv_map_unref(pCur->pMap);
+            pCur->pMap = pTab->pMap;
+            pCur->pMap->nRef++;
+            pCur->rdr.zIn = pCur->pMap->z;
+            pCur->rdr.nIn = pCur->pMap->n;
+        }
+        return SQLITE_OK;
+    }
+    vsv_reader_init(&sRdr);
+    if (vsv_reader_open(&sRdr, pTab->zFilename, 0, pTab->nBuffer)) {
+        vsv_xfer_error(pTab, &sRdr);
+        return SQLITE_ERROR;
+    }
+    sRdr.fsep = pCur->rdr.fsep;
+    sRdr.rsep = pCur->rdr.rsep;
+    sRdr.dsep = pCur->rdr.dsep;
+    sRdr.affinity = pCur->rdr.affinity;
+    sRdr.bInPlace = pCur->rdr.bInPlace;
+    vsv_reader_reset(&pCur->rdr);
+    pCur->rdr = sRdr;
+    vsv_map_unref(pCur->pMap);
+    pCur->pMap = 0;
+    return SQLITE_OK;
+}
+
+/*
+** Only a forward scan is supported.  xFilter takes the constraints
+** chosen by xBestIndex, then starts at the first row that rowid
+** constraints and OFFSET allow.  It seeks to the nearest record kept
+** in the sidecar index, if there is one, and skips the records up to
+** that row without parsing them.  Otherwise a scan that starts at the
+** beginning builds the sidecar index, if index=yes.
+*/
+static int vsvtabFilter(sqlite3_vtab_cursor* pVtabCursor,
+                        int idxNum,
+                        const char* idxStr,
+                        int argc,
+                        sqlite3_value** argv) {
+    VsvCursor* pCur = (VsvCursor*)pVtabCursor;
+    VsvTable* pTab = (VsvTable*)pVtabCursor->pVtab;
+    sqlite3_int64 iFirst = 1;
+    sqlite3_int64 iLast = VSV_ROWID_MAX;
+    sqlite3_int64 k = 0;
+    VsvStat sStat;
+    int bIndex;
+    int iArg;
+    int i;
+    if (pCur->pMap && vsvtabCursorRemap(pCur) != SQLITE_OK) {
+        return SQLITE_ERROR;
+    }
+    pCur->iRowid = 0;
+    pCur->nParse = idxNum & VSV_INDEX_COLUMNS;
+    vsvtabCursorFilterReset(pCur);
+    iArg = vsvtabCursorFilterInit(pCur, idxStr, argv);
+    if (iArg < 0) {
+        return SQLITE_NOMEM;
+    }
+    for (i = 0; i < pCur->nFilter; i++) {
+        if (pCur->aFilter[i].iCol < 0) {
+            vsv_rowid_bound(pCur->aFilter[i].op, pCur->aFilter[i].apVal[0], &iFirst, &iLast);
+        }
+    }
+    if (idxNum & VSV_INDEX_LIMIT) {
+        sqlite3_int64 nLimit = sqlite3_value_int64(argv[iArg++]);
+        iLast = nLimit < 0 || nLimit > VSV_ROWID_MAX ? VSV_ROWID_MAX : nLimit;
+    }
+    if (idxNum & VSV_INDEX_OFFSET) {
+        sqlite3_int64 nOffset = sqlite3_value_int64(argv[iArg++]);
+        iFirst = nOffset < 0 ? 1 : nOffset > VSV_ROWID_MAX ? VSV_ROWID_MAX : nOffset + 1;
+        if (iLast < VSV_ROWID_MAX) {
+            iLast = iFirst - 1 + iLast;
+        }
+    }
+    assert(iArg == argc);
+    assert(pCur->rdr.in != 0 || pCur->rdr.zIn == pTab->zData ||
+           (pCur->pMap && pCur->rdr.zIn == pCur->pMap->z));
+    assert(pTab->iStart >= 0);
+    if (iFirst > iLast) {
+        pCur->iRowid = -1;
+        return SQLITE_OK;
+    }
+    pCur->iLast = iLast < VSV_ROWID_MAX ? iLast : -1;
+    bIndex = vsv_index_check(pTab, &sStat);
+    if (bIndex && iFirst > VSV_INDEX_STRIDE) {
+        k = (iFirst - 1) / VSV_INDEX_STRIDE;
+        if (k >= pTab->nIndex) {
+            k = pTab->nIndex - 1;
+        }
+        if (k > 0 && !vsvtabCursorAtRecord(pCur, pTab->aIndex[k])) {
+            /* the file has changed in a way its stat does not show */
+            vsv_index_drop(pTab);
+            bIndex = 0;
+            k = 0;
+        }
+    }
+    if (k > 0) {
+        vsvtabCursorSeek(pCur, pTab->aIndex[k]);
+        pCur->iRowid = k * VSV_INDEX_STRIDE;
+    } else {
+        vsvtabCursorSeek(pCur, pTab->iStart);
+    }
+    pCur->nBuild = 0;
+    pCur->bBuild = !bIndex && sStat.iSize >= 0 && pCur->iRowid == 0 &&
+                   (pCur->rdr.in != 0 || (sqlite3_int64)pCur->rdr.nIn == sStat.iSize);
+    pCur->sBuildStat = sStat;
+    while (pCur->iRowid < iFirst - 1 && vsv_available(&pCur->rdr) > 0) {
+        if (pCur->bBuild) {
+            vsv_index_note(pCur);
+        }
+        pCur->rdr.iRow = pCur->rdr.iIn;
+        vsv_skip_record(&pCur->rdr);
+        pCur->iRowid++;
+    }
+    if (pCur->rdr.bNoMem) {
+        vsv_xfer_error(pTab, &pCur->rdr);
+        return SQLITE_NOMEM;
+    }
+    if (pCur->rdr.bError) {
+        vsv_xfer_error(pTab, &pCur->rdr);
+        return SQLITE_ERROR;
+    }
+    return vsvtabNext(pVtabCursor);
+}
+
+/*
+** Only a forward full table scan is supported.  xBestIndex tells
+** xFilter how many leading columns the query uses, so that the rest of
+** each row can be skipped.
+**
+** Equality and range constraints on columns, IN lists included, are
+** checked against the raw fields before a row is returned, but are left
+** for SQLite to double-check.  They are only taken for tables with a
+** generated schema, where SQLite compares the text of a field as is, and
+** with the default collation.  Equality and range constraints on the
+** rowid bound the scan.  Rows come in rowid order, so an ORDER BY of
+** the rowid alone, ascending, is consumed.  LIMIT and OFFSET are
+** consumed only when no other constraint could filter rows out, and
+** there is no ORDER BY left for SQLite to sort the rows by.
+*/
+static int vsvtabBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
+    VsvTable* pTab = (VsvTable*)tab;
+    sqlite3_str* pStr = 0;
+    int hasFilter = 0; /* True if some constraint is checked by SQLite */
+    int bRowid = 0;    /* True if there is a rowid equality constraint */
+    int iLimit = -1, iOffset = -1;
+    int nArg = 0;
+    int nParse = 0;
+    int i;
+    for (i = 0; i < pTab->nCol; i++) {
+        /* the last bit stands for all the columns past it */
+        if (pIdxInfo->colUsed & ((sqlite3_uint64)1 << (i < 63 ? i : 63))) {
+            nParse = i + 1;
+        }
+    }
+    for (i = 0; i < pIdxInfo->nConstraint; i++) {
+        const struct sqlite3_index_constraint* pCons = &pIdxInfo->aConstraint[i];
+        const char* zColl;
+        int bIn = 0;
+#ifdef SQLITE_INDEX_CONSTRAINT_LIMIT
+        if (pCons->op == SQLITE_INDEX_CONSTRAINT_LIMIT ||
+            pCons->op == SQLITE_INDEX_CONSTRAINT_OFFSET) {
+            if (pCons->usable) {
+                if (pCons->op == SQLITE_INDEX_CONSTRAINT_LIMIT)
+                    iLimit = i;
+                else
+                    iOffset = i;
+            }
+            continue;
+        }
+#endif
+        hasFilter = 1;
+        if (!pCons->usable || pCons->iColumn >= pTab->nCol) {
+            continue;
+        }
+        if (pCons->iColumn >= 0) {
+            zColl = sqlite3_vtab_collation(pIdxInfo, i);
+            if (!pTab->bFilter || (zColl && sqlite3_stricmp(zColl, "BINARY") != 0)) {
+                continue;
+            }
+        }
+        switch (pCons->op) {
+            case SQLITE_INDEX_CONSTRAINT_EQ:
+                /*
+                ** An IN list shows up as an equality.  Unless it can be
+                ** taken all at once, xFilter would run once per value,
+                ** and each run reads the file up to the row.  IN lists
+                ** of rowids are left to SQLite.
+                */
+#ifdef SQLITE_INDEX_CONSTRAINT_LIMIT
+                if (sqlite3_libversion_number() < 3038000) {
+                    continue;
+                }
+                if (sqlite3_vtab_in(pIdxInfo, i, -1)) {
+                    if (pCons->iColumn < 0) {
+                        continue;
+                    }
+                    sqlite3_vtab_in(pIdxInfo, i, 1);
+                    bIn = 1;
+                } else if (pCons->iColumn < 0) {
+                    bRowid = 1;
+                }
+                break;
+#else
+                continue;
+#endif
+            case SQLITE_INDEX_CONSTRAINT_GT:
+            case SQLITE_INDEX_CONSTRAINT_GE:
+            case SQLITE_INDEX_CONSTRAINT_LT:
+            case SQLITE_INDEX_CONSTRAINT_LE:
+                break;
+            default:
+                continue;
+        }
+        if (pStr == 0) {
+            pStr = sqlite3_str_new(0);
+        }
+        sqlite3_str_appendf(pStr, "%d %d %d;", pCons->op, pCons->iColumn, bIn);
+        pIdxInfo->aConstraintUsage[i].argvIndex = ++nArg;
+        if (pCons->iColumn >= nParse) {
+            nParse = pCons->iColumn + 1;
+        }
+    }
+    if (pStr) {
+        pIdxInfo->idxStr = sqlite3_str_finish(pStr);
+        if (pIdxInfo->idxStr == 0) {
+            return SQLITE_NOMEM;
+        }
+        pIdxInfo->needToFreeIdxStr = 1;
+    }
+    if (pIdxInfo->nOrderBy == 1 && pIdxInfo->aOrderBy[0].iColumn < 0 &&
+        !pIdxInfo->aOrderBy[0].desc) {
+        pIdxInfo->orderByConsumed = 1;
+    }
+    if (!hasFilter && (pIdxInfo->nOrderBy == 0 || pIdxInfo->orderByConsumed)) {
+        if (iLimit >= 0) {
+            nParse |= VSV_INDEX_LIMIT;
+            pIdxInfo->aConstraintUsage[iLimit].argvIndex = ++nArg;
+        }
+        if (iOffset >= 0) {
+            nParse |= VSV_INDEX_OFFSET;
+            pIdxInfo->aConstraintUsage[iOffset].argvIndex = ++nArg;
+            pIdxInfo->aConstraintUsage[iOffset].omit = 1;
+        }
+    }
+    pIdxInfo->idxNum = nParse;
+    if (bRowid) {
+        pIdxInfo->estimatedCost = pTab->nIndex > 0 ? 10 : 400000;
+        pIdxInfo->estimatedRows = 1;
+        pIdxInfo->idxFlags = SQLITE_INDEX_SCAN_UNIQUE;
+    } else {
+        pIdxInfo->estimatedCost = pStr ? 800000 : 1000000;
+    }
+    return SQLITE_OK;
+}
+
+static sqlite3_module vsv_module = {
+    .xCreate = vsvtabCreate,
+    .xConnect = vsvtabConnect,
+    .xBestIndex = vsvtabBestIndex,
+    .xDisconnect = vsvtabDisconnect,
+    .xDestroy = vsvtabDisconnect,
+    .xOpen = vsvtabOpen,
+    .xClose = vsvtabClose,
+    .xFilter = vsvtabFilter,
+    .xNext = vsvtabNext,
+    .xEof = vsvtabEof,
+    .xColumn = vsvtabColumn,
+    .xRowid = vsvtabRowid,
+};
+
+/*
+** Bulk import.
+**
+**  select vsv_import(FILENAME, TABLE [, OPTIONS]);
+**
+** inserts the records of a VSV file into an existing table, in file
+** order, and returns the number of rows inserted.  Each record fills
+** the columns of the table from left to right.  Missing fields are
+** NULL and extra fields are ignored.  OPTIONS is a comma-separated list
+** of the fsep, rsep, header, skip and nulls parameters of the virtual
+** table, and of threads=N, the number of threads that parse the file.
+**
+** A mapped file is split into chunks that are parsed in parallel.  The
+** first record of a chunk is guessed to start after the first record
+** separator past the nominal start of the chunk, which is wrong if that
+** separator is inside a quoted field.  The records are inserted by a
+** single INSERT ... SELECT statement, which reads them through the
+** vsv_import_rows virtual table one chunk after the other.  When the
+** previous chunk did not end where the guess put the start of the next
+** one, the next chunk is parsed again from where it should start.
+*/
+
+#if !defined(VSV_IMPORT_CHUNK)
+#define VSV_IMPORT_CHUNK (1 << 20) /* Nominal size of a chunk in bytes */
+#endif
+#define VSV_IMPORT_MAX_THREADS 16  /* Upper limit for threads=N */
+#define VSV_IMPORT_POINTER "vsv_import"
+
+/*
+** The location of one field of an imported record: iOff bytes into the
+** input, or into the arena if bArena is set.  n is -1 for NULL.
+*/
+typedef struct VsvImportField {
+    size_t iOff; /* Offset of the field */
+    int n;       /* Length of the field in bytes, or -1 for NULL */
+    int bArena;  /* True if the field was unescaped into an arena */
+} VsvImportField;
+
+/*
+** A chunk of the input, parsed into the fields of its records
+*/
+typedef struct VsvChunk {
+    size_t iBegin;           /* Start of the first record */
+    size_t iEnd;             /* Records starting before this belong to the chunk */
+    size_t iStop;            /* Offset just past the last record */
+    VsvImportField* aField;  /* nCol fields for each record */
+    sqlite3_int64 nRow;      /* Number of records in aField */
+    sqlite3_int64 nRowAlloc; /* Number of records aField has room for */
+    VsvArena arena;          /* Unescaped fields */
+    int bReady;              /* True once parsed, until it has been read */
+    int rc;                  /* Result of parsing the chunk */
+} VsvChunk;
+
+/*
+** State of a vsv_import() call, shared with the worker threads
+*/
+typedef struct VsvImport {
+    VsvReader rdr;           /* Reads the records of an unmapped file */
+    const char* zIn;         /* The mapped file, if it is mapped */
+    size_t nIn;              /* Size of the mapped file in bytes */
+    size_t iStart;           /* Offset of the first record to import */
+    int fsep;                /* Field separator */
+    int rsep;                /* Record separator */
+    int nulls;               /* Empty unquoted fields are NULL */
+    int nCol;                /* Number of columns of the target table */
+    int nChunk;              /* Number of chunks in the mapped file */
+    int nSlot;               /* Number of chunks in flight */
+    VsvChunk* aSlot;         /* Chunk k is parsed into aSlot[k % nSlot] */
+    VsvChunk* pChunk;        /* The chunk being read, if any */
+    int iChunk;              /* Index of pChunk */
+    sqlite3_int64 iRow;      /* Next record to read from pChunk */
+    size_t iNext;            /* Where the next chunk has to start */
+    VsvImportField* aRow;    /* Fields of the current record */
+    const char* zRowArena;   /* Arena of the current record */
+    VsvImportField* aOne;    /* Record buffer for an unmapped file */
+    VsvArena arena;          /* Arena for an unmapped file */
+    sqlite3_int64 nRow;      /* Number of records read so far */
+#if defined(VSV_THREADS)
+    pthread_t aThread[VSV_IMPORT_MAX_THREADS]; /* Worker threads */
+    int nThread;             /* Number of running workers */
+    pthread_mutex_t mutex;   /* Protects the fields below and VsvChunk.bReady */
+    pthread_cond_t cond;     /* Signalled when any of them changes */
+    int iParse;              /* Next chunk for a worker to parse */
+    int iRead;               /* Number of chunks read so far */
+    int bStop;               /* Set to stop the workers */
+#endif
+} VsvImport;
+
+/*
+** Read one record into a[], which has room for p->nCol fields.  Escaped
+** fields are unescaped into pArena, the others are left in place.
+** Return 1 if a record was read, 0 at the end of input and -1 on OOM.
+*/
+static int vsv_import_record(VsvImport* p, VsvReader* pRdr, VsvImportField* a, VsvArena* pArena) {
+    int i = 0;
+    int j;
+    pRdr->iRow = pRdr->iIn;
+    do {
+        const char* z = vsv_read_one_field(pRdr);
+        if (pRdr->bNoMem) {
+            return -1;
+        }
+        if (z == 0 || i >= p->nCol) {
+            continue;
+        }
+        if (!pRdr->notNull && p->nulls) {
+            a[i].n = -1;
+        } else if (pRdr->bEscaped) {
+            int iOff = vsv_arena_unescape(pArena, z, pRdr->n, &a[i].n);
+            if (iOff < 0) {
+                return -1;
+            }
+            a[i].iOff = iOff;
+            a[i].bArena = 1;
+        } else {
+            /* the row moves when a stream refills its buffer */
+            a[i].iOff = pRdr->iSlice - pRdr->iRow;
+            a[i].n = pRdr->n;
+            a[i].bArena = 0;
+        }
+        i++;
+    } while (pRdr->cTerm == pRdr->fsep);
+    if (pRdr->cTerm == EOF && i == 0) {
+        return 0;
+    }
+    for (j = 0; j < i; j++) {
+        if (!a[j].bArena) {
+            a[j].iOff += pRdr->iRow;
+        }
+    }
+    while (i < p->nCol) {
+        a[i++].n = -1;
+    }
+    return 1;
+}
+
+#if defined(VSV_MMAP)
+/*
+** Return the nominal start of chunk k
+*/
+static size_t vsv_chunk_nominal(VsvImport* p, int k) {
+    if (k >= p->nChunk) {
+        return p->nIn;
+    }
+    return p->iStart + (size_t)k * VSV_IMPORT_CHUNK;
+}
+
+#if defined(VSV_THREADS)
+/*
+** Return the guessed start of chunk k: just past the first record
+** separator outside of quotes at or after its nominal start.
+**
+** A quote right after a separator and followed by field text can only
+** open a quoted field, so the number of quotes before the first such
+** quote tells whether the nominal start is inside a quoted field.  If
+** there is none in sight, the first record separator is taken.
+*/
+static size_t vsv_chunk_start(VsvImport* p, int k) {
+    const char* z = p->zIn;
+    size_t i0, i, iLimit;
+    int nQuote = 0;
+    int bQuoted = -1;
+    if (k == 0) {
+        return p->iStart;
+    }
+    if (k >= p->nChunk) {
+        return p->nIn;
+    }
+    i0 = vsv_chunk_nominal(p, k) - 1;
+    iLimit = p->nIn - i0 > VSV_IMPORT_CHUNK ? i0 + VSV_IMPORT_CHUNK : p->nIn;
+    for (i = i0; i < iLimit; i++) {
+        const char* zQuote = memchr(z + i, '"', iLimit - i);
+        char c;
+        if (zQuote == 0) {
+            break;
+        }
+        i = (size_t)(zQuote - z);
+        c = i + 1 < p->nIn ? z[i + 1] : p->rsep;
+        if (i > 0 && (z[i - 1] == p->fsep || z[i - 1] == p->rsep) && c != p->fsep &&
+            c != p->rsep && c != '"' && c != '\r' && c != '\n') {
+            bQuoted = nQuote & 1;
+            break;
+        }
+        nQuote++;
+    }
+    if (bQuoted < 0) {
+        const char* zSep = memchr(z + i0, p->rsep, p->nIn - i0);
+        return zSep ? (size_t)(zSep - z) + 1 : p->nIn;
+    }
+    for (i = i0; i < p->nIn; i++) {
+        if (z[i] == '"') {
+            bQuoted = !bQuoted;
+        } else if (z[i] == p->rsep && !bQuoted) {
+            return i + 1;
+        }
+    }
+    return p->nIn;
+}
+#endif
+
+/*
+** Parse the records of a chunk from pChunk->iBegin on
+*/
+static int vsv_chunk_parse(VsvImport* p, VsvChunk* pChunk) {
+    VsvReader rdr;
+    int rc = 1;
+    vsv_reader_init(&rdr);
+    rdr.fsep = p->fsep;
+    rdr.rsep = p->rsep;
+    rdr.bInPlace = 1;
+    rdr.bNotFirst = pChunk->iBegin > 0;
+    vsv_reader_open_memory(&rdr, p->zIn, p->nIn);
+    rdr.iIn = pChunk->iBegin;
+    pChunk->nRow = 0;
+    pChunk->arena.n = 0;
+    while (rdr.iIn < pChunk->iEnd) {
+        if (pChunk->nRow == pChunk->nRowAlloc) {
+            sqlite3_int64 nNew = pChunk->nRowAlloc * 2 + 256;
+            VsvImportField* aNew =
+                sqlite3_realloc64(pChunk->aField, nNew * p->nCol * sizeof(VsvImportField));
+            if (aNew == 0) {
+                rc = -1;
+                break;
+            }
+            pChunk->aField = aNew;
+            pChunk->nRowAlloc = nNew;
+        }
+        rc = vsv_import_record(p, &rdr, &pChunk->aField[pChunk->nRow * p->nCol],
+                               &pChunk->arena);
+        if (rc <= 0) {
+            break;
+        }
+        pChunk->nRow++;
+    }
+    pChunk->iStop = rdr.iIn;
+    vsv_reader_reset(&rdr);
+    return rc < 0 ? SQLITE_NOMEM : SQLITE_OK;
+}
+#endif
+
+#if defined(VSV_THREADS)
+/*
+** A worker thread: parse chunks in order while their slot is free
+*/
+static void* vsv_import_worker(void* pArg) {
+    VsvImport* p = (VsvImport*)pArg;
+    pthread_mutex_lock(&p->mutex);
+    while (!p->bStop && p->iParse < p->nChunk) {
+        int k = p->iParse;
+        VsvChunk* pChunk = &p->aSlot[k % p->nSlot];
+        if (k >= p->iRead + p->nSlot) {
+            pthread_cond_wait(&p->cond, &p->mutex);
+            continue;
+        }
+        p->iParse++;
+        pthread_mutex_unlock(&p->mutex);
+        pChunk->iBegin = vsv_chunk_start(p, k);
+        pChunk->iEnd = vsv_chunk_start(p, k + 1);
+        pChunk->rc = vsv_chunk_parse(p, pChunk);
+        pthread_mutex_lock(&p->mutex);
+        pChunk->bReady = 1;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->mutex);
+    return 0;
+}
+#endif
+
+/*
+** Return the number of worker threads to use by default
+*/
+static int vsv_import_default_threads(void) {
+#if defined(VSV_THREADS) && defined(_SC_NPROCESSORS_ONLN)
+    long n = sysconf(_SC_NPROCESSORS_ONLN) - 1;
+    return n < 0 ? 0 : n > VSV_IMPORT_MAX_THREADS ? VSV_IMPORT_MAX_THREADS : (int)n;
+#else
+    return 0;
+#endif
+}
+
+/*
+** Get ready to read the records of the input from the current position
+** of p->rdr on, with nThread worker threads parsing a mapped file
+*/
+static int vsv_import_start(VsvImport* p, int nThread) {
+#if defined(VSV_MMAP)
+    if (p->zIn) {
+        p->iStart = p->rdr.iIn;
+        p->iNext = p->iStart;
+        p->iChunk = -1;
+        p->nChunk = (int)((p->nIn - p->iStart + VSV_IMPORT_CHUNK - 1) / VSV_IMPORT_CHUNK);
+        p->nSlot = nThread > 0 ? nThread * 2 : 1;
+        p->aSlot = sqlite3_malloc64(p->nSlot * sizeof(VsvChunk));
+        if (p->aSlot == 0) {
+            return SQLITE_NOMEM;
+        }
+        memset(p->aSlot, 0, p->nSlot * sizeof(VsvChunk));
+    }
+#endif
+#if defined(VSV_THREADS)
+    if (p->zIn && nThread > 0) {
+        pthread_mutex_init(&p->mutex, 0);
+        pthread_cond_init(&p->cond, 0);
+        while (p->nThread < nThread &&
+               pthread_create(&p->aThread[p->nThread], 0, vsv_import_worker, p) == 0) {
+            p->nThread++;
+        }
+    }
+#endif
+    return SQLITE_OK;
+}
+
+/*
+** Stop the workers and free the resources of an import
+*/
+static void vsv_import_finish(VsvImport* p) {
+    int k;
+#if defined(VSV_THREADS)
+    if (p->nThread > 0) {
+        pthread_mutex_lock(&p->mutex);
+        p->bStop = 1;
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->mutex);
+        while (p->nThread > 0) {
+            pthread_join(p->aThread[--p->nThread], 0);
+        }
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->mutex);
+    }
+#endif
+    for (k = 0; p->aSlot && k < p->nSlot; k++) {
+        sqlite3_free(p->aSlot[k].aField);
+        sqlite3_free(p->aSlot[k].arena.z);
+    }
+    sqlite3_free(p->aSlot);
+    sqlite3_free(p->aOne);
+    sqlite3_free(p->arena.z);
+#if defined(VSV_MMAP)
+    vsv_munmap((char*)p->zIn, p->nIn);
+#endif
+    vsv_reader_reset(&p->rdr);
+}
+
+/*
+** Move to the next record of the input.
+** Return SQLITE_OK, SQLITE_DONE at the end of input or an error code.
+*/
+static int vsv_import_next(VsvImport* p) {
+#if defined(VSV_MMAP)
+    while (p->zIn && (p->pChunk == 0 || p->iRow >= p->pChunk->nRow)) {
+        VsvChunk* pChunk = p->pChunk;
+#if defined(VSV_THREADS)
+        if (pChunk && p->nThread > 0) {
+            /* hand the slot of the chunk back to the workers */
+            pthread_mutex_lock(&p->mutex);
+            pChunk->bReady = 0;
+            p->iRead = p->iChunk + 1;
+            pthread_cond_broadcast(&p->cond);
+            pthread_mutex_unlock(&p->mutex);
+        }
+#endif
+        p->pChunk = 0;
+        if (++p->iChunk >= p->nChunk) {
+            return SQLITE_DONE;
+        }
+        pChunk = &p->aSlot[p->iChunk % p->nSlot];
+#if defined(VSV_THREADS)
+        if (p->nThread > 0) {
+            pthread_mutex_lock(&p->mutex);
+            while (!pChunk->bReady) {
+                pthread_cond_wait(&p->cond, &p->mutex);
+            }
+            pthread_mutex_unlock(&p->mutex);
+        } else
+#endif
+        {
+            /* parsed one after the other, chunks need no guessing */
+            pChunk->iBegin = p->iNext;
+            pChunk->iEnd = vsv_chunk_nominal(p, p->iChunk + 1);
+            pChunk->rc = vsv_chunk_parse(p, pChunk);
+        }
+        if (pChunk->rc == SQLITE_OK && pChunk->iBegin != p->iNext) {
+            /* the guessed start of the chunk is inside a quoted field */
+            pChunk->iBegin = p->iNext;
+            pChunk->rc = vsv_chunk_parse(p, pChunk);
+        }
+        if (pChunk->rc != SQLITE_OK) {
+            return pChunk->rc;
+        }
+        p->pChunk = pChunk;
+        p->iRow = 0;
+        p->iNext = pChunk->iStop;
+    }
+    if (p->zIn) {
+        p->aRow = &p->pChunk->aField[p->iRow * p->nCol];
+        p->zRowArena = p->pChunk->arena.z;
+        p->iRow++;
+        p->nRow++;
+        return SQLITE_OK;
+    }
+#endif
+    {
+        int rc;
+        p->arena.n = 0;
+        rc = vsv_import_record(p, &p->rdr, p->aOne, &p->arena);
+        if (rc <= 0) {
+            return rc < 0 ? SQLITE_NOMEM : p->rdr.bError ? SQLITE_ERROR : SQLITE_DONE;
+        }
+        p->aRow = p->aOne;
+        p->zRowArena = p->arena.z;
+        p->nRow++;
+        return SQLITE_OK;
+    }
+}
+
+/*
+** The vsv_import_rows virtual table
+*/
+typedef struct VsvImportTable {
+    sqlite3_vtab base; /* Base class.  Must be first */
+    int iImport;       /* Index of the hidden column */
+} VsvImportTable;
+
+/*
+** A cursor for the vsv_import_rows virtual table
+*/
+typedef struct VsvImportCursor {
+    sqlite3_vtab_cursor base; /* Base class.  Must be first */
+    VsvImport* p;             /* The import being read, if any */
+    int bEof;                 /* True at the end of input */
+} VsvImportCursor;
+
+/*
+** vsv_import_rows has one column for each column a table may have,
+** and a hidden column that takes the VsvImport pointer
+*/
+static int vsvimportConnect(sqlite3* db,
+                            void* pAux,
+                            int argc,
+                            const char* const* argv,
+                            sqlite3_vtab** ppVtab,
+                            char** pzErr) {
+    VsvImportTable* pNew;
+    sqlite3_str* pStr = sqlite3_str_new(db);
+    char* zSchema;
+    int nCol = sqlite3_limit(db, SQLITE_LIMIT_COLUMN, -1) - 1;
+    int i, rc;
+    sqlite3_str_appendall(pStr, "CREATE TABLE x(");
+    for (i = 0; i < nCol; i++) {
+        sqlite3_str_appendf(pStr, "c%d,", i);
+    }
+    sqlite3_str_appendall(pStr, "import HIDDEN)");
+    zSchema = sqlite3_str_finish(pStr);
+    if (zSchema == 0) {
+        return SQLITE_NOMEM;
+    }
+    rc = sqlite3_declare_vtab(db, zSchema);
+    sqlite3_free(zSchema);
+    if (rc != SQLITE_OK) {
+        return rc;
+    }
+    pNew = sqlite3_malloc(sizeof(*pNew));
+    *ppVtab = (sqlite3_vtab*)pNew;
+    if (pNew == 0) {
+        return SQLITE_NOMEM;
+    }
+    memset(pNew, 0, sizeof(*pNew));
+    pNew->iImport = nCol;
+    sqlite3_vtab_config(db, SQLITE_VTAB_DIRECTONLY);
+    return SQLITE_OK;
+}
+
+static int vsvimportDisconnect(sqlite3_vtab* pVtab) {
+    sqlite3_free(pVtab);
+    return SQLITE_OK;
+}
+
+static int vsvimportOpen(sqlite3_vtab* pVtab, sqlite3_vtab_cursor** ppCursor) {
+    VsvImportCursor* pCur = sqlite3_malloc(sizeof(*pCur));
+    if (pCur == 0) {
+        return SQLITE_NOMEM;
+    }
+    memset(pCur, 0, sizeof(*pCur));
+    *ppCursor = &pCur->base;
+    return SQLITE_OK;
+}
+
+static int vsvimportClose(sqlite3_vtab_cursor* cur) {
+    sqlite3_free(cur);
+    return SQLITE_OK;
+}
+
+static int vsvimportNext(sqlite3_vtab_cursor* cur) {
+    VsvImportCursor* pCur = (VsvImportCursor*)cur;
+    int rc = vsv_import_next(pCur->p);
+    if (rc == SQLITE_DONE) {
+        pCur->bEof = 1;
+        return SQLITE_OK;
+    }
+    return rc;
+}
+
+static int vsvimportFilter(sqlite3_vtab_cursor* cur,
+                           int idxNum,
+                           const char* idxStr,
+                           int argc,
+                           sqlite3_value** argv) {
+    VsvImportCursor* pCur = (VsvImportCursor*)cur;
+    pCur->p = argc > 0 ? sqlite3_value_pointer(argv[0], VSV_IMPORT_POINTER) : 0;
+    pCur->bEof = 1;
+    if (pCur->p == 0) {
+        return SQLITE_OK;
+    }
+    pCur->bEof = 0;
+    return vsvimportNext(cur);
+}
+
+static int vsvimportEof(sqlite3_vtab_cursor* cur) {
+    return ((VsvImportCursor*)cur)->bEof;
+}
+
+/*
+** Fields are handed to SQLite straight from the input or the arena
+*/
+static int vsvimportColumn(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int i) {
+    VsvImport* p = ((VsvImportCursor*)cur)->p;
+    const VsvImportField* pField;
+    if (i >= p->nCol || p->aRow[i].n < 0) {
+        return SQLITE_OK;
+    }
+    pField = &p->aRow[i];
+    sqlite3_result_text(ctx, (pField->bArena ? p->zRowArena : p->rdr.zIn) + pField->iOff,
+                        pField->n, SQLITE_STATIC);
+    return SQLITE_OK;
+}
+
+static int vsvimportRowid(sqlite3_vtab_cursor* cur, sqlite_int64* pRowid) {
+    *pRowid = ((VsvImportCursor*)cur)->p->nRow;
+    return SQLITE_OK;
+}
+
+/*
+** The only plan reads the import given to the hidden column
+*/
+static int vsvimportBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo) {
+    int iImport = ((VsvImportTable*)tab)->iImport;
+    int i;
+    for (i = 0; i < pIdxInfo->nConstraint; i++) {
+        const struct sqlite3_index_constraint* pCons = &pIdxInfo->aConstraint[i];
+        if (pCons->usable && pCons->op == SQLITE_INDEX_CONSTRAINT_EQ &&
+            pCons->iColumn == iImport) {
+            pIdxInfo->aConstraintUsage[i].argvIndex = 1;
+            pIdxInfo->aConstraintUsage[i].omit = 1;
+        }
+    }
+    pIdxInfo->estimatedCost = 1000000;
+    return SQLITE_OK;
+}
+
+static sqlite3_module vsv_import_module = {
+    .xConnect = vsvimportConnect,
+    .xBestIndex = vsvimportBestIndex,
+    .xDisconnect = vsvimportDisconnect,
+    .xOpen = vsvimportOpen,
+    .xClose = vsvimportClose,
+    .xFilter = vsvimportFilter,
+    .xNext = vsvimportNext,
+    .xEof = vsvimportEof,
+    .xColumn = vsvimportColumn,
+    .xRowid = vsvimportRowid,
+};
+
+/*
+** Parse one comma-separated option of vsv_import() or vsv_infer().
+** Options with a null output pointer are not accepted.
+** Return 0 on success, or 1 with an error message in pRdr->zErr.
+*/
+static int vsv_import_option(VsvReader* pRdr,
+                             const char* z,
+                             char** pzFsep,
+                             char** pzRsep,
+                             char** pzDsep,
+                             int* pbHeader,
+                             int* pnSkip,
+                             int* pbNulls,
+                             int* pnThread) {
+    const char* zValue;
+    int b;
+    if (vsv_string_parameter(pRdr, "fsep", z, pzFsep) ||
+        vsv_string_parameter(pRdr, "rsep", z, pzRsep) ||
+        (pzDsep && vsv_string_parameter(pRdr, "dsep", z, pzDsep))) {
+        return pRdr->zErr[0] != 0;
+    } else if (vsv_boolean_parameter("header", 6, z, &b)) {
+        *pbHeader = b;
+    } else if (pbNulls && vsv_boolean_parameter("nulls", 5, z, &b)) {
+        *pbNulls = b;
+    } else if (pnSkip && (zValue = vsv_parameter("skip", 4, z)) != 0) {
+        *pnSkip = atoi(zValue);
+        if (*pnSkip <= 0) {
+            vsv_errmsg(pRdr, "skip= value must be positive");
+            return 1;
+        }
+    } else if (pnThread && (zValue = vsv_parameter("threads", 7, z)) != 0) {
+        *pnThread = atoi(zValue);
+        if (*pnThread < 0) {
+            vsv_errmsg(pRdr, "threads= value must not be negative");
+            return 1;
+        }
+        if (*pnThread > VSV_IMPORT_MAX_THREADS) {
+            *pnThread = VSV_IMPORT_MAX_THREADS;
+        }
+    } else if (vsv_skip_whitespace(z)[0] != 0) {
+        vsv_errmsg(pRdr, "bad parameter: '%s'", z);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+** Split the options of vsv_import() or vsv_infer() at commas outside of
+** quotes, and parse each one with vsv_import_option().  zOptions is
+** modified in place.  Return 0 on success, or 1 with an error message
+** in pRdr->zErr.
+*/
+static int vsv_import_options(VsvReader* pRdr,
+                              char* zOptions,
+                              char** pzFsep,
+                              char** pzRsep,
+                              char** pzDsep,
+                              int* pbHeader,
+                              int* pnSkip,
+                              int* pbNulls,
+                              int* pnThread) {
+    char* z;
+    char* zOpt;
+    char cQuote = 0;
+    for (z = zOpt = zOptions;; z++) {
+        if (cQuote) {
+            if (*z == cQuote) {
+                cQuote = 0;
+            }
+            if (*z) {
+                continue;
+            }
+        } else if (*z == '\'' || *z == '"') {
+            cQuote = *z;
+            continue;
+        }
+        if (*z == ',' || *z == 0) {
+            char c = *z;
+            *z = 0;
+            if (vsv_import_option(pRdr, zOpt, pzFsep, pzRsep, pzDsep, pbHeader, pnSkip, pbNulls,
+                                  pnThread)) {
+                return 1;
+            }
+            if (c == 0) {
+                return 0;
+            }
+            zOpt = z + 1;
+        }
+    }
+}
+
+/*
+** Insert the records of a VSV file into a table.
+** vsv_import(filename, table [, options])
+*/
+static void vsv_import(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    sqlite3* db = sqlite3_context_db_handle(ctx);
+    const char* zFilename = (const char*)sqlite3_value_text(argv[0]);
+    const char* zTable = (const char*)sqlite3_value_text(argv[1]);
+    char* zOptions = 0;
+    char* zFsep = 0;
+    char* zRsep = 0;
+    char* zSql = 0;
+    char* zErr;
+    int bHeader = 0;
+    int nSkip = 0;
+    int nThread = -1;
+    sqlite3_stmt* pStmt = 0;
+    VsvImport* p;
+    int rc = SQLITE_OK;
+    int i;
+
+    if (zFilename == 0 || zTable == 0) {
+        sqlite3_result_error(ctx, "vsv_import: filename and table are required", -1);
+        return;
+    }
+    p = sqlite3_malloc(sizeof(*p));
+    if (p == 0) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    memset(p, 0, sizeof(*p));
+    vsv_reader_init(&p->rdr);
+
+    if (argc > 2 && sqlite3_value_type(argv[2]) != SQLITE_NULL) {
+        zOptions = sqlite3_mprintf("%s", sqlite3_value_text(argv[2]));
+        if (zOptions == 0) {
+            goto vsv_import_oom;
+        }
+        if (vsv_import_options(&p->rdr, zOptions, &zFsep, &zRsep, 0, &bHeader, &nSkip, &p->nulls,
+                               &nThread)) {
+            goto vsv_import_error;
+        }
+    }
+    if (vsv_parse_sep_char(zFsep, ',', &p->fsep)) {
+        vsv_errmsg(&p->rdr, "cannot parse fsep: '%s'", zFsep);
+        goto vsv_import_error;
+    }
+    if (vsv_parse_sep_char(zRsep, '\n', &p->rsep)) {
+        vsv_errmsg(&p->rdr, "cannot parse rsep: '%s'", zRsep);
+        goto vsv_import_error;
+    }
+    if (nThread < 0) {
+        nThread = vsv_import_default_threads();
+    }
+    if (!sqlite3_threadsafe()) {
+        nThread = 0;
+    }
+
+    /* one result column for each column of the table */
+    zSql = sqlite3_mprintf("SELECT * FROM \"%w\"", zTable);
+    if (zSql == 0) {
+        goto vsv_import_oom;
+    }
+    rc = sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0);
+    sqlite3_free(zSql);
+    if (rc != SQLITE_OK) {
+        goto vsv_import_sqlite_error;
+    }
+    p->nCol = sqlite3_column_count(pStmt);
+    sqlite3_finalize(pStmt);
+    pStmt = 0;
+    {
+        sqlite3_str* pStr = sqlite3_str_new(db);
+        sqlite3_str_appendf(pStr, "INSERT INTO \"%w\" SELECT ", zTable);
+        for (i = 0; i < p->nCol; i++) {
+            sqlite3_str_appendf(pStr, "%sc%d", i > 0 ? "," : "", i);
+        }
+        sqlite3_str_appendall(pStr, " FROM vsv_import_rows(?)");
+        zSql = sqlite3_str_finish(pStr);
+    }
+    if (zSql == 0) {
+        goto vsv_import_oom;
+    }
+    rc = sqlite3_prepare_v2(db, zSql, -1, &pStmt, 0);
+    sqlite3_free(zSql);
+    if (rc != SQLITE_OK) {
+        goto vsv_import_sqlite_error;
+    }
+
+    /* read the file in place, from a mapping if possible */
+    p->rdr.fsep = p->fsep;
+    p->rdr.rsep = p->rsep;
+    p->rdr.bInPlace = 1;
+#if defined(VSV_MMAP)
+    {
+        struct stat st;
+        char* zMap;
+        if (stat(zFilename, &st) == 0 && S_ISREG(st.st_mode) &&
+            (sqlite3_uint64)st.st_size <= (size_t)-1 &&
+            vsv_mmap(zFilename, (size_t)st.st_size, &zMap) == 0) {
+            p->zIn = zMap;
+            p->nIn = (size_t)st.st_size;
+            vsv_reader_open_memory(&p->rdr, p->zIn, p->nIn);
+        }
+    }
+#endif
+    if (p->zIn == 0 && vsv_reader_open(&p->rdr, zFilename, 0, VSV_INBUFSZ)) {
+        goto vsv_import_error;
+    }
+    p->aOne = sqlite3_malloc64(p->nCol * sizeof(VsvImportField));
+    if (p->aOne == 0) {
+        goto vsv_import_oom;
+    }
+    for (i = nSkip + bHeader; i > 0; i--) {
+        int got = vsv_import_record(p, &p->rdr, p->aOne, &p->arena);
+        if (got < 0) {
+            goto vsv_import_oom;
+        }
+        if (got == 0) {
+            break;
+        }
+    }
+    if (vsv_import_start(p, nThread) != SQLITE_OK) {
+        goto vsv_import_oom;
+    }
+
+    sqlite3_bind_pointer(pStmt, 1, p, VSV_IMPORT_POINTER, 0);
+    rc = sqlite3_step(pStmt);
+    if (rc != SQLITE_DONE) {
+        if (p->rdr.bError) {
+            goto vsv_import_error;
+        }
+        goto vsv_import_sqlite_error;
+    }
+    sqlite3_result_int64(ctx, p->nRow);
+    goto vsv_import_done;
+
+vsv_import_sqlite_error:
+    vsv_errmsg(&p->rdr, "%s", sqlite3_errmsg(db));
+    goto vsv_import_error;
+
+vsv_import_oom:
+    vsv_errmsg(&p->rdr, "out of memory");
+
+vsv_import_error:
+    zErr = sqlite3_mprintf("vsv_import: %s", p->rdr.zErr);
+    if (zErr) {
+        sqlite3_result_error(ctx, zErr, -1);
+        sqlite3_free(zErr);
+    } else {
+        sqlite3_result_error_nomem(ctx);
+    }
+
+vsv_import_done:
+    sqlite3_finalize(pStmt);
+    vsv_import_finish(p);
+    sqlite3_free(p);
+    sqlite3_free(zOptions);
+    sqlite3_free(zFsep);
+    sqlite3_free(zRsep);
+}
+
+/*
+** Return a CREATE TABLE statement for a VSV file, with the type of each
+** column inferred from the first sample_rows records.
+** vsv_infer(filename, sample_rows [, options])
+*/
+static void vsv_infer(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    const char* zFilename = (const char*)sqlite3_value_text(argv[0]);
+    sqlite3_int64 nSample = sqlite3_value_int64(argv[1]);
+    VsvReader rdr;
+    char* zOptions = 0;
+    char* zFsep = 0;
+    char* zRsep = 0;
+    char* zDsep = 0;
+    char* zSchema = 0;
+    char* zErr;
+    int* aAffinity = 0;
+    int bHeader = 0;
+    int nSkip = 0;
+    int nCol = 0;
+
+    memset(&rdr, 0, sizeof(rdr));
+    if (zFilename == 0 || nSample <= 0) {
+        sqlite3_result_error(ctx, "vsv_infer: filename and a positive sample_rows are required",
+                             -1);
+        return;
+    }
+    if (argc > 2 && sqlite3_value_type(argv[2]) != SQLITE_NULL) {
+        zOptions = sqlite3_mprintf("%s", sqlite3_value_text(argv[2]));
+        if (zOptions == 0) {
+            vsv_errmsg(&rdr, "out of memory");
+            goto vsv_infer_error;
+        }
+        if (vsv_import_options(&rdr, zOptions, &zFsep, &zRsep, &zDsep, &bHeader, &nSkip, 0, 0)) {
+            goto vsv_infer_error;
+        }
+    }
+    if (vsv_parse_sep_char(zFsep, ',', &rdr.fsep)) {
+        vsv_errmsg(&rdr, "cannot parse fsep: '%s'", zFsep);
+        goto vsv_infer_error;
+    }
+    if (vsv_parse_sep_char(zRsep, '\n', &rdr.rsep)) {
+        vsv_errmsg(&rdr, "cannot parse rsep: '%s'", zRsep);
+        goto vsv_infer_error;
+    }
+    if (vsv_parse_sep_char(zDsep, '.', &rdr.dsep)) {
+        vsv_errmsg(&rdr, "cannot parse dsep: '%s'", zDsep);
+        goto vsv_infer_error;
+    }
+    zSchema = vsv_infer_schema(&rdr, zFilename, 0, VSV_INBUFSZ, bHeader, nSkip,
+                               nSample > 0x7fffffff ? 0x7fffffff : (int)nSample, &nCol, &aAffinity);
+    if (zSchema) {
+        sqlite3_result_text(ctx, zSchema, -1, sqlite3_free);
+        goto vsv_infer_done;
+    }
+
+vsv_infer_error:
+    zErr = sqlite3_mprintf("vsv_infer: %s", rdr.zErr);
+    if (zErr) {
+        sqlite3_result_error(ctx, zErr, -1);
+        sqlite3_free(zErr);
+    } else {
+        sqlite3_result_error_nomem(ctx);
+    }
+
+vsv_infer_done:
+    vsv_reader_reset(&rdr);
+    sqlite3_free(aAffinity);
+    sqlite3_free(zOptions);
+    sqlite3_free(zFsep);
+    sqlite3_free(zRsep);
+    sqlite3_free(zDsep);
+}
+
+/*
+** Export.
+**
+**  select vsv_export(FILENAME, QUERY [, OPTIONS]);
+**
+** runs a read-only query and writes its rows to a VSV file, replacing
+** the file, and returns the number of rows written.  OPTIONS is a
+** comma-separated list of the fsep, rsep, dsep and header parameters
+** of the virtual table.  header writes the names of the result columns
+** first.
+**
+** Fields are quoted the way VsvReader expects, so the virtual table
+** reads back what was written: a field is quoted if it contains a
+** separator, a quote or a carriage return, and quotes in it are doubled.
+** NULL is written as nothing and an empty string as "", so nulls=yes
+** tells the two apart.  Reals are written with as many digits as they
+** need to read back the same.
+**
+** Rows are formatted into a large buffer, which is written to the file
+** whenever it fills up, so the whole result is written in one pass.
+*/
+
+#if !defined(VSV_EXPORT_BUFSZ)
+#define VSV_EXPORT_BUFSZ (1024 * 1024) /* Size of the output buffer in bytes */
+#endif
+
+typedef struct VsvWriter {
+    FILE* out;  /* Write the VSV text to this output stream */
+    char* z;    /* Output buffer of VSV_EXPORT_BUFSZ bytes */
+    size_t n;   /* Bytes used in z */
+    int fsep;   /* Field separator */
+    int rsep;   /* Record separator */
+    int dsep;   /* Decimal separator of reals */
+    int bError; /* True if a write failed */
+} VsvWriter;
+
+/*
+** Write the output buffer of a VsvWriter to its file
+*/
+static void vsv_writer_flush(VsvWriter* p) {
+    if (p->n > 0 && !p->bError && fwrite(p->z, 1, p->n, p->out) != p->n) {
+        p->bError = 1;
+    }
+    p->n = 0;
+}
+
+/*
+** Append n bytes to the output of a VsvWriter
+*/
+static void vsv_write(VsvWriter* p, const char* z, size_t n) {
+    if (p->n + n > VSV_EXPORT_BUFSZ) {
+        vsv_writer_flush(p);
+        if (n > VSV_EXPORT_BUFSZ) {
+            if (!p->bError && fwrite(z, 1, n, p->out) != n) {
+                p->bError = 1;
+            }
+            return;
+        }
+    }
+    memcpy(p->z + p->n, z, n);
+    p->n += n;
+}
+
+/*
+** Append one character to the output of a VsvWriter
+*/
+static void vsv_write_char(VsvWriter* p, int c) {
+    if (p->n == VSV_EXPORT_BUFSZ) {
+        vsv_writer_flush(p);
+    }
+    p->z[p->n++] = (char)c;
+}
+
+/*
+** Append the n-byte field in z, quoted if VsvReader would not read it
+** back as it is otherwise
+*/
+static void vsv_write_field(VsvWriter* p, const char* z, size_t n) {
+    const char* zQuote;
+    if (n == 0) {
+        vsv_write(p, "\"\"", 2);
+        return;
+    }
+    if (vsv_scan(z, n, (char)p->fsep, (char)p->rsep, '"') == n && memchr(z, '\r', n) == 0) {
+        vsv_write(p, z, n);
+        return;
+    }
+    vsv_write_char(p, '"');
+    while ((zQuote = memchr(z, '"', n)) != 0) {
+        size_t k = zQuote - z + 1;
+        vsv_write(p, z, k);
+        vsv_write_char(p, '"');
+        z += k;
+        n -= k;
+    }
+    vsv_write(p, z, n);
+    vsv_write_char(p, '"');
+}
+
+/*
+** Append column i of the current row of pStmt
+*/
+static void vsv_write_column(VsvWriter* p, sqlite3_stmt* pStmt, int i) {
+    char zBuf[32];
+    switch (sqlite3_column_type(pStmt, i)) {
+        case SQLITE_NULL:
+            break;
+        case SQLITE_INTEGER:
+            sqlite3_snprintf(sizeof(zBuf), zBuf, "%lld", sqlite3_column_int64(pStmt, i));
+            vsv_write_field(p, zBuf, strlen(zBuf));
+            break;
+        case SQLITE_FLOAT: {
+            double r = sqlite3_column_double(pStmt, i);
+            char* zSep;
+            sqlite3_snprintf(sizeof(zBuf), zBuf, "%!.15g", r);
+            if (strtod(zBuf, 0) != r) {
+                sqlite3_snprintf(sizeof(zBuf), zBuf, "%!.17g", r);
+            }
+            if (p->dsep != '.' && (zSep = strchr(zBuf, '.')) != 0) {
+                *zSep = (char)p->dsep;
+            }
+            vsv_write_field(p, zBuf, strlen(zBuf));
+            break;
+        }
+        case SQLITE_BLOB:
+            vsv_write_field(p, sqlite3_column_blob(pStmt, i), sqlite3_column_bytes(pStmt, i));
+            break;
+        default:
+            vsv_write_field(p, (const char*)sqlite3_column_text(pStmt, i),
+                            sqlite3_column_bytes(pStmt, i));
+            break;
+    }
+}
+
+/*
+** Write the result of a query to a VSV file.
+** vsv_export(filename, query [, options])
+*/
+static void vsv_export(sqlite3_context* ctx, int argc, sqlite3_value** argv) {
+    sqlite3* db = sqlite3_context_db_handle(ctx);
+    const char* zFilename = (const char*)sqlite3_value_text(argv[0]);
+    const char* zQuery = (const char*)sqlite3_value_text(argv[1]);
+    const char* zTail = 0;
+    VsvReader rdr; /* Holds the error message */
+    VsvWriter w;
+    char* zOptions = 0;
+    char* zFsep = 0;
+    char* zRsep = 0;
+    char* zDsep = 0;
+    char* zErr;
+    int bHeader = 0;
+    sqlite3_int64 nRow = 0;
+    sqlite3_stmt* pStmt = 0;
+    int rc, i, nCol;
+
+    memset(&rdr, 0, sizeof(rdr));
+    memset(&w, 0, sizeof(w));
+    if (zFilename == 0 || zQuery == 0) {
+        sqlite3_result_error(ctx, "vsv_export: filename and query are required", -1);
+        return;
+    }
+    if (argc > 2 && sqlite3_value_type(argv[2]) != SQLITE_NULL) {
+        zOptions = sqlite3_mprintf("%s", sqlite3_value_text(argv[2]));
+        if (zOptions == 0) {
+            goto vsv_export_oom;
+        }
+        if (vsv_import_options(&rdr, zOptions, &zFsep, &zRsep, &zDsep, &bHeader, 0, 0, 0)) {
+            goto vsv_export_error;
+        }
+    }
+    if (vsv_parse_sep_char(zFsep, ',', &w.fsep)) {
+        vsv_errmsg(&rdr, "cannot parse fsep: '%s'", zFsep);
+        goto vsv_export_error;
+    }
+    if (vsv_parse_sep_char(zRsep, '\n', &w.rsep)) {
+        vsv_errmsg(&rdr, "cannot parse rsep: '%s'", zRsep);
+        goto vsv_export_error;
+    }
+    if (vsv_parse_sep_char(zDsep, '.', &w.dsep)) {
+        vsv_errmsg(&rdr, "cannot parse dsep: '%s'", zDsep);
+        goto vsv_export_error;
+    }
+
+    rc = sqlite3_prepare_v2(db, zQuery, -1, &pStmt, &zTail);
+    if (rc != SQLITE_OK) {
+        goto vsv_export_sqlite_error;
+    }
+    if (pStmt == 0 || vsv_skip_whitespace(zTail)[0] != 0) {
+        vsv_errmsg(&rdr, "query must be a single statement");
+        goto vsv_export_error;
+    }
+    if (!sqlite3_stmt_readonly(pStmt)) {
+        vsv_errmsg(&rdr, "query must be read-only");
+        goto vsv_export_error;
+    }
+    nCol = sqlite3_column_count(pStmt);
+
+    w.z = sqlite3_malloc64(VSV_EXPORT_BUFSZ);
+    if (w.z == 0) {
+        goto vsv_export_oom;
+    }
+    w.out = fopen(zFilename, "wb");
+    if (w.out == 0) {
+        vsv_errmsg(&rdr, "cannot open '%s' for writing", zFilename);
+        goto vsv_export_error;
+    }
+    setvbuf(w.out, 0, _IONBF, 0);
+    if (bHeader) {
+        for (i = 0; i < nCol; i++) {
+            const char* zName = sqlite3_column_name(pStmt, i);
+            if (zName == 0) {
+                goto vsv_export_oom;
+            }
+            if (i > 0) {
+                vsv_write_char(&w, w.fsep);
+            }
+            vsv_write_field(&w, zName, strlen(zName));
+        }
+        vsv_write_char(&w, w.rsep);
+    }
+    while ((rc = sqlite3_step(pStmt)) == SQLITE_ROW) {
+        for (i = 0; i < nCol; i++) {
+            if (i > 0) {
+                vsv_write_char(&w, w.fsep);
+            }
+            vsv_write_column(&w, pStmt, i);
+        }
+        vsv_write_char(&w, w.rsep);
+        nRow++;
+    }
+    if (rc != SQLITE_DONE) {
+        goto vsv_export_sqlite_error;
+    }
+    vsv_writer_flush(&w);
+    rc = fclose(w.out);
+    w.out = 0;
+    if (rc != 0 || w.bError) {
+        vsv_errmsg(&rdr, "cannot write to '%s'", zFilename);
+        goto vsv_export_error;
+    }
+    sqlite3_result_int64(ctx, nRow);
+    goto vsv_export_done;
+
+vsv_export_sqlite_error:
+    vsv_errmsg(&rdr, "%s", sqlite3_errmsg(db));
+    goto vsv_export_error;
+
+vsv_export_oom:
+    vsv_errmsg(&rdr, "out of memory");
+
+vsv_export_error:
+    zErr = sqlite3_mprintf("vsv_export: %s", rdr.zErr);
+    if (zErr) {
+        sqlite3_result_error(ctx, zErr, -1);
+        sqlite3_free(zErr);
+    } else {
+        sqlite3_result_error_nomem(ctx);
+    }
+    if (w.out) {
+        /* do not leave a partial file behind */
+        fclose(w.out);
+        remove(zFilename);
+    }
+
+vsv_export_done:
+    sqlite3_finalize(pStmt);
+    sqlite3_free(w.z);
+    sqlite3_free(zOptions);
+    sqlite3_free(zFsep);
+    sqlite3_free(zRsep);
+    sqlite3_free(zDsep);
+}
 
 int vsv_init(sqlite3* db) {
     sqlite3_create_module(db, "vsv", &vsv_module, 0);
+    sqlite3_create_module(db, "vsv_import_rows", &vsv_import_module, 0);
+    sqlite3_create_function(db, "vsv_import", 2, SQLITE_UTF8 | SQLITE_DIRECTONLY, 0, vsv_import, 0,
+                            0);
+    sqlite3_create_function(db, "vsv_import", 3, SQLITE_UTF8 | SQLITE_DIRECTONLY, 0, vsv_import, 0,
+                            0);
+    sqlite3_create_function(db, "vsv_infer", 2, SQLITE_UTF8 | SQLITE_DIRECTONLY, 0, vsv_infer, 0, 0);
+    sqlite3_create_function(db, "vsv_infer", 3, SQLITE_UTF8 | SQLITE_DIRECTONLY, 0, vsv_infer, 0, 0);
+    sqlite3_create_function(db, "vsv_export", 2, SQLITE_UTF8 | SQLITE_DIRECTONLY, 0, vsv_export, 0,
+                            0);
+    sqlite3_create_function(db, "vsv_export", 3, SQLITE_UTF8 | SQLITE_DIRECTONLY, 0, vsv_export, 0,
+                            0);
     return SQLITE_OK;
 }
@@ -29,7 +29,134 @@ select '3_01', stats_var(value) = 825 from stats_seq(1, 99);
 select '3_02', stats_var_samp(value) = 825 from stats_seq(1, 99);
 select '3_03', round(stats_var_pop(value), 0) = 817 from stats_seq(1, 99);
 
+select '3_04', json_extract(stats_summary(value), '$.count') = 99 from stats_seq(1, 99);
+select '3_05', json_extract(stats_summary(value), '$.mean') = 50 from stats_seq(1, 99);
+select '3_06', json_extract(stats_summary(value), '$.min') = 1 from stats_seq(1, 99);
+select '3_07', json_extract(stats_summary(value), '$.max') = 99 from stats_seq(1, 99);
+select '3_08', json_extract(stats_summary(value), '$.var') = 825 from stats_seq(1, 99);
+select '3_09', round(json_extract(stats_summary(value), '$.stddev'), 1) = 28.7 from stats_seq(1, 99);
+select '3_10', json_extract(stats_summary(value), '$.skewness') = 0 from stats_seq(1, 99);
+select '3_11', round(json_extract(stats_summary(value), '$.kurtosis'), 4) = -1.2002 from stats_seq(1, 99);
+select '3_12', round(json_extract(stats_summary(value*value), '$.skewness'), 4) = 0.6383 from stats_seq(1, 1000);
+select '3_13', json_extract(stats_summary(value), '$.kurtosis') is null from stats_seq(1, 1);
+select '3_14', stats_summary(null) is null;
+
 select '4_01', (count(*), min(value), max(value)) = (99, 1, 99) from stats_seq(1, 99);
 select '4_02', (count(*), min(value), max(value)) = (20, 0, 95) from stats_seq(0, 99, 5);
 with tmp as (select * from stats_seq(20) limit 10)
 select '4_03', (count(*), min(value), max(value)) = (10, 20, 29) from tmp;
+
+select '5_01', count_distinct_approx(value) = 100 from stats_seq(1, 100);
+select '5_02', count_distinct_approx(value) between 98000 and 102000 from stats_seq(1, 100000);
+select '5_03', count_distinct_approx(value % 10) = 10 from stats_seq(1, 1000);
+select '5_04', count_distinct_approx(null) = 0;
+select '5_05', count_distinct_approx(value) = count_distinct_approx(cast(value as real)) from stats_seq(1, 1000);
+select '5_06', length(hll_sketch(value)) = 16387 from stats_seq(1, 10);
+select '5_07', hll_count(hll_sketch(value)) = count_distinct_approx(value) from stats_seq(1, 1000);
+with daily as (
+  select value / 1000 as day, hll_sketch(value % 3000) as sketch
+  from stats_seq(0, 9999) group by 1
+)
+select '5_08', hll_count(hll_merge(sketch)) between 2940 and 3060 from daily;
+select '5_09', hll_count(null) is null;
+
+select '6_01', (count(*), min(value), max(value)) = (11, 0, 1) from stats_range(0, 1, 0.1);
+select '6_02', sum(value) = 2.5 from stats_range(1, 0, -0.25);
+select '6_03', (select group_concat(value, ',') from stats_range(0, 0.3, 0.1)) = '0.0,0.1,0.2,0.3';
+with tmp as (select value from stats_range(0, 100, 1) limit 3 offset 5)
+select '6_04', (count(*), min(value), max(value)) = (3, 5, 7) from tmp;
+with tmp as (select value from stats_range(0, 100, 1) order by value desc limit 3 offset 5)
+select '6_05', group_concat(value, ',') = '95.0,94.0,93.0' from tmp;
+with tmp as (select value from stats_range(0, 1e15, 0.5) where value > 10 and value <= 12)
+select '6_06', (count(*), min(value), max(value)) = (4, 10.5, 12) from tmp;
+select '6_07', count(*) = 1 from stats_range(0, 1e15, 0.5) where value = 7.5;
+select '6_08', count(*) = 0 from stats_range(1, null);
+select '6_09', count(*) = 0 from stats_range(1, 0, 0.5);
+select '6_10', (count(*), min(value), max(value)) = (33, '2024-01-31 00:00:00', '2024-03-03 00:00:00')
+from stats_range('2024-01-31', '2024-03-03');
+select '6_11', group_concat(value, ',') = '2024-01-01 00:00:00.000,2024-01-01 00:00:00.500,2024-01-01 00:00:01.000'
+from stats_range('2024-01-01 00:00:00', '2024-01-01 00:00:01', 0.5);
+with tmp as (
+  select value from stats_range('2000-01-01', '2100-01-01', 3600)
+  where value between '2024-02-29 22:00:00' and '2024-03-01 01:00:00'
+)
+select '6_12', (count(*), min(value), max(value)) = (4, '2024-02-29 22:00:00', '2024-03-01 01:00:00') from tmp;
+with tmp as (select value from stats_range(0, 100, 1) order by rowid desc limit 3)
+select '6_13', group_concat(value, ',') = '100.0,99.0,98.0' from tmp;
+with tmp as (select value from stats_range(0, 100, 1) order by value desc, rowid limit 3)
+select '6_14', group_concat(value, ',') = '100.0,99.0,98.0' from tmp;
+with tmp as (select value from stats_range(10, 0, -1) order by rowid limit 3)
+select '6_15', group_concat(value, ',') = '10.0,9.0,8.0' from tmp;
+with tmp as (select value from stats_range(10, 0, -1) order by rowid desc limit 3 offset 1)
+select '6_16', group_concat(value, ',') = '1.0,2.0,3.0' from tmp;
+with tmp as (select value from stats_range(10, 0, -1) order by value desc limit 2)
+select '6_17', group_concat(value, ',') = '10.0,9.0' from tmp;
+with tmp as (select value from stats_range(10, 0, -1) where value > 7)
+select '6_18', (count(*), min(value), max(value)) = (3, 8, 10) from tmp;
+with tmp as (select value from stats_range(10, 0, -1) where value < 3)
+select '6_19', (count(*), min(value), max(value)) = (3, 0, 2) from tmp;
+with tmp as (select value from stats_range(10, 0, -1) where value >= 7 and value < 9)
+select '6_20', (count(*), min(value), max(value)) = (2, 7, 8) from tmp;
+with tmp as (select value from stats_range(10, 0, -0.5) where value between 2 and 3)
+select '6_21', (count(*), min(value), max(value)) = (3, 2, 3) from tmp;
+with tmp as (
+  select value from stats_range('2024-01-10', '2024-01-01', -86400)
+  where value > '2024-01-07 12:00:00'
+)
+select '6_22', (count(*), min(value), max(value)) = (3, '2024-01-08 00:00:00', '2024-01-10 00:00:00') from tmp;
+
+select '7_01', histogram(value, 0, 100, 4) = '{"edges":[0.0,25.0,50.0,75.0,100.0],"counts":[24,25,25,26]}' from stats_seq(1, 100);
+select '7_02', json_extract(histogram(value, 0, 100, 4), '$.counts') = '[25,25,25,26]' from stats_seq(-10, 110);
+select '7_03', json_extract(histogram(null, 0, 100, 2), '$.counts') = '[0,0]';
+select '7_04', histogram_equidepth(value, 4) = '{"edges":[1.0,25.75,50.5,75.25,100.0],"counts":[25,25,25,25]}' from stats_seq(1, 100);
+select '7_05', json_extract(histogram_equidepth(value*value, 3), '$.counts') = '[3,3,4]' from stats_seq(1, 10);
+with hist as (select histogram(value, 0, 100, 4) as h from stats_seq(1, 100))
+select '7_06', (count(*), sum(count), min(lo), max(hi)) = (4, 100, 0, 100) from hist, histogram_bins(hist.h);
+select '7_07', (bin, lo, hi, count) = (2, 1.5, 3, 5) from histogram_bins('{"edges": [0, 1.5, 3], "counts": [2, 5]}') where bin = 2;
+select '7_08', count(*) = 0 from histogram_bins(null);
+select '7_09', (count(*), sum(count), max(hi)) = (2, 3, 2) from histogram_bins('{"note":"edges","edges":[0,1,2],"counts":[1,2]}');
+select '7_10', (count(*), sum(count), max(hi)) = (2, 3, 2) from histogram_bins('{"meta":{"edges":[9],"s":"]}"},"edges":[0,1,2],"counts":[1,2]}');
+select '7_11', (min(lo), max(hi)) = (-150, 1000) from histogram_bins('{"edges":[-1.5e2,0.25,1E3],"counts":[1,2]}');
+with hist as (select histogram_equidepth(value / 7.0, 5) as h from stats_seq(1, 100))
+select '7_12', count(*) = 5 from hist, histogram_bins(hist.h)
+where lo = json_extract(hist.h, '$.edges[' || (bin - 1) || ']') and hi = json_extract(hist.h, '$.edges[' || bin || ']');
+
+create table pairs as select value as x, 2*value + 1 + (value % 3) as y from stats_seq(1, 20);
+select '8_01', round(covar_pop(y, x), 3) = 66.675 from pairs;
+select '8_02', round(covar_samp(y, x), 3) = 70.184 from pairs;
+select '8_03', round(corr(y, x), 4) = 0.9976 from pairs;
+select '8_04', round(regr_slope(y, x), 4) = 2.0053 from pairs;
+select '8_05', round(regr_intercept(y, x), 4) = 1.9947 from pairs;
+select '8_06', round(regr_r2(y, x), 4) = 0.9952 from pairs;
+select '8_07', round(stats_corr(y, x), 4) = 0.9976 from pairs;
+select '8_08', corr(y, x) is null from pairs where x > 100;
+select '8_09', corr(y, null) is null from pairs;
+select '8_10', regr_slope(2*x + 1, x) = 2 and regr_intercept(2*x + 1, x) = 1 from pairs;
+with windowed as (
+  select x, corr(y, x) over (order by x rows between 4 preceding and current row) as c
+  from pairs
+)
+select '8_11', round(c, 4) = 0.9487 from windowed where x = 6;
+with windowed as (
+  select x, regr_slope(y, x) over (order by x rows between 4 preceding and current row) as s
+  from pairs
+)
+select '8_12', round(s, 4) = 2.1 from windowed where x = 7;
+drop table pairs;
+
+create table steady(id integer, x real, y real);
+insert into steady values (1, 1.1, 2), (2, 5.3, 3), (3, 5.3, 4), (4, 5.3, 7);
+with windowed as (
+  select id,
+    regr_slope(y, x) over w as s, regr_intercept(y, x) over w as i,
+    corr(y, x) over w as c, regr_r2(y, x) over w as r2
+  from steady
+  window w as (order by id rows between 1 preceding and current row)
+)
+select '8_13', count(*) = 2 from windowed where id > 2 and s is null and i is null and c is null and r2 is null;
+with windowed as (
+  select id, corr(x, y) over (order by id rows between 1 preceding and current row) as c
+  from steady
+)
+select '8_14', count(*) = 2 from windowed where id > 2 and c is null;
+drop table steady;
@@ -0,0 +1,64 @@
+-- Copyright (c) 2024 Anton Zhiyanov, MIT License
+-- https://github.com/nalgeon/sqlean
+
+-- Substring search benchmark for the text extension across needle lengths,
+-- plus LIKE, case conversion, normalization, character positions, translation,
+-- multi-string replacement, splitting and joining.
+-- Run with `make bench-text`, compare the "Run Time" lines between builds.
+
+.load dist/text
+
+-- 2000 documents of ~16 KB: repeated words with a marker near the end,
+-- so that every search scans almost the whole document.
+create table docs as
+with recursive n(i) as (select 1 union all select i + 1 from n where i < 2000)
+select i as id, replace(printf('%.*c', 400, 'x'), 'x', 'lorem ipsum dolor sit amet, consec ')
+    || 'needle-' || (i % 10) || ' the end' as body
+from n;
+
+create table needles(len integer, needle text);
+insert into needles values
+    (1, '-'),
+    (4, 'dle-'),
+    (16, 'amet, consec nee'),
+    (64, 'sit amet, consec lorem ipsum dolor sit amet, consec needle-7 the'),
+    (256, substr((select body from docs where id = 7), -256));
+
+select 'needle lengths: ' || group_concat(length(needle), ', ') from needles;
+
+.timer on
+select 'index, 1: ' || sum(text_index(body, (select needle from needles where len = 1))) from docs;
+select 'index, 4: ' || sum(text_index(body, (select needle from needles where len = 4))) from docs;
+select 'index, 16: ' || sum(text_index(body, (select needle from needles where len = 16))) from docs;
+select 'index, 64: ' || sum(text_index(body, (select needle from needles where len = 64))) from docs;
+select 'index, 256: ' || sum(text_index(body, (select needle from needles where len = 256))) from docs;
+select 'contains, 16: ' || sum(text_contains(body, (select needle from needles where len = 16))) from docs;
+select 'count, 4: ' || sum(text_count(body, 'psum')) from docs;
+select 'replace, 4: ' || sum(length(text_replace(body, 'psum', 'PSUM'))) from docs;
+select 'translate: ' || sum(length(text_translate(body, 'aeiou', 'AEIOU'))) from docs;
+select 'translate, cyrillic: ' || sum(length(text_translate(body, 'lorem', 'лорем'))) from docs;
+select 'replace, nested: ' || sum(length(replace(replace(replace(replace(body, 'lorem', 'LOREM'), 'ipsum', 'IPSUM'), 'dolor', 'DOLOR'), 'amet', 'AMET'))) from docs;
+select 'replace many: ' || sum(length(text_replace_many(body, '{"lorem": "LOREM", "ipsum": "IPSUM", "dolor": "DOLOR", "amet": "AMET"}'))) from docs;
+select 'split, 4: ' || count(text_split(body, 'dle-', 2)) from docs;
+select 'split rows: ' || count(*) from docs, text_split_rows(docs.body, ', ');
+select 'like, prefix: ' || sum(text_like('lorem%', body)) from docs;
+select 'like, contains: ' || sum(text_like('%needle-7%', body)) from docs;
+select 'like, wildcards: ' || sum(text_like('%sit _met%NEEDLE-_ the%', body)) from docs;
+select 'like, cyrillic: ' || sum(text_like('%ИГЛА-7%', replace(body, 'needle', 'игла'))) from docs;
+select 'lower: ' || sum(length(text_lower(body))) from docs;
+select 'upper: ' || sum(length(text_upper(body))) from docs;
+select 'lower, cyrillic: ' || sum(length(text_lower(replace(body, 'lorem', 'ЛОРЕМ')))) from docs;
+select 'normalize, chained: ' || sum(length(text_trim(text_lower(replace(replace(body, '  ', ' '), '  ', ' '))))) from docs;
+select 'normalize, fused: ' || sum(length(text_normalize(body, 'trim,lower,collapse_ws'))) from docs;
+select 'normalize, accents: ' || sum(length(text_normalize(replace(body, 'lorem', 'lórem'), 'lower,strip_accents'))) from docs;
+select 'substring, each char: ' || count(*) from docs
+where text_substring(replace(printf('%.*c', 400, 'x'), 'x', 'лорем ipsum dolor sit amet, consec '), id * 5 + 1, 1) = 'л';
+select 'right, each length: ' || sum(length(text_right(replace(printf('%.*c', 400, 'x'), 'x', 'лорем ipsum dolor sit amet, consec '), id * 7))) from docs;
+select 'column, several functions: ' || sum(text_length(body) + length(text_right(body, 10)) + length(text_substring(body, 100, 10))) from (
+    select replace(body, 'lorem', 'лорем') as body from docs
+);
+select 'join agg: ' || length(text_join_agg(', ', body)) from docs;
+select 'join window: ' || sum(length(joined)) from (
+    select text_join_agg(', ', id) over (order by id rows 100 preceding) as joined from docs
+);
+.timer off
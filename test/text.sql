@@ -215,6 +215,21 @@ select '9_31', text_split('one|two|thr', '|', -1) = 'thr';
 select '9_32', text_split('one|two|thr', '|', -2) = 'two';
 select '9_33', text_split('one|two|thr', '|', -3) = 'one';
 select '9_34', text_split('one|two|thr', '|', -4) = '';
+select '9_35', text_split('один|два|три', '|', -2) = 'два';
+select '9_36', text_split('one', 'one|two', 1) = 'one';
+select '9_37', text_split('xaaay', 'aa', -1) = 'ay';
+
+-- Split rows
+select '9_41', (select count(*) from text_split_rows(null, '|')) = 0;
+select '9_42', (select count(*) from text_split_rows('', '|')) = 0;
+select '9_43', (select count(*) from text_split_rows('one|two', null)) = 0;
+select '9_44', (select group_concat(idx || ':' || value, ',') from text_split_rows('one|two|three', '|')) = '1:one,2:two,3:three';
+select '9_45', (select group_concat(value, ',') from text_split_rows('один|два|три', '|')) = 'один,два,три';
+select '9_46', (select group_concat(quote(value), ',') from text_split_rows('|one||two|', '|')) = ''''',''one'','''',''two'',''''';
+select '9_47', (select group_concat(value, ',') from text_split_rows('one/\two/\three', '/\')) = 'one,two,three';
+select '9_48', (select group_concat(value, ',') from text_split_rows('one|two', '')) = 'one|two';
+select '9_49', (select group_concat(value, ',') from text_split_rows('one|two', ';')) = 'one|two';
+select '9_50', (select value from text_split_rows('one|two|three', '|') where idx = 2) = 'two';
 
 -- Join
 select '10_01', text_join('|', 'one') = 'one';
@@ -235,6 +250,29 @@ select '10_24', text_join('|', 'one', 'two', null) = 'one|two';
 select '10_25', text_join('|', null, 'two', null) = 'two';
 select '10_26', text_join('|', null, null, null) = '';
 
+-- Join aggregate
+create table parts(id integer primary key, value text);
+insert into parts(value) values ('one'), (null), ('два'), (''), ('three');
+select '10_31', (select text_join_agg('|', value) from parts) = 'one|два||three';
+select '10_32', (select text_join_agg(null, value) from parts) = 'oneдваthree';
+select '10_33', (select text_join_agg('|', value) from parts where value is null) is null;
+select '10_34', (select text_join_agg('|', value) from parts where 0) is null;
+select '10_35', (select group_concat(joined, ';') from (
+    select text_join_agg(', ', value) over (order by id rows between 1 preceding and current row) as joined
+    from parts
+)) = 'one;one;два;два, ;, three';
+select '10_36', (select group_concat(joined, ';') from (
+    select text_join_agg('-', value) over (order by id rows between current row and unbounded following) as joined
+    from parts
+)) = 'one-два--three;два--three;два--three;-three;three';
+select '10_37', text_join_agg(',', '') = '';
+select '10_38', (select text_join_agg('', value) from (select '' as value union all select '')) = '';
+select '10_39', (select group_concat(quote(joined), ';') from (
+    select text_join_agg('', value) over (order by id rows between 1 preceding and current row) as joined
+    from (select 1 as id, '' as value union all select 2, '' union all select 3, null)
+)) = ''''';'''';''''';
+drop table parts;
+
 -- Concat
 select '11_01', text_concat('one') = 'one';
 select '11_02', text_concat('one', 'two') = 'onetwo';
@@ -411,6 +449,14 @@ select '24_09', text_translate('hello', 'l', '')  = 'heo';
 select '24_10', text_translate('hello', '', '')  = 'hello';
 select '24_11', text_translate('', 'l', '1')  = '';
 select '24_12', text_translate('нетто', 'от', '03')  = 'не330';
+select '24_13', text_translate('abc', 'ab', 'ёж')  = 'ёжc';
+select '24_14', text_translate('hello', 'lol', 'LxY')  = 'heLLx';
+select '24_15', (select group_concat(text_translate(value, 'ao', 'AO'), ',') from (
+    select 'foo' as value union all select 'bar' union all select 'нет'
+)) = 'fOO,bAr,нет';
+select '24_16', (select group_concat(text_translate('hello', 'lo', value), ',') from (
+    select 'LO' as value union all select '01' union all select ''
+)) = 'heLLO,he001,he';
 
 -- Reverse
 select '20_01', text_reverse(null) is NULL;
@@ -449,6 +495,8 @@ select '25_03', text_upper('hello') = 'HELLO';
 select '25_04', text_upper('cómo estás') = 'CÓMO ESTÁS';
 select '25_05', text_upper('привет') = 'ПРИВЕТ';
 select '25_06', text_upper('пРиВеТ') = 'ПРИВЕТ';
+select '25_07', text_upper('ıſɐ') = 'ISⱯ';
+select '25_08', text_upper('the quick brown fox jumps over the lazy dog') = 'THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG';
 
 -- Lower
 select '26_01', text_lower(null) is null;
@@ -457,6 +505,8 @@ select '26_03', text_lower('HELLO') = 'hello';
 select '26_04', text_lower('CÓMO ESTÁS') = 'cómo estás';
 select '26_05', text_lower('ПРИВЕТ') = 'привет';
 select '26_06', text_lower('пРиВеТ') = 'привет';
+select '26_07', text_lower('ⱯX') = 'ɐx';
+select '26_08', text_lower('THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG') = 'the quick brown fox jumps over the lazy dog';
 
 -- Title
 select '27_01', text_title(null) is null;
@@ -484,8 +534,99 @@ select '29_06', text_like('H%l_, w%ld!', 'hello, world!') = 1;
 select '29_07', text_like('H%l_, w%ld.', 'hello, world!') = 0;
 select '29_08', text_like('c_mo est_s', 'cómo estás') = 1;
 select '29_09', text_like('прив_т', 'пРиВеТ') = 1;
+select '29_10', text_like('%hello', 'hello') = 1;
+select '29_11', text_like('h%o', 'ho') = 1;
+select '29_12', text_like('%ВЕТ', 'привет') = 1;
+select '29_13', text_like('%', '') = 1;
+select '29_14', text_like('', 'hello') = 0;
+select '29_15', text_like('_ſ%', 'xs') = 1;
+select '29_16', (select group_concat(value, ',') from (
+    select 'Привет' as value union all select 'мир' union all select 'привет, МИР' union all select 'world'
+) where text_like('%МИР%', value)) = 'мир,привет, МИР';
+select '29_17', (select group_concat(value, ',') from (
+    select 'ab' as value, 'a%' as pattern union all select 'ab', '%c' union all select 'ёж', 'Ё_'
+) where text_like(pattern, value)) = 'ab,ёж';
 
 -- nocase collation
 select '31_01', (select 1 where 'hello' = 'hello' collate text_nocase) = 1;
 select '31_02', (select 1 where 'hell0' = 'hello' collate text_nocase) is null;
 select '31_03', (select 1 where 'привет' = 'ПРИВЕТ' collate text_nocase) = 1;
+
+-- Normalize
+select '32_01', text_normalize(null, 'trim') is null;
+select '32_02', text_normalize('hello', null) is null;
+select '32_03', text_normalize('', 'trim,lower') = '';
+select '32_04', text_normalize('  Hello  ', '') = '  Hello  ';
+select '32_05', text_normalize('  hello world  ', 'trim') = 'hello world';
+select '32_06', text_normalize(' hello   world ', 'collapse_ws') = ' hello world ';
+select '32_07', text_normalize(' hello ' || char(9, 10) || ' world ', 'trim,collapse_ws') = 'hello world';
+select '32_08', text_normalize('   ', 'trim') = '';
+select '32_09', text_normalize('ПРИВЕТ Мир', 'lower') = 'привет мир';
+select '32_10', text_normalize('привет мир', 'upper') = 'ПРИВЕТ МИР';
+select '32_11', text_normalize('ıſ', 'upper') = 'IS';
+select '32_12', text_normalize('Crème Brûlée, Łódź', 'strip_accents') = 'Creme Brulee, Lodz';
+select '32_13', text_normalize('cafe' || char(0x301), 'strip_accents') = 'cafe';
+select '32_14', text_normalize('Ἀθῆναι', 'strip_accents,upper') = 'ΑΘΗΝΑΙ';
+select '32_15', text_normalize('  Crème   BRÛLÉE ', 'trim, lower, collapse_ws, strip_accents') = 'creme brulee';
+select '32_16', text_normalize('  Crème   BRÛLÉE ', 'strip_accents,collapse_ws,lower,trim') = 'creme brulee';
+
+-- Character index
+create table positions(i integer primary key);
+insert into positions with recursive n(i) as (select 1 union all select i + 1 from n where i < 300) select i from n;
+select '33_01', (select count(*) from positions
+    where text_substring(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), i, 3)
+        = substr(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), i, 3)) = 300;
+select '33_02', (select count(*) from positions
+    where text_substring(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), i)
+        = substr(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), i)) = 300;
+select '33_03', (select count(*) from positions
+    where text_right(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), i)
+        = substr(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), -i)) = 300;
+select '33_04', (select count(*) from positions
+    where text_left(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), -i)
+        = substr(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), 1, max(200 - i, 0))) = 300;
+select '33_05', (select count(*) from positions
+    where text_slice(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), -i, -1)
+        = substr(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), -i, i - 1)) = 300;
+select '33_06', (select count(*) from positions
+    where text_length(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё')) = 200) = 300;
+select '33_07', (select count(*) from positions
+    where text_lpad(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), i)
+        = substr(printf('%.*c', 100, ' '), 1, max(i - 200, 0))
+            || substr(replace(printf('%.*c', 50, 'x'), 'x', 'ab-ё'), 1, i)) = 300;
+select '33_08', (select count(*) from positions
+    where text_substring(replace(printf('%.*c', 50, 'x'), 'x', 'abcd'), i, 3)
+        = substr(replace(printf('%.*c', 50, 'x'), 'x', 'abcd'), i, 3)) = 300;
+select '33_09', (select group_concat(text_right(value, 2), ',') from (
+    select 'привет' as value union all select 'мир' union all select 'hello'
+)) = 'ет,ир,lo';
+create table phrases as select i, replace(printf('%.*c', 20 + i % 7, 'x'), 'x', 'ab-ё' || i) as value from positions;
+select '33_10', (select count(*) from phrases
+    where text_length(value) = length(value)
+        and text_substring(value, i % 50 + 1, 5) = substr(value, i % 50 + 1, 5)
+        and text_right(value, i % 30) = substr(value, -(i % 30), i % 30)
+        and text_left(value, i % 40) = substr(value, 1, i % 40)
+        and text_slice(value, -(i % 20 + 2), -1) = substr(value, -(i % 20 + 2), i % 20 + 1)) = 300;
+select '33_11', (select count(*) from phrases as p1 join phrases as p2 on p2.i = 301 - p1.i
+    where text_substring(p1.value, 10, 5) || text_substring(p2.value, 10, 5)
+        = substr(p1.value, 10, 5) || substr(p2.value, 10, 5)) = 300;
+drop table phrases;
+
+-- Replace many
+select '34_01', text_replace_many(null, '{}') is null;
+select '34_02', text_replace_many('hello', null) is null;
+select '34_03', text_replace_many('hello', '{}') = 'hello';
+select '34_04', text_replace_many('', '{"a": "b"}') = '';
+select '34_05', text_replace_many('the cat sat on the mat', '{"cat": "dog", "mat": "rug", "the": "a"}') = 'a dog sat on a rug';
+select '34_06', text_replace_many('abcd', '{"a": "1", "ab": "2", "bcd": "3"}') = '2cd';
+select '34_07', text_replace_many('ab', '{"a": "b", "b": "a"}') = 'ba';
+select '34_08', text_replace_many('hello', '{"l": ""}') = 'heo';
+select '34_09', text_replace_many('привет, мир', '{"мир": "world", "привет": "hello"}') = 'hello, world';
+select '34_10', text_replace_many('caf\u00e9', '{"\\u": "U", "\u00e9": "e"}') = 'cafU00e9';
+select '34_11', text_replace_many('café', '{"\u00e9": "e"}') = 'cafe';
+select '34_12', (select group_concat(text_replace_many(value, '{"a": "1", "b": "2"}'), ',') from (
+    select 'ab' as value union all select 'ba' union all select 'c'
+)) = '12,21,c';
+select '34_13', (select group_concat(text_replace_many('ab', value), ',') from (
+    select '{"a": "1"}' as value union all select '{"b": "2"}'
+)) = '1b,a2';
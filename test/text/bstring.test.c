@@ -416,6 +416,22 @@ static void test_count(void) {
     printf("OK\n");
 }
 
+static void test_is_ascii(void) {
+    printf("test_is_ascii...");
+    const char* ascii = "The quick brown fox jumps over the lazy dog, again and again and again!";
+    assert(bstring_is_ascii(bstring_from_cstring(ascii, strlen(ascii))));
+    assert(bstring_is_ascii(bstring_from_cstring("", 0)));
+    // non-ascii character at every position, to cover both the vector and the scalar checks
+    char buf[100];
+    for (size_t pos = 0; pos < sizeof(buf); pos++) {
+        memset(buf, 'a', sizeof(buf));
+        buf[pos] = (char)0xC3;
+        assert(!bstring_is_ascii(bstring_from_cstring(buf, sizeof(buf))));
+        assert(bstring_is_ascii(bstring_from_cstring(buf, pos)));
+    }
+    printf("OK\n");
+}
+
 static void test_split_part(void) {
     printf("test_split_part...");
     {
@@ -778,6 +794,79 @@ static void test_trim(void) {
     printf("OK\n");
 }
 
+static void test_trim_chars(void) {
+    printf("test_trim_chars...");
+    ByteString chars = bstring_from_cstring("x ", 2);
+    {
+        ByteString str = bstring_from_cstring("x xhellox ", 10);
+        ByteString res = bstring_trim_left_chars(str, chars);
+        assert(eq(res, "hellox "));
+        bstring_free(res);
+    }
+    {
+        ByteString str = bstring_from_cstring("x xhellox ", 10);
+        ByteString res = bstring_trim_right_chars(str, chars);
+        assert(eq(res, "x xhello"));
+        bstring_free(res);
+    }
+    {
+        ByteString str = bstring_from_cstring("x xhellox ", 10);
+        ByteString res = bstring_trim_chars(str, chars);
+        assert(eq(res, "hello"));
+        bstring_free(res);
+    }
+    {
+        ByteString str = bstring_from_cstring("xx", 2);
+        ByteString res = bstring_trim_chars(str, chars);
+        assert(eq(res, ""));
+        bstring_free(res);
+    }
+    {
+        ByteString str = bstring_from_cstring(" hello ", 7);
+        ByteString res = bstring_trim_chars(str, bstring_new());
+        assert(eq(res, " hello "));
+        bstring_free(res);
+    }
+    printf("OK\n");
+}
+
+static void test_pad_left(void) {
+    printf("test_pad_left...");
+    ByteString str = bstring_from_cstring("hello", 5);
+    {
+        ByteString res = bstring_pad_left(str, 8, bstring_from_cstring("xo", 2));
+        assert(eq(res, "xoxhello"));
+        bstring_free(res);
+    }
+    {
+        ByteString res = bstring_pad_left(str, 3, bstring_from_cstring("xo", 2));
+        assert(eq(res, "hel"));
+        bstring_free(res);
+    }
+    {
+        ByteString res = bstring_pad_left(str, 8, bstring_new());
+        assert(eq(res, "hello"));
+        bstring_free(res);
+    }
+    printf("OK\n");
+}
+
+static void test_pad_right(void) {
+    printf("test_pad_right...");
+    ByteString str = bstring_from_cstring("hello", 5);
+    {
+        ByteString res = bstring_pad_right(str, 8, bstring_from_cstring("xo", 2));
+        assert(eq(res, "helloxox"));
+        bstring_free(res);
+    }
+    {
+        ByteString res = bstring_pad_right(str, 0, bstring_from_cstring("xo", 2));
+        assert(eq(res, ""));
+        bstring_free(res);
+    }
+    printf("OK\n");
+}
+
 int main(void) {
     test_cstring();
 
@@ -792,6 +881,7 @@ int main(void) {
     test_has_prefix();
     test_has_suffix();
     test_count();
+    test_is_ascii();
 
     test_split_part();
     test_join();
@@ -805,6 +895,9 @@ int main(void) {
     test_trim_left();
     test_trim_right();
     test_trim();
+    test_trim_chars();
+    test_pad_left();
+    test_pad_right();
 
     return 0;
 }
@@ -0,0 +1,118 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/charindex.h"
+#include "text/utf8/utf8.h"
+
+static void test_ascii(void) {
+    printf("test_ascii...");
+    const char* str = "hello, world";
+    CharIndex* index = charindex_new(str, strlen(str));
+    assert(index != NULL);
+    assert(charindex_is_ascii(index));
+    assert(charindex_size(index) == 12);
+    assert(charindex_length(index) == 12);
+    assert(charindex_pos(index, str, 0) == 0);
+    assert(charindex_pos(index, str, 7) == 7);
+    assert(charindex_pos(index, str, 20) == 12);
+    charindex_free(index);
+    printf("OK\n");
+}
+
+static void test_unicode(void) {
+    printf("test_unicode...");
+    const char* str = "привет, мир";
+    CharIndex* index = charindex_new(str, strlen(str));
+    assert(index != NULL);
+    assert(!charindex_is_ascii(index));
+    assert(charindex_length(index) == 11);
+    assert(charindex_pos(index, str, 6) == 12);
+    assert(charindex_pos(index, str, 8) == 14);
+    assert(charindex_pos(index, str, 11) == strlen(str));
+
+    Utf8String s_str = ustring_from_cstring(str, strlen(str));
+    Utf8String s_res = charindex_substring(index, s_str, 8, 3);
+    assert(s_res.size == 6 && memcmp(s_res.bytes, "мир", 6) == 0);
+    s_res = charindex_substring(index, s_str, 0, 100);
+    assert(s_res.size == strlen(str));
+    s_res = charindex_substring(index, s_str, 20, 5);
+    assert(s_res.size == 0);
+    charindex_free(index);
+    printf("OK\n");
+}
+
+static void test_random(void) {
+    printf("test_random...");
+    const char* alphabet[] = {"a", "ё", "€", "😀"};
+    srand(42);
+    for (int iter = 0; iter < 200; iter++) {
+        char str[2048] = {0};
+        int n = rand() % 500;
+        for (int i = 0; i < n; i++) {
+            strcat(str, alphabet[rand() % 4]);
+        }
+        size_t size = strlen(str);
+        CharIndex* index = charindex_new(str, size);
+        assert(index != NULL);
+        assert(charindex_length(index) == utf8_len(str, size));
+        for (size_t idx = 0; idx <= (size_t)n + 1; idx++) {
+            assert(charindex_pos(index, str, idx) == utf8_pos(str, size, idx));
+        }
+        charindex_free(index);
+    }
+    printf("OK\n");
+}
+
+static void test_cache(void) {
+    printf("test_cache...");
+    char str[CHARINDEX_CACHE_MIN * 4] = {0};
+    for (int i = 0; i < CHARINDEX_CACHE_MIN; i++) {
+        strcat(str, i % 2 ? "ё" : "a");
+    }
+    size_t size = strlen(str);
+    CharIndexCache* cache = charindex_cache_new();
+    assert(cache != NULL);
+
+    // short strings are never indexed
+    assert(charindex_cache_get(cache, "привет", strlen("привет")) == NULL);
+    assert(charindex_cache_get(cache, "привет", strlen("привет")) == NULL);
+
+    // a string is indexed when seen again, compared by contents
+    assert(charindex_cache_get(cache, str, size) == NULL);
+    char copy[sizeof(str)];
+    memcpy(copy, str, sizeof(str));
+    const CharIndex* index = charindex_cache_get(cache, copy, size);
+    assert(index != NULL);
+    assert(charindex_length(index) == CHARINDEX_CACHE_MIN);
+    assert(charindex_cache_get(cache, str, size) == index);
+
+    // a string of the same size with other contents is not the same string
+    copy[0] = 'b';
+    assert(charindex_cache_get(cache, copy, size) == NULL);
+    assert(charindex_cache_get(cache, str, size) == index);
+
+    // the oldest strings are replaced
+    for (int i = 0; i < CHARINDEX_CACHE_SIZE; i++) {
+        copy[0] = 'c' + i;
+        assert(charindex_cache_get(cache, copy, size) == NULL);
+    }
+    assert(charindex_cache_get(cache, str, size) == NULL);
+
+    charindex_cache_retain(cache);
+    charindex_cache_release(cache);
+    charindex_cache_release(cache);
+    printf("OK\n");
+}
+
+int main(void) {
+    test_ascii();
+    test_unicode();
+    test_random();
+    test_cache();
+    return 0;
+}
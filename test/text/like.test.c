@@ -0,0 +1,147 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/like.h"
+#include "text/utf8/rune.h"
+#include "text/utf8/utf8.h"
+
+// decode decodes the utf8 string into runes and returns their number.
+static size_t decode(const char* str, uint32_t* runes) {
+    utf8_decode_t d = {.state = 0};
+    size_t n = 0;
+    for (const char* c = str; *c; c++) {
+        if (utf8_decode(&d, (uint8_t)*c) == 0) {
+            runes[n++] = rune_casefold(d.codep);
+        }
+    }
+    return n;
+}
+
+// naive_like is the reference implementation of like_match.
+static bool naive_like(const uint32_t* pattern, size_t np, const uint32_t* str, size_t ns) {
+    if (np == 0) {
+        return ns == 0;
+    }
+    if (pattern[0] == '%') {
+        for (size_t skip = 0; skip <= ns; skip++) {
+            if (naive_like(pattern + 1, np - 1, str + skip, ns - skip)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (ns == 0) {
+        return false;
+    }
+    if (pattern[0] != '_' && pattern[0] != str[0]) {
+        return false;
+    }
+    return naive_like(pattern + 1, np - 1, str + 1, ns - 1);
+}
+
+static int like(const char* pattern, const char* str) {
+    LikePattern* compiled = like_compile(pattern, strlen(pattern));
+    assert(compiled != NULL);
+    int match = like_match(compiled, str, strlen(str));
+    like_free(compiled);
+    return match;
+}
+
+static void test_like(void) {
+    printf("test_like...");
+    struct test {
+        const char* pattern;
+        const char* str;
+        int match;
+    };
+    const struct test tests[] = {
+        {"", "", 1},
+        {"", "a", 0},
+        {"%", "", 1},
+        {"%%", "abc", 1},
+        {"_", "", 0},
+        {"_", "a", 1},
+        {"_", "ab", 0},
+        {"H%", "Hi", 1},
+        {"%i", "Hi", 1},
+        {"H%o", "Hello", 1},
+        {"H_l_o", "Halo", 0},
+        {"Hel%rld", "Hello, world", 1},
+        {"H%l_, w%ld", "Hello, world", 1},
+        {"H%l_, w%ld.", "Hello, world!", 0},
+        {"HeLLo, WoRlD", "Hello, world", 1},
+        {"Hello, world%11", "Hello, world", 0},
+        {"a%y", "abcdefghijklmnopqrstuvwyz", 0},
+        {"%mnopqrst%", "abcdefghijklmnopqrstuvwyz", 1},
+        {"%abc", "abc", 1},
+        {"a%c", "ac", 1},
+        {"a%b%c", "abc", 1},
+        {"a%bc%bc", "abcbc", 1},
+        {"a%bc%bc", "abc", 0},
+        {"%_b_%", "ab", 0},
+        {"%_b_%", "abc", 1},
+        {"%aa%aa", "aaa", 0},
+        {"%aa%aa", "aaaa", 1},
+        {"прив_т", "пРиВеТ", 1},
+        {"%вет", "ПРИВЕТ", 1},
+        {"c_mo est_s", "cómo estás", 1},
+        {"%ó%á_", "CÓMO ESTÁS", 1},
+        {"_ſ%", "XS", 1},
+        {"%ı", "aI", 0},
+        {"ǅ%", "ǆemal", 1},
+    };
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+        const struct test* t = &tests[i];
+        assert(like(t->pattern, t->str) == t->match);
+    }
+    printf("OK\n");
+}
+
+static void test_reuse(void) {
+    printf("test_reuse...");
+    LikePattern* compiled = like_compile("%Мир%", strlen("%Мир%"));
+    assert(like_match(compiled, "привет, мир!", strlen("привет, мир!")) == 1);
+    assert(like_match(compiled, "", 0) == 0);
+    assert(like_match(compiled, "мир", strlen("мир")) == 1);
+    assert(like_match(compiled, "hello, world", strlen("hello, world")) == 0);
+    like_free(compiled);
+    printf("OK\n");
+}
+
+static void test_random(void) {
+    printf("test_random...");
+    const char* alphabet[] = {"a", "b", "A", "B", "ё", "Ё", "%", "_"};
+    srand(42);
+    for (int iter = 0; iter < 20000; iter++) {
+        char pattern[64] = {0};
+        char str[64] = {0};
+        int np = rand() % 7;
+        for (int i = 0; i < np; i++) {
+            strcat(pattern, alphabet[rand() % 8]);
+        }
+        int ns = rand() % 9;
+        for (int i = 0; i < ns; i++) {
+            strcat(str, alphabet[rand() % 6]);
+        }
+        uint32_t p_runes[64], s_runes[64];
+        size_t p_len = decode(pattern, p_runes);
+        size_t s_len = decode(str, s_runes);
+        int expected = naive_like(p_runes, p_len, s_runes, s_len);
+        assert(like(pattern, str) == expected);
+    }
+    printf("OK\n");
+}
+
+int main(void) {
+    test_like();
+    test_reuse();
+    test_random();
+    return 0;
+}
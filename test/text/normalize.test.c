@@ -0,0 +1,144 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/normalize.h"
+#include "text/utf8/rune.h"
+
+static bool normalized(const char* src, const char* steps, const char* expected) {
+    char res[128] = {0};
+    int parsed = normalize_parse(steps, strlen(steps));
+    assert(parsed >= 0);
+    size_t n = normalize(src, strlen(src), res, sizeof(res) - 1, parsed);
+    return n == strlen(expected) && memcmp(res, expected, n) == 0;
+}
+
+static void test_parse(void) {
+    printf("test_parse...");
+    assert(normalize_parse("", 0) == 0);
+    assert(normalize_parse("trim", 4) == NORMALIZE_TRIM);
+    assert(normalize_parse("trim,lower", 10) == (NORMALIZE_TRIM | NORMALIZE_LOWER));
+    assert(normalize_parse(" trim , strip_accents,", 22) ==
+           (NORMALIZE_TRIM | NORMALIZE_STRIP_ACCENTS));
+    assert(normalize_parse("trim,lowercase", 14) == -1);
+    assert(normalize_parse("tr", 2) == -1);
+    printf("OK\n");
+}
+
+static void test_normalize(void) {
+    printf("test_normalize...");
+    assert(normalized("  hello  ", "", "  hello  "));
+    assert(normalized("  hello  world  ", "trim", "hello  world"));
+    assert(normalized("  hello  world  ", "collapse_ws", " hello world "));
+    assert(normalized(" \t hello \n world \r\n", "trim,collapse_ws", "hello world"));
+    assert(normalized("\xc2\xa0hello\xc2\xa0", "trim", "hello"));
+    assert(normalized("Привет, МИР", "lower", "привет, мир"));
+    assert(normalized("Привет, мир", "upper", "ПРИВЕТ, МИР"));
+    assert(normalized("Ǆemal ǅemal", "casefold", "ǆemal ǆemal"));
+    assert(normalized("Ça va? Ἀθῆναι, Łódź", "strip_accents", "Ca va? Αθηναι, Lodz"));
+    assert(normalized("e\xcc\x81te\xcc\x81", "strip_accents", "ete"));
+    assert(normalized("  Crème   BRÛLÉE  ", "trim,lower,collapse_ws,strip_accents", "creme brulee"));
+    assert(normalized("A\xff  B", "lower,collapse_ws", "a\xff b"));
+    printf("OK\n");
+}
+
+static void test_size(void) {
+    printf("test_size...");
+    // 'ɐ' (2 bytes) is 'Ɐ' (3 bytes) in upper case
+    char res[8] = "#######";
+    size_t n = normalize("ɐɐ", 4, res, 4, NORMALIZE_UPPER);
+    assert(n == 6);
+    assert(memcmp(res, "Ɐ#", 4) == 0);
+    // trailing whitespace does not count
+    n = normalize("ab    ", 6, res, 2, NORMALIZE_TRIM);
+    assert(n == 2 && memcmp(res, "ab", 2) == 0);
+    printf("OK\n");
+}
+
+static void test_unaccent(void) {
+    printf("test_unaccent...");
+    assert(rune_unaccent('a') == 'a');
+    assert(rune_unaccent(0x00E9) == 'e');     // é
+    assert(rune_unaccent(0x01FE) == 'O');     // Ǿ
+    assert(rune_unaccent(0x1EA0) == 'A');     // Ạ
+    assert(rune_unaccent(0x03AC) == 0x03B1);  // ά
+    assert(rune_unaccent(0x0439) == 0x0439);  // й
+    assert(rune_unaccent(0x4E16) == 0x4E16);  // 世
+    assert(rune_iscombining(0x0301));
+    assert(!rune_iscombining('e'));
+    printf("OK\n");
+}
+
+// naive_normalize is the reference implementation of normalize
+// for strings made of the tokens used in test_random.
+static size_t naive_normalize(const char** tokens, int n, char* dst, int steps) {
+    size_t j = 0;
+    size_t keep = 0;
+    bool in_ws = false;
+    for (int i = 0; i < n; i++) {
+        const char* tok = tokens[i];
+        bool is_space = (steps & (NORMALIZE_TRIM | NORMALIZE_COLLAPSE_WS)) &&
+                        (strcmp(tok, " ") == 0 || strcmp(tok, "\t") == 0);
+        if (is_space && (steps & NORMALIZE_TRIM) && j == 0) {
+            continue;
+        }
+        if (is_space && (steps & NORMALIZE_COLLAPSE_WS)) {
+            if (in_ws) {
+                continue;
+            }
+            tok = " ";
+        }
+        if (steps & NORMALIZE_LOWER) {
+            tok = strcmp(tok, "B") == 0 ? "b" : strcmp(tok, "É") == 0 ? "é" : tok;
+        }
+        in_ws = is_space;
+        memcpy(dst + j, tok, strlen(tok));
+        j += strlen(tok);
+        if (!in_ws) {
+            keep = j;
+        }
+    }
+    return (steps & NORMALIZE_TRIM) ? keep : j;
+}
+
+static void test_random(void) {
+    printf("test_random...");
+    const char* alphabet[] = {"a", "B", " ", " ", "\t", "É"};
+    const int steps[] = {
+        NORMALIZE_LOWER,
+        NORMALIZE_TRIM,
+        NORMALIZE_COLLAPSE_WS,
+        NORMALIZE_TRIM | NORMALIZE_COLLAPSE_WS | NORMALIZE_LOWER,
+    };
+    srand(42);
+    for (int iter = 0; iter < 20000; iter++) {
+        const char* tokens[48];
+        char src[128] = {0};
+        int n = rand() % 48;
+        for (int i = 0; i < n; i++) {
+            tokens[i] = alphabet[rand() % 6];
+            strcat(src, tokens[i]);
+        }
+        int step = steps[iter % 4];
+        char expected[128], res[128];
+        size_t n_expected = naive_normalize(tokens, n, expected, step);
+        size_t n_res = normalize(src, strlen(src), res, sizeof(res), step);
+        assert(n_res == n_expected && memcmp(res, expected, n_res) == 0);
+    }
+    printf("OK\n");
+}
+
+int main(void) {
+    test_parse();
+    test_normalize();
+    test_size();
+    test_unaccent();
+    test_random();
+    return 0;
+}
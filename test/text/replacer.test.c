@@ -0,0 +1,145 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/replacer.h"
+
+static bool replaced(const char* src, const char* json, const char* expected) {
+    Replacer* r = replacer_new();
+    assert(r != NULL);
+    assert(replacer_parse(r, json, strlen(json)) == REPLACER_OK);
+    assert(replacer_build(r));
+    size_t size;
+    char* res = replacer_apply(r, src, strlen(src), &size);
+    assert(res != NULL);
+    bool ok = size == strlen(expected) && memcmp(res, expected, size) == 0;
+    free(res);
+    replacer_free(r);
+    return ok;
+}
+
+static int parsed(const char* json) {
+    Replacer* r = replacer_new();
+    assert(r != NULL);
+    int rc = replacer_parse(r, json, strlen(json));
+    replacer_free(r);
+    return rc;
+}
+
+static void test_parse(void) {
+    printf("test_parse...");
+    assert(parsed("{}") == REPLACER_OK);
+    assert(parsed(" { } ") == REPLACER_OK);
+    assert(parsed("{\"a\": \"b\"}") == REPLACER_OK);
+    assert(parsed("{\"a\":\"b\",\"c\":\"\"}") == REPLACER_OK);
+    assert(parsed("{\"\\u00e9\\n\": \"\\ud83d\\ude00\"}") == REPLACER_OK);
+    assert(parsed("") == REPLACER_INVALID);
+    assert(parsed("[]") == REPLACER_INVALID);
+    assert(parsed("{\"a\": 1}") == REPLACER_INVALID);
+    assert(parsed("{\"\": \"b\"}") == REPLACER_INVALID);
+    assert(parsed("{\"a\": \"b\",}") == REPLACER_INVALID);
+    assert(parsed("{\"a\" \"b\"}") == REPLACER_INVALID);
+    assert(parsed("{\"a\": \"b\"} x") == REPLACER_INVALID);
+    assert(parsed("{\"a\": \"b") == REPLACER_INVALID);
+    assert(parsed("{\"\\x\": \"b\"}") == REPLACER_INVALID);
+    assert(parsed("{\"\\ud83d\": \"b\"}") == REPLACER_INVALID);
+    printf("OK\n");
+}
+
+static void test_apply(void) {
+    printf("test_apply...");
+    assert(replaced("hello", "{}", "hello"));
+    assert(replaced("", "{\"a\": \"b\"}", ""));
+    assert(replaced("the cat sat on the mat", "{\"cat\": \"dog\", \"mat\": \"rug\", \"the\": \"a\"}",
+                    "a dog sat on a rug"));
+    assert(replaced("abcd", "{\"a\": \"1\", \"ab\": \"2\", \"bcd\": \"3\"}", "2cd"));
+    assert(replaced("abcd", "{\"b\": \"1\", \"bc\": \"2\", \"abcx\": \"3\"}", "a2d"));
+    assert(replaced("aaa", "{\"a\": \"aa\"}", "aaaaaa"));
+    assert(replaced("aaaa", "{\"aa\": \"b\"}", "bb"));
+    assert(replaced("ab", "{\"a\": \"b\", \"b\": \"a\"}", "ba"));
+    assert(replaced("hello", "{\"l\": \"\"}", "heo"));
+    assert(replaced("hello", "{\"l\": \"1\", \"l\": \"2\"}", "he22o"));
+    assert(replaced("привет, мир", "{\"мир\": \"world\", \"привет\": \"hello\"}", "hello, world"));
+    assert(replaced("tab\there", "{\"\\t\": \" \"}", "tab here"));
+    printf("OK\n");
+}
+
+// naive_replace is the reference implementation of replacer_apply:
+// at each position, replaces the longest key that starts there.
+static size_t naive_replace(const char* src,
+                            const char** keys,
+                            const char** values,
+                            int n_keys,
+                            char* dst) {
+    size_t j = 0;
+    size_t n = strlen(src);
+    for (size_t i = 0; i < n;) {
+        int best = -1;
+        for (int k = 0; k < n_keys; k++) {
+            size_t len = strlen(keys[k]);
+            if (strncmp(src + i, keys[k], len) == 0 &&
+                (best < 0 || len > strlen(keys[best]))) {
+                best = k;
+            }
+        }
+        if (best < 0) {
+            dst[j++] = src[i++];
+            continue;
+        }
+        memcpy(dst + j, values[best], strlen(values[best]));
+        j += strlen(values[best]);
+        i += strlen(keys[best]);
+    }
+    return j;
+}
+
+static void test_random(void) {
+    printf("test_random...");
+    const char* alphabet[] = {"a", "b", "ab", "ba", "aab", "bab", "ё"};
+    const char* values[] = {"", "x", "yy", "a", "ab", "жж", "b"};
+    srand(42);
+    for (int iter = 0; iter < 20000; iter++) {
+        // distinct keys
+        const char* keys[7];
+        const char* vals[7];
+        int n_keys = 0;
+        for (int k = 0; k < 7; k++) {
+            if (rand() % 3 == 0) {
+                keys[n_keys] = alphabet[k];
+                vals[n_keys] = values[rand() % 7];
+                n_keys++;
+            }
+        }
+        char json[256] = "{";
+        for (int k = 0; k < n_keys; k++) {
+            char pair[32];
+            snprintf(pair, sizeof(pair), "%s\"%s\": \"%s\"", k > 0 ? ", " : "", keys[k], vals[k]);
+            strcat(json, pair);
+        }
+        strcat(json, "}");
+
+        char src[64] = {0};
+        int n_src = rand() % 12;
+        for (int i = 0; i < n_src; i++) {
+            strcat(src, alphabet[rand() % 2 == 0 ? 0 : 1 + rand() % 6]);
+        }
+
+        char expected[512];
+        size_t size = naive_replace(src, keys, vals, n_keys, expected);
+        expected[size] = '\0';
+        assert(replaced(src, json, expected));
+    }
+    printf("OK\n");
+}
+
+int main(void) {
+    test_parse();
+    test_apply();
+    test_random();
+    return 0;
+}
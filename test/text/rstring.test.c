@@ -918,7 +918,10 @@ static void test_like(void) {
         {"_b%", "ab", true},
         {"%c%", "abc", true},
         {"a_c", "abc", true},
-        {"%bc", "abc", true}
+        {"%bc", "abc", true},
+        {"%abc", "abc", true},
+        {"a%c", "ac", true},
+        {"%aa%aa", "aaa", false},
         // test cases
     };
     for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
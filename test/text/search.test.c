@@ -0,0 +1,104 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/search.h"
+
+// naive_first is the reference implementation of search_first.
+static const char* naive_first(const char* haystack, size_t n, const char* needle, size_t m) {
+    for (size_t idx = 0; idx + m <= n; idx++) {
+        if (memcmp(haystack + idx, needle, m) == 0) {
+            return haystack + idx;
+        }
+    }
+    return NULL;
+}
+
+// naive_last is the reference implementation of search_last.
+static const char* naive_last(const char* haystack, size_t n, const char* needle, size_t m) {
+    for (size_t idx = n - m + 1; m <= n && idx > 0; idx--) {
+        if (memcmp(haystack + idx - 1, needle, m) == 0) {
+            return haystack + idx - 1;
+        }
+    }
+    return NULL;
+}
+
+static const char* find(const char* haystack, const char* needle) {
+    return search_first(haystack, strlen(haystack), needle, strlen(needle));
+}
+
+static const char* find_last(const char* haystack, const char* needle) {
+    return search_last(haystack, strlen(haystack), needle, strlen(needle));
+}
+
+static void test_first(void) {
+    printf("test_first...");
+    const char* s = "hello world, hello universe";
+    assert(find(s, "") == s);
+    assert(find(s, "h") == s);
+    assert(find(s, "hello") == s);
+    assert(find(s, "world") == s + 6);
+    assert(find(s, "universe") == s + 19);
+    assert(find(s, "universes") == NULL);
+    assert(find(s, "planet") == NULL);
+    assert(find("", "a") == NULL);
+    assert(find("", "") != NULL);
+    // long needle, two-way algorithm
+    const char* long_s = "abababababababababababababababababababababababababababababababc";
+    assert(find(long_s, "abababababababababababababababababababc") == long_s + 24);
+    assert(find(long_s, "abababababababababababababababababababd") == NULL);
+    printf("OK\n");
+}
+
+static void test_last(void) {
+    printf("test_last...");
+    const char* s = "hello world, hello universe";
+    assert(find_last(s, "") == s + strlen(s));
+    assert(find_last(s, "hello") == s + 13);
+    assert(find_last(s, "e") == s + 26);
+    assert(find_last(s, "planet") == NULL);
+    assert(find_last("", "a") == NULL);
+    printf("OK\n");
+}
+
+// test_random compares the search with the naive one on random strings
+// over small alphabets, which produce many partial matches.
+static void test_random(void) {
+    printf("test_random...");
+    srand(42);
+    char haystack[300];
+    char needle[80];
+    for (int iter = 0; iter < 20000; iter++) {
+        int alphabet = 2 + rand() % 3;
+        size_t n = rand() % sizeof(haystack);
+        size_t m = 1 + rand() % (iter % 2 ? 8 : sizeof(needle));
+        for (size_t i = 0; i < n; i++) {
+            haystack[i] = 'a' + rand() % alphabet;
+        }
+        if (m <= n && rand() % 2) {
+            // take the needle from the haystack, so that it is found
+            memcpy(needle, haystack + rand() % (n - m + 1), m);
+        } else {
+            for (size_t i = 0; i < m; i++) {
+                needle[i] = 'a' + rand() % alphabet;
+            }
+        }
+        assert(search_first(haystack, n, needle, m) == naive_first(haystack, n, needle, m));
+        assert(search_last(haystack, n, needle, m) == naive_last(haystack, n, needle, m));
+    }
+    printf("OK\n");
+}
+
+int main(void) {
+    test_first();
+    test_last();
+    test_random();
+    return 0;
+}
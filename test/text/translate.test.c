@@ -0,0 +1,95 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "text/rstring.h"
+#include "text/translate.h"
+
+static bool translated(const char* src, const char* from, const char* to, const char* expected) {
+    Translation* tr = translate_compile(from, strlen(from), to, strlen(to));
+    assert(tr != NULL);
+    char res[128] = {0};
+    size_t n = translate_apply(tr, src, strlen(src), res, sizeof(res) - 1);
+    translate_free(tr);
+    return n == strlen(expected) && memcmp(res, expected, n) == 0;
+}
+
+static void test_translate(void) {
+    printf("test_translate...");
+    assert(translated("hello", "l", "1", "he11o"));
+    assert(translated("hello", "ole", "013", "h3110"));
+    assert(translated("hello", "oleh", "01", "110"));
+    assert(translated("12345", "143", "ax", "a2x5"));
+    assert(translated("hello", "", "1", "hello"));
+    assert(translated("hello", "l", "", "heo"));
+    assert(translated("", "l", "1", ""));
+    assert(translated("привет мир", "ир", "ИР", "пРИвет мИР"));
+    assert(translated("привет мир", "ипр", "И", "Ивет мИ"));
+    assert(translated("hello", "lol", "LxY", "heLLx"));
+    assert(translated("abc", "ab", "ёж", "ёжc"));
+    assert(translated("ёж", "ёж", "ab", "ab"));
+    assert(translated("a\xff" "b", "ab", "AB", "A\xff" "B"));
+    printf("OK\n");
+}
+
+static void test_size(void) {
+    printf("test_size...");
+    const char* src = "aaaa";
+    Translation* tr = translate_compile("a", 1, "я", strlen("я"));
+    assert(tr != NULL);
+    char res[8] = {0};
+    assert(translate_apply(tr, src, 4, res, 4) == 8);
+    assert(memcmp(res, "яя", 4) == 0);
+    assert(translate_apply(tr, src, 4, res, 8) == 8);
+    assert(memcmp(res, "яяяя", 8) == 0);
+    translate_free(tr);
+    printf("OK\n");
+}
+
+static void test_random(void) {
+    printf("test_random...");
+    const char* alphabet[] = {"a", "b", "c", "ё", "ж", "€", "😀", "z"};
+    srand(42);
+    for (int iter = 0; iter < 20000; iter++) {
+        char src[128] = {0};
+        char from[128] = {0};
+        char to[128] = {0};
+        int n_src = rand() % 10;
+        for (int i = 0; i < n_src; i++) {
+            strcat(src, alphabet[rand() % 8]);
+        }
+        int n_from = rand() % 6;
+        for (int i = 0; i < n_from; i++) {
+            strcat(from, alphabet[rand() % 7]);
+        }
+        int n_to = rand() % 6;
+        for (int i = 0; i < n_to; i++) {
+            strcat(to, alphabet[rand() % 8]);
+        }
+
+        RuneString r_src = rstring_from_cstring(src);
+        RuneString r_from = rstring_from_cstring(from);
+        RuneString r_to = rstring_from_cstring(to);
+        RuneString r_res = rstring_translate(r_src, r_from, r_to);
+        char* expected = rstring_to_cstring(r_res);
+        assert(translated(src, from, to, expected));
+        free(expected);
+        rstring_free(r_src);
+        rstring_free(r_from);
+        rstring_free(r_to);
+        rstring_free(r_res);
+    }
+    printf("OK\n");
+}
+
+int main(void) {
+    test_translate();
+    test_size();
+    test_random();
+    return 0;
+}
@@ -0,0 +1,134 @@
+// Copyright (c) 2024 Anton Zhiyanov, MIT License
+// https://github.com/nalgeon/sqlean
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sqlite3ext.h"
+SQLITE_EXTENSION_INIT1
+
+#include "text/ustring.h"
+
+static Utf8String str_of(const char* cstring) {
+    return ustring_from_cstring(cstring, strlen(cstring));
+}
+
+static bool eq(Utf8String str, const char* expected) {
+    return str.size == strlen(expected) && memcmp(str.bytes, expected, str.size) == 0;
+}
+
+static void test_length(void) {
+    printf("test_length...");
+    assert(ustring_length(str_of("привет мир")) == 10);
+    assert(ustring_length(str_of("hello")) == 5);
+    assert(ustring_length(str_of("")) == 0);
+    printf("OK\n");
+}
+
+static void test_slice(void) {
+    printf("test_slice...");
+    Utf8String str = str_of("привет мир");
+    assert(eq(ustring_slice(str, 0, 6), "привет"));
+    assert(eq(ustring_slice(str, 7, 10), "мир"));
+    assert(eq(ustring_slice(str, 7, 100), "мир"));
+    assert(eq(ustring_slice(str, -3, 10), "мир"));
+    assert(eq(ustring_slice(str, 0, -4), "привет"));
+    assert(eq(ustring_slice(str, -100, 3), "при"));
+    assert(eq(ustring_slice(str, 3, 3), ""));
+    assert(eq(ustring_slice(str, 5, 3), ""));
+    assert(eq(ustring_slice(str, 10, 12), ""));
+    assert(eq(ustring_slice(str, 0, -100), ""));
+    assert(eq(ustring_slice(str_of(""), 0, 1), ""));
+    // the slice points into the original string
+    assert(ustring_slice(str, 7, 10).bytes == str.bytes + 13);
+    printf("OK\n");
+}
+
+static void test_substring(void) {
+    printf("test_substring...");
+    Utf8String str = str_of("привет мир");
+    assert(eq(ustring_substring(str, 0, 6), "привет"));
+    assert(eq(ustring_substring(str, 7, 3), "мир"));
+    assert(eq(ustring_substring(str, 7, 100), "мир"));
+    assert(eq(ustring_substring(str, 9, 1), "р"));
+    assert(eq(ustring_substring(str, 10, 1), ""));
+    assert(eq(ustring_substring(str, 15, 1), ""));
+    assert(eq(ustring_substring(str, 0, 0), ""));
+    printf("OK\n");
+}
+
+static void test_index(void) {
+    printf("test_index...");
+    Utf8String str = str_of("привет мир");
+    assert(ustring_index(str, str_of("при")) == 0);
+    assert(ustring_index(str, str_of("мир")) == 7);
+    assert(ustring_index(str, str_of("и")) == 2);
+    assert(ustring_index(str, str_of("")) == 0);
+    assert(ustring_index(str, str_of("world")) == -1);
+    assert(ustring_index(str_of(""), str_of("мир")) == -1);
+    printf("OK\n");
+}
+
+static void test_last_index(void) {
+    printf("test_last_index...");
+    Utf8String str = str_of("привет мир");
+    assert(ustring_last_index(str, str_of("при")) == 0);
+    assert(ustring_last_index(str, str_of("и")) == 8);
+    assert(ustring_last_index(str, str_of("")) == 9);
+    assert(ustring_last_index(str, str_of("world")) == -1);
+    printf("OK\n");
+}
+
+static void test_split_part(void) {
+    printf("test_split_part...");
+    Utf8String str = str_of("один|два|три");
+    Utf8String sep = str_of("|");
+    assert(eq(ustring_split_part(str, sep, 0), "один"));
+    assert(eq(ustring_split_part(str, sep, 1), "два"));
+    assert(eq(ustring_split_part(str, sep, 2), "три"));
+    assert(eq(ustring_split_part(str, sep, 3), ""));
+    assert(eq(ustring_split_part(str, sep, -1), "три"));
+    assert(eq(ustring_split_part(str, sep, -3), "один"));
+    assert(eq(ustring_split_part(str, sep, -4), ""));
+    assert(eq(ustring_split_part(str, str_of(""), 0), "один|два|три"));
+    assert(eq(ustring_split_part(str, str_of(""), 1), ""));
+    assert(eq(ustring_split_part(str_of("ab"), str_of("abc"), 0), "ab"));
+    assert(eq(ustring_split_part(str_of(""), sep, 0), ""));
+    // overlapping separators match from the start of the string
+    assert(eq(ustring_split_part(str_of("xaaay"), str_of("aa"), 0), "x"));
+    assert(eq(ustring_split_part(str_of("xaaay"), str_of("aa"), -1), "ay"));
+    assert(eq(ustring_split_part(str_of("xaaay"), str_of("aa"), -2), "x"));
+    printf("OK\n");
+}
+
+static void test_trim(void) {
+    printf("test_trim...");
+    Utf8String chars = str_of("ё ");
+    assert(eq(ustring_trim_left(str_of("ё ёпривет мирё "), chars), "привет мирё "));
+    assert(eq(ustring_trim_right(str_of("ё ёпривет мирё "), chars), "ё ёпривет мир"));
+    assert(eq(ustring_trim(str_of("ё ёпривет мирё "), chars), "привет мир"));
+    assert(eq(ustring_trim(str_of("привет"), chars), "привет"));
+    assert(eq(ustring_trim(str_of("ёёё"), chars), ""));
+    assert(eq(ustring_trim(str_of(""), chars), ""));
+    assert(eq(ustring_trim(str_of(" привет "), str_of("")), " привет "));
+    printf("OK\n");
+}
+
+int main(void) {
+    test_length();
+
+    test_slice();
+    test_substring();
+
+    test_index();
+    test_last_index();
+    test_split_part();
+
+    test_trim();
+
+    return 0;
+}
@@ -79,24 +79,28 @@ static void test_valid(void) {
 static void test_tolower(void) {
     printf("test_tolower...");
     {
-        char s[] = "Hello, WORLD!";
-        utf8_tolower(s, strlen(s));
-        assert(strcmp(s, "hello, world!") == 0);
+        const char* s = "Hello, WORLD!";
+        char res[64] = {0};
+        size_t n = utf8_tolower(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "hello, world!") == 0);
     }
     {
-        char s[] = "Hello, 世界!";
-        utf8_tolower(s, strlen(s));
-        assert(strcmp(s, "hello, 世界!") == 0);
+        const char* s = "Hello, 世界!";
+        char res[64] = {0};
+        size_t n = utf8_tolower(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "hello, 世界!") == 0);
     }
     {
-        char s[] = "CÓMO ESTÁS";
-        utf8_tolower(s, strlen(s));
-        assert(strcmp(s, "cómo estás") == 0);
+        const char* s = "CÓMO ESTÁS";
+        char res[64] = {0};
+        size_t n = utf8_tolower(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "cómo estás") == 0);
     }
     {
-        char s[] = "Привет, МИР!";
-        utf8_tolower(s, strlen(s));
-        assert(strcmp(s, "привет, мир!") == 0);
+        const char* s = "Привет, МИР!";
+        char res[64] = {0};
+        size_t n = utf8_tolower(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "привет, мир!") == 0);
     }
     printf("OK\n");
 }
@@ -104,24 +108,28 @@ static void test_tolower(void) {
 static void test_toupper(void) {
     printf("test_toupper...");
     {
-        char s[] = "Hello, world!";
-        utf8_toupper(s, strlen(s));
-        assert(strcmp(s, "HELLO, WORLD!") == 0);
+        const char* s = "Hello, world!";
+        char res[64] = {0};
+        size_t n = utf8_toupper(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "HELLO, WORLD!") == 0);
     }
     {
-        char s[] = "Hello, 世界!";
-        utf8_toupper(s, strlen(s));
-        assert(strcmp(s, "HELLO, 世界!") == 0);
+        const char* s = "Hello, 世界!";
+        char res[64] = {0};
+        size_t n = utf8_toupper(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "HELLO, 世界!") == 0);
     }
     {
-        char s[] = "cómo estás";
-        utf8_toupper(s, strlen(s));
-        assert(strcmp(s, "CÓMO ESTÁS") == 0);
+        const char* s = "cómo estás";
+        char res[64] = {0};
+        size_t n = utf8_toupper(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "CÓMO ESTÁS") == 0);
     }
     {
-        char s[] = "Привет, мир!";
-        utf8_toupper(s, strlen(s));
-        assert(strcmp(s, "ПРИВЕТ, МИР!") == 0);
+        const char* s = "Привет, мир!";
+        char res[64] = {0};
+        size_t n = utf8_toupper(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "ПРИВЕТ, МИР!") == 0);
     }
     printf("OK\n");
 }
@@ -129,24 +137,28 @@ static void test_toupper(void) {
 static void test_totitle(void) {
     printf("test_totitle...");
     {
-        char s[] = "hello, world!";
-        utf8_totitle(s, strlen(s));
-        assert(strcmp(s, "Hello, World!") == 0);
+        const char* s = "hello, world!";
+        char res[64] = {0};
+        size_t n = utf8_totitle(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "Hello, World!") == 0);
     }
     {
-        char s[] = "hello, 世界!";
-        utf8_totitle(s, strlen(s));
-        assert(strcmp(s, "Hello, 世界!") == 0);
+        const char* s = "hello, 世界!";
+        char res[64] = {0};
+        size_t n = utf8_totitle(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "Hello, 世界!") == 0);
     }
     {
-        char s[] = "cómo estás";
-        utf8_totitle(s, strlen(s));
-        assert(strcmp(s, "Cómo Estás") == 0);
+        const char* s = "cómo estás";
+        char res[64] = {0};
+        size_t n = utf8_totitle(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "Cómo Estás") == 0);
     }
     {
-        char s[] = "привет, мир!";
-        utf8_totitle(s, strlen(s));
-        assert(strcmp(s, "Привет, Мир!") == 0);
+        const char* s = "привет, мир!";
+        char res[64] = {0};
+        size_t n = utf8_totitle(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "Привет, Мир!") == 0);
     }
     printf("OK\n");
 }
@@ -154,24 +166,69 @@ static void test_totitle(void) {
 static void test_casefold(void) {
     printf("test_casefold...");
     {
-        char s[] = "Hello, WORLD!";
-        utf8_casefold(s, strlen(s));
-        assert(strcmp(s, "hello, world!") == 0);
+        const char* s = "Hello, WORLD!";
+        char res[64] = {0};
+        size_t n = utf8_casefold(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "hello, world!") == 0);
     }
     {
-        char s[] = "Hello, 世界!";
-        utf8_casefold(s, strlen(s));
-        assert(strcmp(s, "hello, 世界!") == 0);
+        const char* s = "Hello, 世界!";
+        char res[64] = {0};
+        size_t n = utf8_casefold(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "hello, 世界!") == 0);
     }
     {
-        char s[] = "CÓMO ESTÁS";
-        utf8_casefold(s, strlen(s));
-        assert(strcmp(s, "cómo estás") == 0);
+        const char* s = "CÓMO ESTÁS";
+        char res[64] = {0};
+        size_t n = utf8_casefold(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "cómo estás") == 0);
     }
     {
-        char s[] = "Привет, МИР!";
-        utf8_casefold(s, strlen(s));
-        assert(strcmp(s, "привет, мир!") == 0);
+        const char* s = "Привет, МИР!";
+        char res[64] = {0};
+        size_t n = utf8_casefold(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(res) && strcmp(res, "привет, мир!") == 0);
+    }
+    printf("OK\n");
+}
+
+static void test_case_length(void) {
+    printf("test_case_length...");
+    {
+        // characters that change their utf8 length
+        const char* s = "ıſxɐ";
+        char res[64] = {0};
+        size_t n = utf8_toupper(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen("ISXⱯ") && strcmp(res, "ISXⱯ") == 0);
+        n = utf8_tolower("ⱯX", strlen("ⱯX"), res, sizeof(res) - 1);
+        res[n] = 0;
+        assert(strcmp(res, "ɐx") == 0);
+    }
+    {
+        // the result does not fit, nothing is written past the size
+        const char* s = "ɐɐ";
+        char res[8] = "#######";
+        size_t n = utf8_toupper(s, strlen(s), res, strlen(s));
+        assert(n == 6);
+        assert(memcmp(res, "Ɐ#", 4) == 0);
+    }
+    {
+        // ascii blocks
+        const char* s = "The Quick Brown Fox Jumps Over The Lazy Dog @[`{ ЁЖ 0123456789";
+        char res[128] = {0};
+        size_t n = utf8_toupper(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(s));
+        assert(strcmp(res, "THE QUICK BROWN FOX JUMPS OVER THE LAZY DOG @[`{ ЁЖ 0123456789") == 0);
+        n = utf8_tolower(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == strlen(s));
+        assert(strcmp(res, "the quick brown fox jumps over the lazy dog @[`{ ёж 0123456789") == 0);
+    }
+    {
+        // invalid bytes are copied as is
+        const char* s = "A\xff" "B\xd0";
+        char res[8] = {0};
+        size_t n = utf8_tolower(s, strlen(s), res, sizeof(res) - 1);
+        assert(n == 4 && strcmp(res, "a\xff" "b\xd0") == 0);
     }
     printf("OK\n");
 }
@@ -186,4 +243,5 @@ int main(void) {
     test_toupper();
     test_totitle();
     test_casefold();
+    test_case_length();
 }
@@ -0,0 +1,56 @@
+-- Copyright (c) 2023 Anton Zhiyanov, MIT License
+-- https://github.com/nalgeon/sqlean
+
+-- Throughput benchmark for the vsv reader over synthetic CSV files.
+-- Run with `make bench-vsv`, compare the "Run Time" lines between builds.
+
+.load dist/vsv
+
+-- 500K rows: integers, reals, short and long text, quoted fields with
+-- separators, doubled quotes and line breaks inside.
+.headers off
+.mode csv
+.once bench.csv
+with recursive n(i) as (select 1 union all select i + 1 from n where i < 500000)
+select
+    i,
+    i * 0.25,
+    'name-' || (i % 1000),
+    printf('%.*c', 20 + i % 80, 'x'),
+    case when i % 10 = 0 then 'with, comma' else 'plain text value' end,
+    case when i % 20 = 0 then 'say "hi"' else 'no quotes here' end,
+    case when i % 50 = 0 then 'multi' || char(10) || 'line' else 'single line' end,
+    hex(i * 7919)
+from n;
+.mode list
+
+select 'file size, MB: ' || round(length(readfile('bench.csv')) / 1e6, 1);
+
+create virtual table temp.bench using vsv(filename=bench.csv, columns=8);
+create virtual table temp.bench_numeric using vsv(filename=bench.csv, columns=8, affinity=numeric);
+create virtual table temp.bench_inferred using vsv(filename=bench.csv, infer=1000);
+-- buffer= only matters for files that are not mapped: build with -DVSV_OMIT_MMAP
+create virtual table temp.bench_small using vsv(filename=bench.csv, columns=8, buffer='4k');
+create virtual table temp.bench_indexed using vsv(filename=bench.csv, columns=8, index=yes);
+create table bench_insert(c0, c1, c2, c3, c4, c5, c6, c7);
+create table bench_import(c0, c1, c2, c3, c4, c5, c6, c7);
+
+.timer on
+select 'count: ' || count(*) from bench;
+select 'count, 4K buffer: ' || count(*) from bench_small;
+select 'count, building index: ' || count(*) from bench_indexed;
+select 'first column: ' || count(c0) from bench;
+select 'last column: ' || count(c7) from bench;
+select 'filtered: ' || count(*) from (select * from bench where c2 = 'name-7');
+select 'offset: ' || count(*) from (select * from bench limit 10 offset 499990);
+select 'offset, indexed: ' || count(*) from (select * from bench_indexed limit 10 offset 499990);
+select 'rowid, indexed: ' || count(*) from bench_indexed where rowid = 499990;
+select 'all columns: ' || sum(length(c0) + length(c1) + length(c2) + length(c3) + length(c4) + length(c5) + length(c6) + length(c7)) from bench;
+select 'numeric: ' || (sum(c0) + sum(c1)) from bench_numeric;
+select 'inferred: ' || (sum(c0) + sum(c1)) from bench_inferred;
+insert into bench_insert select * from bench;
+select 'import: ' || vsv_import('bench.csv', 'bench_import');
+select 'export: ' || vsv_export('bench-export.csv', 'select * from bench_import');
+.timer off
+
+.shell rm -f bench.csv bench.csv.vsvidx bench-export.csv
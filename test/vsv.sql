@@ -17,4 +17,126 @@ select '01', count(*) = 3 from people;
 select '02', (id, name, city) = (22, 'Grace', 'Berlin') from people where id = 22;
 select '03', typeof(id) = 'integer' from people where id = 22;
 
-.shell rm -f people.csv
\ No newline at end of file
+.shell rm -f people.csv
+
+.once sparse.csv
+select ',Diane' || char(10) || '"Grace ""G"" Hopper",Berlin';
+
+create virtual table sparse using vsv(filename=sparse.csv, columns=2);
+select '04', (c0, c1) = ('', 'Diane') from sparse where rowid = 1;
+select '05', (c0, c1) = ('Grace "G" Hopper', 'Berlin') from sparse where rowid = 2;
+
+.shell rm -f sparse.csv
+
+.once imported.csv
+select 'id,name' || char(10) || '11,Diane' || char(10) || '22,"Grace ""G"" Hopper"';
+
+create table imported(id integer, name text);
+select '06', vsv_import('imported.csv', 'imported', 'header') = 2;
+select '07', (id, name) = (22, 'Grace "G" Hopper') from imported where rowid = 2;
+
+.shell rm -f imported.csv
+
+.once filtered.csv
+select 'a,1' || char(10) || '"b ""q""",2' || char(10) || 'c,3' || char(10) || 'd,04';
+
+create virtual table filtered using vsv(filename=filtered.csv);
+select '08', group_concat(rowid) = '2' from filtered where c0 = 'b "q"';
+select '09', group_concat(c0) = 'b "q",c' from filtered where c0 > 'a' and c0 <= 'c';
+select '10', group_concat(rowid) = '1,4' from filtered where c1 in ('1', '4', '04');
+select '11', count(*) = 0 from filtered where c1 = 1;
+select '12', group_concat(rowid) = '3,4' from (select rowid from filtered limit 2 offset 2);
+
+.shell rm -f filtered.csv
+
+.once indexed.csv
+with recursive n(i) as (select 1 union all select i + 1 from n where i < 3000)
+select i || ',"row ' || i || '"' from n;
+
+create virtual table indexed using vsv(filename=indexed.csv, index=yes);
+select '13', count(*) = 3000 from indexed;
+select '14', (rowid, c0, c1) = (2500, '2500', 'row 2500') from indexed where rowid = 2500;
+select '15', group_concat(c0) = '1024,1025,1026' from indexed where rowid between 1024 and 1026;
+select '16', group_concat(c0) = '2049,2050' from (select c0 from indexed limit 2 offset 2048);
+
+.shell rm -f indexed.csv indexed.csv.vsvidx
+
+.once typed.csv
+select 'id,price,day,name' || char(10) || '1,2.5,2024-01-05,a' || char(10) || '2,3,2024-02-29,b';
+
+select '17', vsv_infer('typed.csv', 10, 'header') = 'CREATE TABLE x("id" INTEGER,"price" REAL,"day" DATE,"name" TEXT)';
+create virtual table typed using vsv(filename=typed.csv, header, infer=10);
+select '18', (typeof(id), typeof(price), price, typeof(day)) = ('integer', 'real', 3.0, 'text') from typed where rowid = 2;
+select '19', group_concat(name) = 'b' from typed where id > '1';
+
+.shell rm -f typed.csv
+
+create table exported(id integer, name text, score real);
+insert into exported values (1, 'Diane', 2.5), (2, 'Grace "G", Hopper', null), (3, '', 0.1);
+select '20', vsv_export('exported.csv', 'select * from exported order by id', 'header') = 3;
+create virtual table reread using vsv(filename=exported.csv, header, nulls, infer=10);
+select '21', count(*) = 0 from (select * from reread except select * from exported);
+
+.shell rm -f exported.csv
+
+.shell echo 'a' > changed.csv
+.shell echo 'b' >> changed.csv
+create virtual table changed using vsv(filename=changed.csv);
+select '22', group_concat(c0) = 'a,b' from changed;
+.shell echo 'c' >> changed.csv
+.shell echo 'd' >> changed.csv
+select '23', group_concat(c0) = 'a,b,c,d' from changed;
+.shell echo 'x' > changed.csv
+select '24', group_concat(c0) = 'x' from changed;
+
+.once changed.csv
+with recursive n(i) as (select 1 union all select i + 1 from n where i < 2000)
+select i || ',"row ' || i || '"' from n;
+select '25', count(*) = 2000 from changed;
+.shell echo 'y' > changed.csv
+select '26', group_concat(c0) = 'y' from changed;
+
+.shell echo 'a' > changed.csv
+.shell echo 'b' >> changed.csv
+select '36', group_concat(c0) = 'a,b' from changed;
+.shell echo 'c' > changed.tmp
+.shell echo 'd' >> changed.tmp
+.shell touch -r changed.csv changed.tmp
+.shell mv changed.tmp changed.csv
+select '37', group_concat(c0) = 'c,d' from changed;
+
+.shell rm -f changed.csv
+
+.shell echo 'a' > ordered.csv
+.shell echo 'b' >> ordered.csv
+.shell echo 'c' >> ordered.csv
+.shell echo 'd' >> ordered.csv
+.shell echo 'e' >> ordered.csv
+create virtual table ordered using vsv(filename=ordered.csv);
+select '27', group_concat(c0) = 'e,d' from (select c0 from ordered order by c0 desc limit 2);
+select '28', group_concat(c0) = 'd,c' from (select c0 from ordered order by rowid desc limit 2 offset 1);
+select '29', group_concat(c0) = 'c,d' from (select c0 from ordered order by rowid limit 2 offset 2);
+select '30', group_concat(c0) = 'a,b' from (select c0 from ordered order by c0 limit 2);
+
+.shell rm -f ordered.csv
+
+.once rewritten.csv
+with recursive n(i) as (select 1 union all select i + 1 from n where i < 3000)
+select printf('%07d', i) from n;
+create virtual table rewritten using vsv(filename=rewritten.csv, index=yes);
+select '31', count(*) = 3000 from rewritten;
+.shell touch -r rewritten.csv rewritten.stamp
+.once rewritten.csv
+with recursive n(i) as (select 1 union all select i + 1 from n where i < 3000)
+select case i when 1 then '00000001' when 3000 then '003000' else printf('%07d', i) end from n;
+.shell touch -r rewritten.stamp rewritten.csv
+create virtual table rewritten2 using vsv(filename=rewritten.csv, index=yes);
+select '32', c0 = '0002500' from rewritten2 where rowid = 2500;
+select '33', group_concat(c0) = '0002500' from (select c0 from rewritten2 limit 1 offset 2499);
+.shell cp rewritten.csv rewritten.tmp
+.shell mv rewritten.tmp rewritten.csv
+.shell touch -r rewritten.stamp rewritten.csv
+select '34', count(*) = 3000 from rewritten2;
+select '35', c0 = '0002049' from rewritten2 where rowid = 2049;
+
+.shell rm -f rewritten.csv rewritten.csv.vsvidx rewritten.stamp
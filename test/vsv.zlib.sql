@@ -0,0 +1,39 @@
+-- Copyright (c) 2021 Anton Zhiyanov, MIT License
+-- https://github.com/nalgeon/sqlean
+
+-- Needs a vsv build with gzip support: make test-vsv-zlib
+
+.load dist/vsv-zlib sqlite3_vsv_init
+
+.once plain.csv
+with recursive n(i) as (select 1 union all select i + 1 from n where i < 5000)
+select i || ',"row ' || i || '"' from n;
+.shell gzip -c plain.csv > packed.csv.gz
+
+create virtual table plain using vsv(filename=plain.csv);
+create virtual table packed using vsv(filename=packed.csv.gz);
+select '01', count(*) = 5000 from packed;
+select '02', count(*) = 0 from (select rowid, * from packed except select rowid, * from plain);
+select '03', (c0, c1) = ('4500', 'row 4500') from packed where rowid = 4500;
+select '04', group_concat(c0) = '3000,3001' from (select c0 from packed limit 2 offset 2999);
+
+create virtual table indexed using vsv(filename=packed.csv.gz, index=yes);
+select '05', count(*) = 5000 from indexed;
+select '06', c1 = 'row 4100' from indexed where rowid = 4100;
+select '07', group_concat(c0) = '1024,1025,1026' from indexed where rowid between 1024 and 1026;
+select '08', group_concat(c0) = '2049,2050' from (select c0 from indexed limit 2 offset 2048);
+
+.shell gzip -c plain.csv > members.csv.gz
+.shell gzip -c plain.csv >> members.csv.gz
+create virtual table members using vsv(filename=members.csv.gz);
+select '09', count(*) = 10000 from members;
+select '10', c1 = 'row 2000' from members where rowid = 7000;
+
+create table imported(c0 text, c1 text);
+select '11', vsv_import('packed.csv.gz', 'imported') = 5000;
+select '12', count(*) = 0 from (select rowid, * from imported except select rowid, * from plain);
+
+.shell head -c 2000 packed.csv.gz > truncated.csv.gz
+.read '|sqlite3 -cmd ".load dist/vsv-zlib sqlite3_vsv_init" :memory: "create virtual table t using vsv(filename=truncated.csv.gz); select count(*) from t" 2>&1 | grep -q "truncated gzip data" && echo "select 13, 1;" || echo "select 13, 0;"'
+
+.shell rm -f plain.csv packed.csv.gz packed.csv.gz.vsvidx members.csv.gz truncated.csv.gz